@@ -5,6 +5,7 @@ from sys import platform
 import os
 import glob
 import csv
+import shutil
 import sys
 
 
@@ -13,6 +14,11 @@ filecount =0
 rowcount =0
 args = ""
 csvFilePath = './out/fps.csv'
+bvhCsvFilePath = './out/bvh.csv'
+layoutCsvFilePath = './out/layout.csv'
+lightsCsvFilePath = './out/lights.csv'
+shadersCsvFilePath = './out/shaders.csv'
+programBinariesPath = './cache/'
 plyFilePath = './data/models/'
 fileNb = len(glob.glob(plyFilePath + '*.ply'))
 pointLights = [x*50 for x in range(1,6)]
@@ -35,6 +41,22 @@ if (not os.path.exists("./out/")):
 if os.path.exists(csvFilePath):
     os.remove(csvFilePath)
 
+if os.path.exists(bvhCsvFilePath):
+    os.remove(bvhCsvFilePath)
+
+if os.path.exists(layoutCsvFilePath):
+    os.remove(layoutCsvFilePath)
+
+if os.path.exists(lightsCsvFilePath):
+    os.remove(lightsCsvFilePath)
+
+if os.path.exists(shadersCsvFilePath):
+    os.remove(shadersCsvFilePath)
+
+# Start without program binaries, so that the first run is a cold start
+if os.path.exists(programBinariesPath):
+    shutil.rmtree(programBinariesPath)
+
 
 
 
@@ -2,20 +2,35 @@
 
 @define_macros
 
-uniform vec3 lights_dir_direction[NB_DIR_LIGHTS];
-uniform vec3 lights_dir_intensity[NB_DIR_LIGHTS];
+// Lights, with one buffer per attribute (counts change without recompiling)
+uniform samplerBuffer lights_dir_direction;
+uniform samplerBuffer lights_dir_intensity;
+uniform int nb_dir_lights = 0;
 
-uniform vec3 lights_pt_position[NB_PT_LIGHTS];
-uniform vec3 lights_pt_intensity[NB_PT_LIGHTS];
+uniform samplerBuffer lights_pt_position;
+uniform samplerBuffer lights_pt_intensity;
+uniform int nb_pt_lights = 0;
 
 uniform vec3 ambient_color;
-uniform mat3 normal_matrix;
+
+// Per-frame constants, shared by all programs
+layout(std140) uniform FrameConstants {
+	mat4 projection_matrix;
+	mat4 view_matrix;
+	mat4 model_matrix;
+	mat3 normal_matrix;
+};
 
 in vec4 vert_position;
 in vec3 vert_color;
 in vec3 vert_normal;
+#if defined(MATERIAL_PER_DRAW) || defined(MATERIAL_PER_VERTEX)
+flat in uint vert_material;
+#endif
 
 uniform usamplerBuffer face_material;
+// Parameters of the materials (albedo, diffuse coefficient), by material ID
+uniform samplerBuffer materials_table;
 
 layout(location = 0) out vec3 out_color;
 
@@ -24,5 +39,5 @@ layout(location = 0) out vec3 out_color;
 void main() {
 	out_color = ambient_color * vert_color;
 
-@call_materials for (int i = 0; i < NB_DIR_LIGHTS; i++) { out_color += (@mat * lights_dir_intensity[i]) * max(dot(vert_normal, normalize(lights_dir_direction[i] * normal_matrix)), 0); } for (int i = 0; i < NB_PT_LIGHTS; i++) { float distance = length(lights_pt_position[i] - vert_position.xyz); float attenuation =  1. / (1. + .09 * distance + .032 * distance * distance); vec3 lightDir = normalize((lights_pt_position[i] - vert_position.xyz)); out_color += @mat * lights_pt_intensity[i] * max(dot(vert_normal, lightDir * normal_matrix), 0) * attenuation; }
+@call_materials for (int i = 0; i < nb_dir_lights; i++) { out_color += (@mat * texelFetch(lights_dir_intensity, i).rgb) * max(dot(vert_normal, normalize(texelFetch(lights_dir_direction, i).xyz * normal_matrix)), 0); } for (int i = 0; i < nb_pt_lights; i++) { vec3 lightPosition = texelFetch(lights_pt_position, i).xyz; float distance = length(lightPosition - vert_position.xyz); float attenuation =  1. / (1. + .09 * distance + .032 * distance * distance); vec3 lightDir = normalize((lightPosition - vert_position.xyz)); out_color += @mat * texelFetch(lights_pt_intensity, i).rgb * max(dot(vert_normal, lightDir * normal_matrix), 0) * attenuation; }
 }
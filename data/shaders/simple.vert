@@ -1,9 +1,28 @@
 #version 410 core
 
-uniform mat4 projection_matrix;
-uniform mat4 view_matrix;
-uniform mat4 model_matrix;
-uniform mat3 normal_matrix;
+// Per-frame constants, shared by all programs
+layout(std140) uniform FrameConstants {
+	mat4 projection_matrix;
+	mat4 view_matrix;
+	mat4 model_matrix;
+	mat3 normal_matrix;
+};
+
+// Decoding of compact vertices (identity for full-precision ones)
+uniform vec3 vtx_position_offset = vec3(0.);
+uniform vec3 vtx_position_scale = vec3(1.);
+uniform bool vtx_octahedral = false;
+
+// Vertices pulled from buffers instead of attributes: index of each vertex of
+// the draws, then words of the vertices (`vtx_stride` apart, with the offsets
+// of the position, normal and color, the color being the default one if its
+// offset is negative)
+uniform bool vtx_pulling = false;
+uniform usamplerBuffer vtx_indices;
+uniform usamplerBuffer vtx_vertices;
+uniform int vtx_stride;
+uniform ivec3 vtx_offsets;
+uniform vec3 vtx_default_color;
 
 in vec3 vtx_position;
 in vec3 vtx_color;
@@ -14,10 +33,57 @@ out vec3 vert_color;
 out vec3 vert_normal;
 out vec3 vert_normal_raw;
 
+vec3 DecodeNormal(vec3 normal) {
+	if (!vtx_octahedral)
+		return normal;
+	// Unfold the octahedron
+	vec3 result = vec3(normal.xy, 1. - abs(normal.x) - abs(normal.y));
+	float t = max(-result.z, 0.);
+	result.x += (result.x >= 0.) ? -t : t;
+	result.y += (result.y >= 0.) ? -t : t;
+	return normalize(result);
+}
+
+uint FetchWord(uint vertex, int offset) {
+	return texelFetch(vtx_vertices, offset + vtx_stride * int(vertex)).r;
+}
+
+vec3 FetchVector(uint vertex, int offset) {
+	return uintBitsToFloat(uvec3(FetchWord(vertex, offset),
+			FetchWord(vertex, offset + 1), FetchWord(vertex, offset + 2)));
+}
+
+void PullVertex(uint vertex, out vec3 position, out vec3 color,
+		out vec3 normal) {
+	if (vtx_octahedral) {
+		// Compact vertices: normalized integers, as read by the attributes
+		position = vec3(unpackUnorm2x16(FetchWord(vertex, vtx_offsets.x)),
+				unpackUnorm2x16(FetchWord(vertex, vtx_offsets.x + 1)).x);
+		int encoded = int(FetchWord(vertex, vtx_offsets.y));
+		normal = vec3(max(vec2(bitfieldExtract(encoded, 0, 16),
+				bitfieldExtract(encoded, 16, 16)) / 32767., -1.), 0.);
+		color = (vtx_offsets.z < 0) ? vtx_default_color
+				: unpackUnorm4x8(FetchWord(vertex, vtx_offsets.z)).rgb;
+	} else {
+		position = FetchVector(vertex, vtx_offsets.x);
+		normal = FetchVector(vertex, vtx_offsets.y);
+		color = (vtx_offsets.z < 0) ? vtx_default_color
+				: FetchVector(vertex, vtx_offsets.z);
+	}
+}
+
 void main() {
-	vert_position = view_matrix * model_matrix * vec4(vtx_position, 1.);
+	vec3 attributes[3] = vec3[3](vtx_position, vtx_color, vtx_normal);
+	if (vtx_pulling) {
+		PullVertex(texelFetch(vtx_indices, gl_VertexID).r, attributes[0],
+				attributes[1], attributes[2]);
+	}
+
+	vec3 position = vtx_position_offset + attributes[0] * vtx_position_scale;
+	vec3 normal = DecodeNormal(attributes[2]);
+	vert_position = view_matrix * model_matrix * vec4(position, 1.);
 	gl_Position = projection_matrix * vert_position;
-	vert_color = vtx_color;
-	vert_normal = normalize(vtx_normal * normal_matrix);
-	vert_normal_raw = vtx_normal;
+	vert_color = attributes[1];
+	vert_normal = normalize(normal * normal_matrix);
+	vert_normal_raw = normal;
 }
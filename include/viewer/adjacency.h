@@ -0,0 +1,146 @@
+#ifndef ADJACENCY_H
+#define ADJACENCY_H
+
+#include <vector>
+
+#include "mesh.h"
+
+/**
+ * \brief Adjacency of the vertices and faces of a mesh.
+ *
+ * Store, in compressed sparse row format, the faces around each vertex and the
+ * faces sharing each edge of each face:
+ * - the faces of vertex `v` are `vertexFaces[vertexFacesStart[v]]` to
+ *   `vertexFaces[vertexFacesStart[v + 1] - 1]`, sorted by index;
+ * - the neighbors of face `f` across its edge `e` (from its vertex `e` to its
+ *   vertex `(e + 1) % 3`) are `edgeNeighbors[edgeNeighborsStart[3 * f + e]]`
+ *   to `edgeNeighbors[edgeNeighborsStart[3 * f + e + 1] - 1]`, sorted by
+ *   index. Boundary edges have no neighbor, non-manifold ones have several.
+ *
+ * Both are built by worker threads (counting, then prefix sums, then filling),
+ * and the result doesn't depend on their number.
+ *
+ * The mesh’s faces must not change while the adjacency is used.
+ */
+class MeshAdjacency
+{
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * `MeshAdjacency` constructor. Build the adjacency of a mesh.
+	 *
+	 * \param mesh Mesh whose adjacency is built.
+	 * \param edgeNeighbors Whether the neighbors of the faces are built too
+	 *      (`true`), or only the faces around each vertex (`false`, then the
+	 *      face and edge getters must not be used).
+	 */
+	MeshAdjacency(Mesh* mesh, bool edgeNeighbors = true);
+	/**
+	 * \brief Destructor.
+	 *
+	 * `MeshAdjacency` destructor.
+	 */
+	~MeshAdjacency();
+
+	/**
+	 * \brief Get the number of faces around a vertex.
+	 *
+	 * \param vertex Index of the vertex.
+	 * \return Number of faces using the vertex.
+	 */
+	unsigned int GetNbVertexFaces(unsigned int vertex) const;
+	/**
+	 * \brief Get the faces around a vertex.
+	 *
+	 * \param vertex Index of the vertex.
+	 * \return Pointer to the indices of the faces using the vertex, sorted.
+	 */
+	const unsigned int* GetVertexFaces(unsigned int vertex) const;
+
+	/**
+	 * \brief Get the number of neighbors of a face.
+	 *
+	 * \param face Index of the face.
+	 * \return Number of faces sharing an edge with the face (counted once per
+	 *      shared edge).
+	 */
+	unsigned int GetNbFaceNeighbors(unsigned int face) const;
+	/**
+	 * \brief Get the neighbors of a face.
+	 *
+	 * \param face Index of the face.
+	 * \return Pointer to the indices of the faces sharing an edge with the
+	 *      face, grouped by edge.
+	 */
+	const unsigned int* GetFaceNeighbors(unsigned int face) const;
+	/**
+	 * \brief Get the number of neighbors of a face across one of its edges.
+	 *
+	 * \param face Index of the face.
+	 * \param edge Index of the edge in the face (0, 1 or 2).
+	 * \return Number of other faces sharing the edge.
+	 */
+	unsigned int GetNbEdgeNeighbors(unsigned int face, unsigned char edge)
+			const;
+	/**
+	 * \brief Get the neighbors of a face across one of its edges.
+	 *
+	 * \param face Index of the face.
+	 * \param edge Index of the edge in the face (0, 1 or 2).
+	 * \return Pointer to the indices of the other faces sharing the edge.
+	 */
+	const unsigned int* GetEdgeNeighbors(unsigned int face,
+			unsigned char edge) const;
+	/**
+	 * \brief Check if an edge of a face is on a boundary of the mesh.
+	 *
+	 * \param face Index of the face.
+	 * \param edge Index of the edge in the face (0, 1 or 2).
+	 * \return Either if no other face shares the edge (`true`) or not
+	 *      (`false`).
+	 */
+	bool IsBoundaryEdge(unsigned int face, unsigned char edge) const;
+
+	/**
+	 * \brief Getter of the memory used by the adjacency.
+	 *
+	 * \return Size of the arrays, in bytes.
+	 */
+	size_t GetMemorySize() const;
+	/**
+	 * \brief Getter of the time spent building the adjacency.
+	 *
+	 * \return Duration of the build, in milliseconds.
+	 */
+	float GetBuildTime() const;
+
+private:
+	/**
+	 * \brief Build the list of faces around each vertex.
+	 */
+	void BuildVertexFaces();
+	/**
+	 * \brief Build the list of neighbors of each edge of each face.
+	 */
+	void BuildEdgeNeighbors();
+
+	/**
+	 * \brief Mesh whose adjacency is built.
+	 */
+	Mesh* mesh = nullptr;
+
+	/* Vertex → faces */
+
+	std::vector<unsigned int> vertexFacesStart;
+	std::vector<unsigned int> vertexFaces;
+
+	/* Face edge → faces */
+
+	std::vector<unsigned int> edgeNeighborsStart;
+	std::vector<unsigned int> edgeNeighbors;
+
+	float buildTime = 0.;
+};
+
+#endif // ADJACENCY_H
@@ -0,0 +1,199 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cfloat>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#include "mesh.h"
+
+#define BVH_MAX_LEAF_FACES	4
+#define BVH_NB_BINS			16
+
+/**
+ * \brief Node of a `BVH`, 32 bytes long so that two of them fit in a cache
+ * line.
+ *
+ * Nodes are stored in depth-first order: the first child of an inner node
+ * always follows it.
+ */
+struct BVHNode
+{
+	/**
+	 * \brief Minimum corner of the node’s bounding box.
+	 */
+	float boxMin[3];
+	/**
+	 * \brief Maximum corner of the node’s bounding box.
+	 */
+	float boxMax[3];
+	/**
+	 * \brief First face of a leaf, or distance to the second child of an inner
+	 * node.
+	 */
+	unsigned int offset;
+	/**
+	 * \brief Number of faces of a leaf, 0 for inner nodes.
+	 */
+	unsigned short nbFaces;
+	/**
+	 * \brief Axis along which the children of an inner node were split.
+	 */
+	unsigned short axis;
+};
+
+/**
+ * \brief Result of a ray query.
+ */
+struct RayHit
+{
+	/**
+	 * \brief Index of the face hit in the mesh.
+	 */
+	unsigned int face = 0;
+	/**
+	 * \brief Distance from the ray’s origin to the hit point.
+	 */
+	float distance = FLT_MAX;
+	/**
+	 * \brief Barycentric coordinates of the hit point relatively to the
+	 * second and third vertices of the face.
+	 */
+	float u = 0.;
+	float v = 0.;
+	/**
+	 * \brief Position of the hit point in the mesh’s space.
+	 */
+	Eigen::Vector3f position = Eigen::Vector3f::Zero();
+};
+
+/**
+ * \brief Bounding volume hierarchy over the faces of a mesh.
+ *
+ * Used to find the faces hit by rays (for mouse picking, for example) without
+ * testing each face of the mesh.
+ *
+ * The tree is built with the surface area heuristic, evaluated on a fixed
+ * number of bins along each axis. Large nodes are binned by all worker threads
+ * and their children are built in parallel, but the result doesn’t depend on
+ * the number of threads. Nodes are then stored in a single flat array, and the
+ * faces’ vertices are copied in the order of the leaves.
+ *
+ * The mesh’s faces must not change while the hierarchy is used.
+ * Queries can be made from several threads at once.
+ */
+class BVH
+{
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * `BVH` constructor. Build the hierarchy.
+	 *
+	 * \param mesh Mesh whose faces are used. It must be alive as long as the
+	 *      hierarchy is used.
+	 * \param maxLeafFaces Maximum number of faces per leaf.
+	 */
+	BVH(Mesh* mesh, unsigned int maxLeafFaces = BVH_MAX_LEAF_FACES);
+	/**
+	 * \brief Destructor.
+	 *
+	 * `BVH` destructor.
+	 */
+	~BVH();
+
+	/**
+	 * \brief Find the nearest face hit by a ray.
+	 *
+	 * Faces are hit from both sides.
+	 *
+	 * \param origin Origin of the ray, in the mesh’s space.
+	 * \param direction Direction of the ray. Distances are given in units of
+	 *      its length.
+	 * \param hit Result of the query, only changed if a face is hit.
+	 * \param maxDistance Distance after which faces are ignored.
+	 * \return Either if a face is hit (`true`) or not (`false`).
+	 */
+	bool Intersect(const Eigen::Vector3f& origin,
+			const Eigen::Vector3f& direction, RayHit& hit,
+			float maxDistance = FLT_MAX) const;
+	/**
+	 * \brief Check if a ray hits any face.
+	 *
+	 * Faster than `Intersect()` as it stops at the first face found, to know
+	 * if a point can be seen from another one for example.
+	 *
+	 * \param origin Origin of the ray, in the mesh’s space.
+	 * \param direction Direction of the ray.
+	 * \param maxDistance Distance after which faces are ignored.
+	 * \return Either if a face is hit (`true`) or not (`false`).
+	 */
+	bool IntersectAny(const Eigen::Vector3f& origin,
+			const Eigen::Vector3f& direction,
+			float maxDistance = FLT_MAX) const;
+
+	/**
+	 * \brief Getter of the number of nodes.
+	 *
+	 * \return Number of nodes of the hierarchy.
+	 */
+	unsigned int GetNbNodes() const;
+	/**
+	 * \brief Getter of the depth of the hierarchy.
+	 *
+	 * \return Number of nodes on the longest path from the root to a leaf.
+	 */
+	unsigned int GetDepth() const;
+	/**
+	 * \brief Getter of the time spent building the hierarchy.
+	 *
+	 * \return Duration of the build, in milliseconds.
+	 */
+	float GetBuildTime() const;
+
+private:
+	/**
+	 * \brief Build the subtree of a range of faces.
+	 *
+	 * Nodes are appended to the given list in depth-first order.
+	 *
+	 * \param first First face of the range, in `faces`.
+	 * \param last Face after the last one of the range.
+	 * \param nodes List of nodes to complete.
+	 * \param depth Depth of the subtree’s root.
+	 * \return Depth of the deepest leaf of the subtree.
+	 */
+	unsigned int BuildNode(unsigned int first, unsigned int last,
+			std::vector<BVHNode>& nodes, unsigned int depth);
+
+	/**
+	 * \brief Mesh whose faces are used.
+	 */
+	Mesh* mesh = nullptr;
+	unsigned int maxLeafFaces;
+
+	/**
+	 * \brief Nodes of the hierarchy, the root first.
+	 */
+	std::vector<BVHNode> nodes;
+	/**
+	 * \brief Faces of the mesh in the order of the leaves.
+	 */
+	std::vector<unsigned int> faces;
+	/**
+	 * \brief First vertex and two edges of each face, in the order of the
+	 * leaves.
+	 */
+	std::vector<float> triangles;
+
+	/* Faces’ bounds, only used during the build */
+
+	std::vector<Eigen::AlignedBox3f> facesBoxes;
+	std::vector<Eigen::Vector3f> facesCentroids;
+
+	unsigned int depth = 0;
+	float buildTime = 0.;
+};
+
+#endif // BVH_H
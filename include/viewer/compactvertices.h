@@ -0,0 +1,176 @@
+#ifndef COMPACTVERTICES_H
+#define COMPACTVERTICES_H
+
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#include "mesh.h"
+
+/**
+ * \brief Encode a unit vector in two coordinates with an octahedral mapping.
+ *
+ * The vector is projected on the octahedron |x| + |y| + |z| = 1, whose lower
+ * half is folded over the upper one, then stored as two signed normalized
+ * 16-bit integers.
+ *
+ * \param normal Unit vector to encode.
+ * \param result Array of two integers receiving the encoded vector.
+ */
+void EncodeOctahedral(const Eigen::Vector3f& normal, short* result);
+/**
+ * \brief Decode a unit vector encoded by `EncodeOctahedral()`.
+ *
+ * Does the same operations as the vertex shaders.
+ *
+ * \param encoded Array of two integers of the encoded vector.
+ * \return Decoded unit vector.
+ */
+Eigen::Vector3f DecodeOctahedral(const short* encoded);
+
+/**
+ * \brief Vertices of a mesh packed in a compact format for the GPU.
+ *
+ * Each vertex is stored in 16 bytes (12 bytes if the mesh has no colors)
+ * instead of the 36 bytes of `Vertex`:
+ * - its position, quantized on 16 bits per axis relatively to the mesh’s
+ *   bounding box (the fourth value is padding);
+ * - its normal, encoded on two 16-bit values by `EncodeOctahedral()`;
+ * - its color, on 8 bits per channel, only if the mesh has colors.
+ *
+ * All values are normalized integers, so shaders read positions in [0, 1] and
+ * normals in [-1, 1]. Positions are decoded with `GetPositionOffset()` and
+ * `GetPositionScale()`, normals with the octahedral mapping.
+ *
+ * Vertices are encoded by worker threads. Once uploaded, the packed data can
+ * be released while the layout is kept.
+ */
+class CompactVertices
+{
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * `CompactVertices` constructor. Encode the vertices of a mesh.
+	 *
+	 * \param mesh Mesh whose vertices are encoded.
+	 */
+	CompactVertices(Mesh* mesh);
+	/**
+	 * \brief Destructor.
+	 *
+	 * `CompactVertices` destructor.
+	 */
+	~CompactVertices();
+
+	/**
+	 * \brief Release the packed data, keeping only the layout.
+	 */
+	void ReleaseData();
+
+	/**
+	 * \brief Decode the position of a vertex.
+	 *
+	 * The packed data must not have been released.
+	 *
+	 * \param vertex Index of the vertex.
+	 * \return Position, as read by the vertex shaders.
+	 */
+	Eigen::Vector3f DecodePosition(unsigned int vertex) const;
+	/**
+	 * \brief Decode the normal of a vertex.
+	 *
+	 * The packed data must not have been released.
+	 *
+	 * \param vertex Index of the vertex.
+	 * \return Normal, as read by the vertex shaders.
+	 */
+	Eigen::Vector3f DecodeNormal(unsigned int vertex) const;
+	/**
+	 * \brief Decode the color of a vertex.
+	 *
+	 * The packed data must not have been released.
+	 *
+	 * \param vertex Index of the vertex.
+	 * \return Color, as read by the vertex shaders.
+	 */
+	Eigen::Vector3f DecodeColor(unsigned int vertex) const;
+
+	/**
+	 * \brief Getter of the packed data.
+	 *
+	 * \return Pointer to the first vertex, `nullptr` once released.
+	 */
+	const unsigned char* GetData() const;
+	/**
+	 * \brief Getter of the size of the packed data.
+	 *
+	 * \return Size of all vertices, in bytes (even once released).
+	 */
+	size_t GetSize() const;
+	/**
+	 * \brief Getter of the size of a vertex.
+	 *
+	 * \return Distance between two vertices, in bytes.
+	 */
+	unsigned int GetStride() const;
+	/**
+	 * \brief Getter of the position of the normal in a vertex.
+	 *
+	 * \return Offset of the normal, in bytes.
+	 */
+	unsigned int GetNormalOffset() const;
+	/**
+	 * \brief Getter of the position of the color in a vertex.
+	 *
+	 * \return Offset of the color, in bytes.
+	 */
+	unsigned int GetColorOffset() const;
+	/**
+	 * \brief Check if colors are stored.
+	 *
+	 * \return Either if the mesh has colors (`true`) or not (`false`).
+	 */
+	bool HaveColors() const;
+
+	/**
+	 * \brief Getter of the position matching quantized coordinates of 0.
+	 *
+	 * \return Minimum corner of the mesh’s bounding box.
+	 */
+	const Eigen::Vector3f& GetPositionOffset() const;
+	/**
+	 * \brief Getter of the scale from quantized coordinates to positions.
+	 *
+	 * \return Size of the mesh’s bounding box.
+	 */
+	const Eigen::Vector3f& GetPositionScale() const;
+
+	/**
+	 * \brief Getter of the time spent encoding the vertices.
+	 *
+	 * \return Duration of the encoding, in milliseconds.
+	 */
+	float GetEncodingTime() const;
+
+private:
+	/**
+	 * \brief Mesh whose vertices are encoded.
+	 */
+	Mesh* mesh = nullptr;
+
+	std::vector<unsigned char> data;
+	size_t size = 0;
+
+	unsigned int stride = 0;
+	unsigned int normalOffset = 0;
+	unsigned int colorOffset = 0;
+	bool haveColors = false;
+
+	Eigen::Vector3f positionOffset = Eigen::Vector3f::Zero();
+	Eigen::Vector3f positionScale = Eigen::Vector3f::Ones();
+
+	float encodingTime = 0.;
+};
+
+#endif // COMPACTVERTICES_H
@@ -9,15 +9,21 @@
 #include <ImGuiFileBrowser.h>
 
 #include "cliloader.h"
+#include "filewatcher.h"
 #include "material.h"
 #include "tomlloader.h"
 #include "modules/imguidemo.h"
 #include "modules/imguiFPS.h"
 #include "modules/meshcontent.h"
 #include "modules/module.h"
+#include "modules/picking.h"
+#include "modules/renderingstats.h"
 #include "modules/shaderscontent.h"
 #include "modules/viewer.h"
 #include "plyreader.h"
+#include "programcache.h"
+#include "rendertargetmanager.h"
+#include "shaderpreprocessor.h"
 
 #define DEFAULT_WINDOW_TITLE	"3D Viewer"
 #define DEFAULT_WINDOW_WIDTH	1280
@@ -32,6 +38,16 @@
 #define ERROR_CLI_PARSING		4
 #define ERROR_CLI_MISS_TOML		5
 
+#define BENCHMARK_BVH_NB_RAYS	262144
+#define BENCHMARK_LAYOUT_NB_RUNS	5
+#define BENCHMARK_MATERIALS_NB_FRAMES	100
+
+// Longest wait for events when nothing needs to be redrawn (in seconds), so
+// that watched files and ImGui timers are still checked
+#define RENDER_ON_DEMAND_TIMEOUT	.5
+// Frames drawn after an event, for ImGui to take it into account
+#define RENDER_ON_DEMAND_NB_FRAMES	3
+
 #define MOUSE_SPEED				0.1
 #define PI_DEGREE				180.0
 
@@ -123,12 +139,42 @@ public:
 	 */
 	void ZoomCamera(float intensity);
 
+	/**
+	 * @brief Picks the face of the mesh under a point of the viewer.
+	 * 
+	 * Shows the result in the picking module, which is opened if needed.
+	 * 
+	 * @param position Position of the point in normalized device coordinates.
+	 * @param pivot Whether the camera should turn around the picked point.
+	 */
+	void PickMesh(const Eigen::Vector2f& position, bool pivot = false);
+
 	/**
 	 * @brief Reload the shaders.
 	 * 
 	 */
 	void ReloadShaders();
 
+	/**
+	 * @brief Reload the shaders depending on modified files.
+	 * 
+	 * Compiles again, in the background, only the shaders depending on the
+	 * watched files which were modified.
+	 * 
+	 */
+	void ReloadModifiedShaders();
+
+	/**
+	 * @brief Watches the files the shaders of a renderer were expanded from.
+	 * 
+	 * Called by the renderer each time its shaders are initialized or
+	 * reloaded (shaders sources and materials may have changed). Already
+	 * watched files are skipped.
+	 * 
+	 * @param renderer Renderer whose shaders are watched.
+	 */
+	void WatchShaders(Renderer* renderer);
+
 	/**
 	 * @brief Resets the list of paths to default materials.
 	 * 
@@ -159,6 +205,12 @@ public:
 	 */
 	void ToggleDebugMode();
 
+	/**
+	 * @brief Toggle the watching of the shaders' files on or off.
+	 * 
+	 */
+	void ToggleShadersWatching();
+
 	/**
 	 * @brief Prepares for application exit.
 	 * 
@@ -204,6 +256,18 @@ public:
 	 */
 	void ToggleImGuiFPSModule();
 
+	/**
+	 * @brief Toggles the rendering statistics module on or off.
+	 * 
+	 */
+	void ToggleRenderingStatsModule();
+
+	/**
+	 * @brief Toggles the picking module on or off.
+	 * 
+	 */
+	void TogglePickingModule();
+
 	/* Callbacks */
 
 	/**
@@ -254,6 +318,13 @@ public:
 	 */
 	void AskForUpdate();
 
+	/**
+	 * @brief Signals the class that the next frames must be drawn, even if
+	 * no event is received.
+	 * 
+	 */
+	void AskForRedraw();
+
 	/**
 	 * @brief Adds a module to the class.
 	 * 
@@ -370,6 +441,58 @@ public:
 	 */
 	bool GetForceUnsortedMesh();
 
+	/**
+	 * @brief Sets whether the mesh's vertices are uploaded in a compact format
+	 * or not.
+	 * 
+	 * @param value Whether vertices are quantized and packed or not.
+	 */
+	void SetCompactVertices(bool value);
+
+	/**
+	 * @brief Gets whether the mesh's vertices are uploaded in a compact format
+	 * or not.
+	 * 
+	 * @return true Vertices are quantized and packed.
+	 * @return false Vertices are uploaded in full precision.
+	 */
+	bool GetCompactVertices();
+
+	/**
+	 * @brief Sets whether the meshes' vertices are stored as a structure of
+	 * arrays or not.
+	 * 
+	 * @param value Whether positions, normals and colors are stored in
+	 * separate arrays or not.
+	 */
+	void SetSoAVertices(bool value);
+
+	/**
+	 * @brief Gets whether the meshes' vertices are stored as a structure of
+	 * arrays or not.
+	 * 
+	 * @return true Attributes are stored in separate arrays.
+	 * @return false Attributes are interleaved.
+	 */
+	bool GetSoAVertices();
+
+	/**
+	 * @brief Sets whether the vertex shaders pull the mesh's vertices from
+	 * buffer textures or not.
+	 * 
+	 * @param value Whether vertices are pulled or read from vertex attributes.
+	 */
+	void SetPullingVertices(bool value);
+
+	/**
+	 * @brief Gets whether the vertex shaders pull the mesh's vertices from
+	 * buffer textures or not.
+	 * 
+	 * @return true Vertices are pulled by the vertex shaders.
+	 * @return false Vertices are read from vertex attributes.
+	 */
+	bool GetPullingVertices();
+
 	/**
 	 * @brief Sets benchmark mode.
 	 * 
@@ -385,6 +508,24 @@ public:
 	 */
 	bool GetBenchmarkMode();
 
+	/**
+	 * @brief Sets whether frames are only drawn when something changed or
+	 * not.
+	 * 
+	 * @param value Whether the app waits for events and reuses the last render
+	 * while nothing changed, or draws every frame.
+	 */
+	void SetRenderOnDemand(bool value);
+
+	/**
+	 * @brief Gets whether frames are only drawn when something changed or
+	 * not.
+	 * 
+	 * @return true The scene is only rendered when it changed.
+	 * @return false Every frame is drawn.
+	 */
+	bool GetRenderOnDemand();
+
 	/**
 	 * @brief Sets `ImGui`'s debug mode.
 	 * 
@@ -436,6 +577,34 @@ public:
 	 */
 	GLFWwindow* GetWindow();
 
+	/**
+	 * @brief Gets the scene displayed in the viewer.
+	 * 
+	 * @return Scene* The scene of the current renderer, nullptr if there is
+	 * none.
+	 */
+	Scene* GetScene();
+	/**
+	 * @brief Gets the cache of linked shader programs.
+	 * 
+	 * @return ProgramCache* The cache shared by all shaders readers.
+	 */
+	ProgramCache* GetProgramCache();
+	/**
+	 * @brief Gets the preprocessor of the shaders sources.
+	 * 
+	 * @return ShaderPreprocessor* The preprocessor shared by all shaders
+	 * readers, caching templates and materials.
+	 */
+	ShaderPreprocessor* GetShaderPreprocessor();
+	/**
+	 * @brief Gets the manager of the render targets.
+	 * 
+	 * @return RenderTargetManager* The manager shared by all renderers,
+	 * pooling their framebuffers' attachments.
+	 */
+	RenderTargetManager* GetRenderTargets();
+
 private:
 	/**
 	 * @brief Render `ImGui`'s menu bar.
@@ -455,6 +624,57 @@ private:
 	 */
 	void Update();
 
+	/**
+	 * @brief Benchmarks the loading of the shaders at startup.
+	 * 
+	 * Appends the number of programs compiled from their sources and loaded
+	 * from the binaries of a previous run, with the time spent on each, to
+	 * `out/shaders.csv`.
+	 * 
+	 */
+	void BenchmarkShaders();
+
+	/**
+	 * @brief Benchmarks the mesh's bounding volume hierarchy.
+	 * 
+	 * Measures its build time and the number of rays it can intersect per
+	 * second, and appends them to `out/bvh.csv`.
+	 * 
+	 */
+	void BenchmarkBVH();
+
+	/**
+	 * @brief Benchmarks the layouts of the mesh's vertices.
+	 * 
+	 * Measures the passes over vertices done at load time (bounding box and
+	 * normals, then ray-query hierarchy) on copies of the mesh stored as an
+	 * array of structures and as a structure of arrays, and appends them to
+	 * `out/layout.csv`.
+	 * 
+	 */
+	void BenchmarkVertexLayouts();
+
+	/**
+	 * @brief Benchmarks the initialization with the scene's lights.
+	 * 
+	 * Measures the time to create a scene with 1, 250 and 5000 point lights
+	 * preloaded, then to initialize the renderer with it (until its programs
+	 * are linked), and appends them to `out/lights.csv`.
+	 * 
+	 */
+	void BenchmarkLights();
+
+	/**
+	 * @brief Benchmarks the ways to read the faces' materials.
+	 * 
+	 * Measures the frame time of the one-pass approach with 1, 50 and 250
+	 * point lights, when materials are fetched from the faces materials buffer
+	 * and when they are read from the provoking vertices, and appends them to
+	 * `out/materials.csv`.
+	 * 
+	 */
+	void BenchmarkMaterialsLookup();
+
 	/**
 	 * @brief Pointer to the GLFW window manager.
 	 * 
@@ -486,12 +706,43 @@ private:
 	 */
 	bool forceUnsortedMeshMode = false;
 
+	/**
+	 * @brief Whether meshes' vertices are uploaded in a compact format or not.
+	 * 
+	 */
+	bool compactVerticesMode = false;
+
+	/**
+	 * @brief Whether meshes' vertices are stored as a structure of arrays or
+	 * not.
+	 * 
+	 */
+	bool soaVerticesMode = false;
+
+	/**
+	 * @brief Whether meshes' vertices are pulled by the vertex shaders or not.
+	 * 
+	 */
+	bool pullingVerticesMode = false;
+
 	/**
 	 * @brief Whether the app is in benchmark mode or not
 	 * 
 	 */
 	bool benchmarkMode = false;
 
+	/**
+	 * @brief Whether frames are only drawn when something changed or not.
+	 * 
+	 */
+	bool renderOnDemand = true;
+
+	/**
+	 * @brief Number of frames still to draw without waiting for events.
+	 * 
+	 */
+	unsigned int nbPendingFrames = RENDER_ON_DEMAND_NB_FRAMES;
+
 	/**
 	 * @brief Whether `ImGui`'s debug mode is on or off.
 	 * 
@@ -534,6 +785,24 @@ private:
 	 */
 	Scene* scene = nullptr;
 
+	/**
+	 * @brief Cache of linked shader programs.
+	 * 
+	 */
+	ProgramCache* programCache = nullptr;
+
+	/**
+	 * @brief Preprocessor of the shaders sources.
+	 * 
+	 */
+	ShaderPreprocessor* shaderPreprocessor = nullptr;
+
+	/**
+	 * @brief Manager of the render targets.
+	 * 
+	 */
+	RenderTargetManager* renderTargets = nullptr;
+
 	/**
 	 * @brief List of paths to the various materials to use.
 	 * 
@@ -570,6 +839,18 @@ private:
 	 */
 	ImGuiFPSModule* imguiFPS = nullptr;
 
+	/**
+	 * @brief Rendering statistics module.
+	 * 
+	 */
+	RenderingStatsModule* renderingStats = nullptr;
+
+	/**
+	 * @brief Picking module.
+	 * 
+	 */
+	PickingModule* picking = nullptr;
+
 	/**
 	 * @brief Shaders content module.
 	 * 
@@ -654,6 +935,18 @@ private:
 	 */
 	TOMLLoader toml;
 
+	/**
+	 * @brief Watcher of the files the shaders were expanded from.
+	 * 
+	 */
+	FileWatcher shadersWatcher;
+
+	/**
+	 * @brief Reload shaders when their files are modified.
+	 * 
+	 */
+	bool watchShaders = true;
+
 	/**
 	 * @brief initialize show tools
 	 * 
@@ -0,0 +1,255 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "opengl.h"
+
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#include "mesh.h"
+#include "occlusion.h"
+
+/**
+ * \brief List of face ranges to draw with a single `glMultiDrawElements()`.
+ *
+ * Each range is given by its number of indices and its offset (in bytes) in
+ * the face VBO it belongs to, as expected by `glMultiDrawElements()`.
+ */
+struct ClusterDrawList
+{
+	/**
+	 * \brief Number of indices of each range.
+	 */
+	std::vector<GLsizei> counts;
+	/**
+	 * \brief Offset (in bytes) of each range in its face VBO.
+	 */
+	std::vector<const void*> offsets;
+	/**
+	 * \brief Value added to the indices of each range.
+	 */
+	std::vector<GLint> baseVertices;
+};
+
+/**
+ * \brief Cluster culler.
+ *
+ * Test the clusters of a mesh against the camera frustum and their normal
+ * cones to find the ones which can be seen, and build the lists of face ranges
+ * to draw for each face VBO of the scene (a single one for one-pass rendering,
+ * one per material for per-material rendering). Ranges are sorted from the
+ * nearest to the farthest to help early depth testing.
+ *
+ * Cluster bounds are copied once in separate arrays for each component, so
+ * the tests run on contiguous data and can be vectorized by the compiler.
+ * The clusters are shared between worker threads.
+ *
+ * Clusters passing these tests can then be tested against the largest faces
+ * of the mesh with an `OcclusionCuller`.
+ */
+class ClusterCuller
+{
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * `ClusterCuller` constructor. Copy the bounds of the mesh’s clusters.
+	 *
+	 * \param mesh Mesh whose clusters are culled. It must be alive as long as
+	 *      the culler is used.
+	 */
+	ClusterCuller(Mesh* mesh);
+	/**
+	 * \brief Destructor.
+	 *
+	 * `ClusterCuller` destructor.
+	 */
+	~ClusterCuller();
+
+	/**
+	 * \brief Cull the clusters and build the draw lists.
+	 *
+	 * Find the visible clusters for the given matrices and update the draw
+	 * lists and statistics.
+	 *
+	 * \param model Transformation matrix of the mesh.
+	 * \param view View matrix of the camera.
+	 * \param projection Projection matrix of the camera.
+	 * \param orthographic Whether the projection is orthographic (`true`) or
+	 *      perspective (`false`).
+	 * \param perMaterial Whether there is one face VBO per material (`true`)
+	 *      or a single one for all faces (`false`).
+	 * \param culledFaces Faces culled by _OpenGL_ (`GL_BACK`, `GL_FRONT` or
+	 *      `GL_FRONT_AND_BACK`), or `GL_NONE` if facet culling is disabled.
+	 *      Normal cones are only tested when either back or front faces are
+	 *      culled.
+	 * \return Either if the draw lists are usable (`true`) or if the whole
+	 *      VBOs must be drawn (`false`).
+	 */
+	bool Cull(const Eigen::Matrix4f& model, const Eigen::Matrix4f& view,
+			const Eigen::Matrix4f& projection, bool orthographic,
+			bool perMaterial, GLenum culledFaces = GL_BACK);
+
+	/**
+	 * \brief Get the draw list of a face VBO.
+	 *
+	 * Return the list of ranges built by the last call to `Cull()` for the
+	 * given face VBO.
+	 *
+	 * \param vbo Index of the face VBO (relative material ID for per-material
+	 *      rendering, 0 otherwise).
+	 * \return Pointer to the draw list, `nullptr` if there is none.
+	 */
+	ClusterDrawList* GetDrawList(unsigned char vbo);
+	/**
+	 * \brief Set the format of the indices of each face VBO.
+	 *
+	 * Clusters following each other are only merged into a single range if
+	 * they share the same base vertex.
+	 *
+	 * \param indexSizes Size of an index (in bytes) in each face VBO.
+	 * \param clustersBaseVertex Value added to the indices of each cluster.
+	 */
+	void SetIndexFormats(const std::vector<unsigned char>& indexSizes,
+			const std::vector<GLint>& clustersBaseVertex);
+
+	/**
+	 * \brief Getter of the number of clusters.
+	 *
+	 * \return Number of clusters of the mesh.
+	 */
+	unsigned int GetNbClusters();
+	/**
+	 * \brief Getter of the number of visible clusters.
+	 *
+	 * \return Number of clusters kept by the last call to `Cull()`.
+	 */
+	unsigned int GetNbVisibleClusters();
+	/**
+	 * \brief Getter of the number of submitted faces.
+	 *
+	 * \return Number of faces kept by the last call to `Cull()`.
+	 */
+	unsigned int GetNbSubmittedFaces();
+	/**
+	 * \brief Getter of the number of faces culled by the frustum test.
+	 *
+	 * \return Number of faces out of the camera frustum during the last call
+	 *      to `Cull()`.
+	 */
+	unsigned int GetNbFrustumCulledFaces();
+	/**
+	 * \brief Getter of the number of faces culled by the normal cone test.
+	 *
+	 * \return Number of faces facing away from the camera during the last
+	 *      call to `Cull()`.
+	 */
+	unsigned int GetNbBackfaceCulledFaces();
+	/**
+	 * \brief Getter of the number of faces culled by the occlusion test.
+	 *
+	 * \return Number of faces hidden behind occluders during the last call to
+	 *      `Cull()`.
+	 */
+	unsigned int GetNbOccludedFaces();
+	/**
+	 * \brief Getter of the time spent culling.
+	 *
+	 * \return Duration of the last call to `Cull()`, in milliseconds.
+	 */
+	float GetCullingTime();
+
+	/**
+	 * \brief Getter of the occlusion culler.
+	 *
+	 * \return Pointer to the occlusion culler, `nullptr` if there is none.
+	 */
+	OcclusionCuller* GetOcclusionCuller();
+	/**
+	 * \brief Check if occlusion culling is enabled.
+	 *
+	 * \return Either if clusters are tested against occluders (`true`) or not
+	 *      (`false`).
+	 */
+	bool IsOcclusionCullingEnabled();
+	/**
+	 * \brief Enable or disable occlusion culling.
+	 *
+	 * \param enabled Whether clusters should be tested against occluders.
+	 */
+	void SetOcclusionCulling(bool enabled);
+
+private:
+	/**
+	 * \brief Build the draw lists from the visibility of each cluster.
+	 *
+	 * \param perMaterial Whether there is one face VBO per material.
+	 */
+	void BuildDrawLists(bool perMaterial);
+
+	/**
+	 * \brief Mesh whose clusters are culled.
+	 */
+	Mesh* mesh = nullptr;
+	/**
+	 * \brief Number of clusters of the mesh.
+	 */
+	unsigned int nbClusters = 0;
+
+	/* Clusters’ bounds (one array per component) */
+
+	std::vector<float> centersX;
+	std::vector<float> centersY;
+	std::vector<float> centersZ;
+	std::vector<float> radii;
+	std::vector<float> coneAxesX;
+	std::vector<float> coneAxesY;
+	std::vector<float> coneAxesZ;
+	std::vector<float> coneCutoffs;
+
+	/* Format of the face VBOs (32-bit indices without base if empty) */
+
+	std::vector<unsigned char> vbosIndexSize;
+	std::vector<GLint> clustersBaseVertex;
+
+	/* Results of the last culling */
+
+	/**
+	 * \brief Visibility of each cluster.
+	 *
+	 * 0 if visible, 1 if out of the frustum, 2 if facing away from the camera,
+	 * 3 if hidden behind occluders.
+	 */
+	std::vector<unsigned char> visibility;
+	/**
+	 * \brief Depth of each cluster’s center in view space.
+	 */
+	std::vector<float> depths;
+	/**
+	 * \brief Visible clusters sorted by face VBO and depth.
+	 */
+	std::vector<unsigned int> visibleClusters;
+	/**
+	 * \brief Draw list of each face VBO.
+	 */
+	std::vector<ClusterDrawList> drawLists;
+
+	unsigned int nbVisibleClusters = 0;
+	unsigned int nbSubmittedFaces = 0;
+	unsigned int nbFrustumCulledFaces = 0;
+	unsigned int nbBackfaceCulledFaces = 0;
+	unsigned int nbOccludedFaces = 0;
+	float cullingTime = 0.;
+
+	/**
+	 * \brief Occlusion culler using the largest faces of the mesh.
+	 */
+	OcclusionCuller* occlusionCuller = nullptr;
+	/**
+	 * \brief Whether clusters are tested against occluders.
+	 */
+	bool occlusionCulling = true;
+};
+
+#endif // CULLING_H
@@ -0,0 +1,84 @@
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Minimum time between two checks of the files’ modification times (in ms)
+#define FILE_WATCHER_POLL_INTERVAL	500
+
+/**
+ * \brief Watcher of files modifications.
+ *
+ * On Linux, the directories of the watched files are watched with inotify, so
+ * that files replaced by editors (written to a temporary file, then renamed)
+ * are still detected. On other systems, or if inotify can’t be used, the
+ * modification times of the files are compared at most every
+ * `FILE_WATCHER_POLL_INTERVAL` ms.
+ */
+class FileWatcher
+{
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * `FileWatcher` constructor. No file is watched yet.
+	 */
+	FileWatcher();
+	/**
+	 * \brief Destructor.
+	 *
+	 * `FileWatcher` destructor. Stop watching all files.
+	 */
+	~FileWatcher();
+
+	/**
+	 * \brief Start watching a file.
+	 *
+	 * Files already watched are skipped.
+	 *
+	 * \param path Path of the file.
+	 */
+	void Watch(const std::string& path);
+	/**
+	 * \brief Stop watching all files.
+	 */
+	void Clear();
+	/**
+	 * \brief Get the files modified since the last call.
+	 *
+	 * \return Paths of the modified files (as given to `Watch()`), each one
+	 * only once.
+	 */
+	std::vector<std::string> Poll();
+
+	/**
+	 * \brief Getter of the number of watched files.
+	 *
+	 * \return Number of files given to `Watch()`.
+	 */
+	unsigned int GetNbWatchedFiles() const;
+	/**
+	 * \brief Check if files are watched with inotify.
+	 *
+	 * \return True with inotify, false if modification times are compared.
+	 */
+	bool IsUsingNotifications() const;
+
+private:
+	// Watched files, with their last known modification time
+	std::unordered_map<std::string, time_t> files;
+	std::chrono::steady_clock::time_point lastPoll;
+
+	// inotify instance (-1 if unused) and watched directories, by watch
+	// descriptor and by path (with their trailing delimiter, if any)
+	int notifyID = -1;
+	std::unordered_map<int, std::vector<std::string>> directories;
+	std::unordered_set<std::string> directoriesPaths;
+};
+
+#endif // FILEWATCHER_H
@@ -5,6 +5,11 @@
 
 #include <Eigen/Geometry>
 
+#define MESH_CLUSTER_MAX_FACES 128
+
+class BVH;
+class MeshAdjacency;
+
 /**
  * @brief Holds all mesh data loaded from the PLYReader class.
  * 
@@ -156,6 +161,65 @@ struct Vertex
 			const Eigen::Vector3f &normal);
 };
 
+/**
+ * @brief Stores a small group of neighbouring faces of the mesh.
+ * 
+ * Clusters split each range of faces sharing a material into groups of at
+ * most MESH_CLUSTER_MAX_FACES faces, stored one after the other in the mesh's
+ * facesVertices array. Each cluster stores its bounds so it can be culled as a
+ * whole.
+ * 
+ * The cluster is facing away from a camera at position `eye` (and can be
+ * skipped) if:
+ * `(center - eye).dot(coneAxis) >= coneCutoff * (center - eye).norm() + radius`
+ */
+struct MeshCluster
+{
+	/**
+	 * @brief Center of the bounding sphere of the cluster.
+	 * 
+	 */
+	Eigen::Vector3f center;
+	/**
+	 * @brief Radius of the bounding sphere of the cluster.
+	 * 
+	 */
+	float radius;
+	/**
+	 * @brief 3D box containing all of the cluster's vertices.
+	 * 
+	 */
+	Eigen::AlignedBox3f boundingBox;
+	/**
+	 * @brief Mean direction of the cluster's faces' normals.
+	 * 
+	 */
+	Eigen::Vector3f coneAxis;
+	/**
+	 * @brief Sine of the angle between the cone axis and the farthest face
+	 * normal.
+	 * 
+	 * Set to 1 if the normals are too spread for the cluster to ever be
+	 * backfacing.
+	 */
+	float coneCutoff;
+	/**
+	 * @brief Index of the first face of the cluster.
+	 * 
+	 */
+	unsigned int firstFace;
+	/**
+	 * @brief Number of faces in the cluster.
+	 * 
+	 */
+	unsigned int nbFaces;
+	/**
+	 * @brief Material ID shared by all of the cluster's faces.
+	 * 
+	 */
+	unsigned char material;
+};
+
 /**
  * @brief Stores the main mesh to display in the application.
  * 
@@ -169,21 +233,35 @@ public:
 	 * @brief Construct a new Mesh object using the current context and data
 	 * read from a PLY file.
 	 * 
+	 * Vertices are stored as a structure of arrays if soa is true or if the
+	 * context asks for it, as an array of Vertex structures otherwise.
+	 * 
 	 * @param context Context of the application.
 	 * @param data Mesh data read from an input PLY file.
+	 * @param soa True if the vertices' attributes should be stored in
+	 * separate arrays, false otherwise.
 	 */
-	Mesh(void* context, MeshData* data);
+	Mesh(void* context, MeshData* data, bool soa = false);
 	/**
 	 * @brief Construct a new Mesh object using another Mesh object.
 	 * 
 	 * @param mesh Mesh object to copy.
 	 */
 	Mesh(Mesh* mesh);
+	/**
+	 * @brief Construct a new Mesh object using another Mesh object, with
+	 * another layout of vertices.
+	 * 
+	 * @param mesh Mesh object to copy.
+	 * @param soa True if the vertices' attributes should be stored in
+	 * separate arrays, false otherwise.
+	 */
+	Mesh(Mesh* mesh, bool soa);
 	/**
 	 * @brief Destroy the Mesh object.
 	 * 
-	 * Also frees verticesData, facesVertices, facesMaterials and
-	 * nbFacesPerMaterial if they exist and haven't been freed.
+	 * Also frees the vertices' arrays, facesVertices, facesMaterials,
+	 * nbFacesPerMaterial and clusters if they exist and haven't been freed.
 	 */
 	~Mesh();
 
@@ -238,6 +316,75 @@ public:
 	 * @return false The msh's faces aren't sorted by material.
 	 */
 	bool IsSorted();
+	/**
+	 * @brief Checks whether the vertices are stored as a structure of arrays
+	 * or not.
+	 * 
+	 * @return true Positions, normals and colors are stored in separate
+	 * arrays (and colors only if the mesh has some).
+	 * @return false Vertices are stored in verticesData.
+	 */
+	bool IsSoA();
+
+	/**
+	 * @brief Gets the array of the vertices' positions.
+	 * 
+	 * Positions of consecutive vertices are GetVerticesStride() vectors away
+	 * from each other.
+	 * 
+	 * @return const Eigen::Vector3f* Position of the first vertex.
+	 */
+	const Eigen::Vector3f* GetPositions();
+	/**
+	 * @brief Gets the array of the vertices' normals.
+	 * 
+	 * @return const Eigen::Vector3f* Normal of the first vertex.
+	 */
+	const Eigen::Vector3f* GetNormals();
+	/**
+	 * @brief Gets the array of the vertices' colors.
+	 * 
+	 * @return const Eigen::Vector3f* Color of the first vertex, or nullptr if
+	 * colors are not stored (the mesh has no colors and is stored as a
+	 * structure of arrays).
+	 */
+	const Eigen::Vector3f* GetColors();
+	/**
+	 * @brief Gets the distance between the attributes of two consecutive
+	 * vertices.
+	 * 
+	 * @return unsigned int 1 for a structure of arrays, 3 for verticesData
+	 * (in number of vectors).
+	 */
+	unsigned int GetVerticesStride();
+	/**
+	 * @brief Gets the position of a vertex.
+	 * 
+	 * @param vertex Index of the vertex.
+	 * @return const Eigen::Vector3f& Position of the vertex.
+	 */
+	const Eigen::Vector3f& GetPosition(unsigned int vertex);
+	/**
+	 * @brief Gets the normal of a vertex.
+	 * 
+	 * @param vertex Index of the vertex.
+	 * @return const Eigen::Vector3f& Normal of the vertex.
+	 */
+	const Eigen::Vector3f& GetNormal(unsigned int vertex);
+	/**
+	 * @brief Gets the color of a vertex.
+	 * 
+	 * @param vertex Index of the vertex.
+	 * @return const Eigen::Vector3f& Color of the vertex, or the default color
+	 * if colors are not stored.
+	 */
+	const Eigen::Vector3f& GetColor(unsigned int vertex);
+	/**
+	 * @brief Gets the memory used by the vertices' attributes.
+	 * 
+	 * @return size_t Size of the vertices' arrays, in bytes.
+	 */
+	size_t GetVerticesMemorySize();
 
 	/**
 	 * @brief Gets the bounding box of the entire mesh.
@@ -258,6 +405,50 @@ public:
 	 */
 	Eigen::AlignedBox1i GetMaterialsRange();
 
+	/**
+	 * @brief Splits the mesh's faces into clusters.
+	 * 
+	 * Splits each range of faces sharing a material into clusters of at most
+	 * maxFaces faces and computes their bounds. Faces of large ranges are
+	 * first reordered along a space-filling curve so that each cluster is
+	 * compact. The work is shared between worker threads but the result
+	 * doesn't depend on their number.
+	 * 
+	 * Called at load time, but can be called again to change the size of the
+	 * clusters.
+	 * 
+	 * @param maxFaces Maximum number of faces per cluster.
+	 */
+	void ComputeClusters(unsigned int maxFaces = MESH_CLUSTER_MAX_FACES);
+
+	/**
+	 * @brief Computes the mesh's bounding box and its vertices' normals again.
+	 * 
+	 * Called at load time, and to measure both passes in each layout of
+	 * vertices.
+	 */
+	void ComputeBoundsAndNormals();
+
+	/**
+	 * @brief Gets the bounding volume hierarchy of the mesh's faces.
+	 * 
+	 * Builds it the first time it is needed, then keeps it until the faces
+	 * are reordered.
+	 * 
+	 * @return BVH* Hierarchy used for ray queries on the mesh.
+	 */
+	BVH* GetBVH();
+	/**
+	 * @brief Gets the adjacency of the mesh's vertices and faces.
+	 * 
+	 * Builds it the first time it is needed, then keeps it until the faces
+	 * are reordered.
+	 * 
+	 * @return MeshAdjacency* Faces around each vertex and neighbors of each
+	 * face.
+	 */
+	MeshAdjacency* GetAdjacency();
+
 	/**
 	 * @brief Gets the context of the application.
 	 * 
@@ -272,7 +463,8 @@ public:
 	 * @brief Array of vertices in the mesh.
 	 * 
 	 * Contains a list of all of he mesh's vertices (and their position, color
-	 * and normal).
+	 * and normal). nullptr if the vertices are stored as a structure of arrays,
+	 * use GetPositions(), GetNormals() and GetColors() to handle both layouts.
 	 */
 	Vertex* verticesData = nullptr;
 	/**
@@ -317,17 +509,35 @@ public:
 	 */
 	unsigned int* nbFacesPerMaterial = nullptr;
 
+	/**
+	 * @brief Array of clusters of the mesh.
+	 * 
+	 * Clusters are stored in the same order as their faces in facesVertices.
+	 */
+	MeshCluster* clusters = nullptr;
+	/**
+	 * @brief Number of clusters of the mesh.
+	 * 
+	 */
+	unsigned int nbClusters = 0;
+
 private:
 	/**
 	 * @brief Initializes the class by loading all the data from a MeshData
 	 * object.
 	 * 
-	 * Copies the data from the MeshData object, then computes the normals of
-	 * each element, as well as its bounding box.
+	 * Copies the data from the MeshData object, then computes its bounding
+	 * box, its clusters and the normals of its vertices.
 	 * 
 	 * @param data Data loaded from an input PLY file.
 	 */
 	void Init(MeshData* data);
+	/**
+	 * @brief Allocates the arrays of nbVertices vertices in the chosen layout.
+	 * 
+	 * Normals (and colors, if the mesh has none) are set to 0.
+	 */
+	void AllocateVertices();
 
 	/**
 	 * @brief Copies the data from a MeshData object.
@@ -345,8 +555,21 @@ private:
 	/**
 	 * @brief Computes the mesh's vertices' normals.
 	 * 
+	 * Each vertex gathers the normals of the faces around it, weighted by
+	 * their area, using a temporary list of the faces around each vertex
+	 * (the mesh's full adjacency isn't built). Vertices are shared between
+	 * worker threads, and each one only writes its own normal.
+	 * 
 	 */
 	void ComputeNormals();
+	/**
+	 * @brief Computes the (non-normalized) normal of a face.
+	 * 
+	 * @param face Pointer to the three vertex indexes of the face.
+	 * @return Eigen::Vector3f Normal of the face, whose norm is twice the area
+	 * of the face.
+	 */
+	Eigen::Vector3f GetFaceNormal(unsigned int* face);
 	/**
 	 * @brief Computes the mesh's bounding box.
 	 * 
@@ -373,6 +596,39 @@ private:
 	 */
 	bool isSorted = false;
 
+	/**
+	 * @brief Whether the vertices are stored as a structure of arrays or not.
+	 * 
+	 */
+	bool soa = false;
+	/**
+	 * @brief Positions of the vertices, in verticesData or in their own array.
+	 * 
+	 */
+	Eigen::Vector3f* verticesPositions = nullptr;
+	/**
+	 * @brief Normals of the vertices, in verticesData or in their own array.
+	 * 
+	 */
+	Eigen::Vector3f* verticesNormals = nullptr;
+	/**
+	 * @brief Colors of the vertices, in verticesData or in their own array
+	 * (which is only allocated if the mesh has colors).
+	 * 
+	 */
+	Eigen::Vector3f* verticesColors = nullptr;
+	/**
+	 * @brief Number of vectors between the attributes of two consecutive
+	 * vertices.
+	 * 
+	 */
+	unsigned int verticesStride = 3;
+	/**
+	 * @brief Color of the vertices if the mesh has no colors.
+	 * 
+	 */
+	Eigen::Vector3f defaultColor = Eigen::Vector3f::Constant(0);
+
 	/**
 	 * @brief Context of the application.
 	 * 
@@ -394,6 +650,18 @@ private:
 	 * 
 	 */
 	Eigen::AlignedBox1i materialsRange;
+
+	/**
+	 * @brief Bounding volume hierarchy of the faces, nullptr until it is
+	 * needed.
+	 * 
+	 */
+	BVH* bvh = nullptr;
+	/**
+	 * @brief Adjacency of the vertices and faces, nullptr until it is needed.
+	 * 
+	 */
+	MeshAdjacency* adjacency = nullptr;
 };
 
 #endif // MESH_H
@@ -0,0 +1,107 @@
+#ifndef MODULES_PICKING_H
+#define MODULES_PICKING_H
+
+#include "bvh.h"
+#include "modules/module.h"
+
+/**
+ * \brief Picking module for _Dear ImGui_.
+ * 
+ * Module that shows which face of the mesh was last picked with the mouse in
+ * the viewer, and the state of the hierarchy used to find it.
+ */
+class PickingModule: public GUIModule
+{
+public:
+	/**
+	 * \brief Constructor.
+	 * 
+	 * `PickingModule` constructor.
+	 * 
+	 * \param context Application context using this module. The mesh is read
+	 *      from its scene.
+	 */
+	PickingModule(void* context);
+	/**
+	 * \brief Constructor by duplication.
+	 * 
+	 * `PickingModule` constructor using an existing object that would be
+	 * duplicated.
+	 * 
+	 * \param module Module to duplicate.
+	 */
+	PickingModule(PickingModule* module);
+	/**
+	 * \brief Destructor.
+	 * 
+	 * `PickingModule` destructor.
+	 */
+	~PickingModule();
+
+	/**
+	 * \brief Render the module.
+	 * 
+	 * Call _Dear ImGui_ instructions to render the module.
+	 */
+	void Render();
+
+	/**
+	 * \brief Set the result of the last pick.
+	 * 
+	 * \param found Whether a face was under the cursor.
+	 * \param hit Face found and position of the hit point.
+	 * \param queryTime Duration of the query, in milliseconds.
+	 */
+	void SetResult(bool found, const RayHit& hit, float queryTime);
+	/**
+	 * \brief Forget the result of the last pick.
+	 * 
+	 * Needed when another mesh is loaded.
+	 */
+	void ClearResult();
+
+	/**
+	 * \brief Getter of `picked`.
+	 * 
+	 * \return Whether a pick was made since the mesh was loaded.
+	 */
+	bool IsPicked();
+	/**
+	 * \brief Getter of `found`.
+	 * 
+	 * \return Whether a face was under the cursor during the last pick.
+	 */
+	bool IsFound();
+	/**
+	 * \brief Getter of `hit`.
+	 * 
+	 * \return Face found during the last pick.
+	 */
+	const RayHit& GetHit();
+	/**
+	 * \brief Getter of `queryTime`.
+	 * 
+	 * \return Duration of the last query, in milliseconds.
+	 */
+	float GetQueryTime();
+
+private:
+	/**
+	 * \brief Whether a pick was made since the mesh was loaded.
+	 */
+	bool picked = false;
+	/**
+	 * \brief Whether a face was under the cursor during the last pick.
+	 */
+	bool found = false;
+	/**
+	 * \brief Face found during the last pick.
+	 */
+	RayHit hit;
+	/**
+	 * \brief Duration of the last query, in milliseconds.
+	 */
+	float queryTime = 0.;
+};
+
+#endif // MODULES_PICKING_H
@@ -0,0 +1,48 @@
+#ifndef MODULES_RENDERINGSTATS_H
+#define MODULES_RENDERINGSTATS_H
+
+#include "modules/module.h"
+
+/**
+ * \brief Rendering statistics module for _Dear ImGui_.
+ * 
+ * Module that shows how much of the mesh is sent to the GPU each frame, and
+ * how much is culled on the CPU.
+ */
+class RenderingStatsModule: public GUIModule
+{
+public:
+	/**
+	 * \brief Constructor.
+	 * 
+	 * `RenderingStatsModule` constructor.
+	 * 
+	 * \param context Application context using this module. Statistics are
+	 *      read from its scene.
+	 */
+	RenderingStatsModule(void* context);
+	/**
+	 * \brief Constructor by duplication.
+	 * 
+	 * `RenderingStatsModule` constructor using an existing object that would
+	 * be duplicated.
+	 * 
+	 * \param module Module to duplicate.
+	 */
+	RenderingStatsModule(RenderingStatsModule* module);
+	/**
+	 * \brief Destructor.
+	 * 
+	 * `RenderingStatsModule` destructor.
+	 */
+	~RenderingStatsModule();
+
+	/**
+	 * \brief Render the module.
+	 * 
+	 * Call _Dear ImGui_ instructions to render the module.
+	 */
+	void Render();
+};
+
+#endif // MODULES_RENDERINGSTATS_H
@@ -69,6 +69,16 @@ public:
 	 * \return Value of the `renderer` field.
 	 */
 	Renderer* GetRenderer();
+	/**
+	 * \brief Getter of `sceneRendered`.
+	 * 
+	 * Return the value of the `sceneRendered` field, corresponding to whether
+	 * the last call to `Render()` rendered the scene again or showed the
+	 * previous render.
+	 * 
+	 * \return Value of the `sceneRendered` field.
+	 */
+	bool WasSceneRendered();
 
 	/**
 	 * \brief Setter of `renderer`.
@@ -98,6 +108,13 @@ private:
 	 * instruction.
 	 */
 	Renderer* renderer = nullptr;
+	/**
+	 * \brief Whether the scene was rendered by the last frame.
+	 * 
+	 * With render on demand, the scene is only rendered when it changed,
+	 * otherwise the texture of the previous render is shown again.
+	 */
+	bool sceneRendered = false;
 
 	/**
 	 * \brief Flags describing style of the _ImGui_ subwindow.
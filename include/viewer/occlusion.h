@@ -0,0 +1,170 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include "opengl.h"
+
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#include "mesh.h"
+
+#define OCCLUSION_DEFAULT_WIDTH			256
+#define OCCLUSION_DEFAULT_HEIGHT		128
+#define OCCLUSION_DEFAULT_NB_OCCLUDERS	4096
+
+/**
+ * \brief Software occlusion culler.
+ *
+ * Rasterize the largest faces of a mesh (the occluders) into a small depth
+ * buffer on the CPU, then test bounding boxes against a hierarchical depth
+ * pyramid built from it to know if they are hidden behind the occluders.
+ *
+ * Everything is done on the CPU without any graphics API, and the work is
+ * shared between worker threads: each thread rasterizes the occluders in its
+ * own band of rows. Occluders are stored at the farthest depth they reach in
+ * each pixel, and tested boxes are grown by a pixel, so that a visible box is
+ * not reported as hidden.
+ *
+ * Depths are normalized device coordinates (smaller is nearer).
+ */
+class OcclusionCuller
+{
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	/**
+	 * \brief Constructor.
+	 *
+	 * `OcclusionCuller` constructor. Choose the occluders of the mesh.
+	 *
+	 * \param mesh Mesh whose faces are used as occluders. It must be alive as
+	 *      long as the culler is used.
+	 * \param width Width of the depth buffer.
+	 * \param height Height of the depth buffer.
+	 * \param maxNbOccluders Maximum number of faces used as occluders.
+	 */
+	OcclusionCuller(Mesh* mesh,
+			unsigned int width = OCCLUSION_DEFAULT_WIDTH,
+			unsigned int height = OCCLUSION_DEFAULT_HEIGHT,
+			unsigned int maxNbOccluders = OCCLUSION_DEFAULT_NB_OCCLUDERS);
+	/**
+	 * \brief Destructor.
+	 *
+	 * `OcclusionCuller` destructor.
+	 */
+	~OcclusionCuller();
+
+	/**
+	 * \brief Rasterize the occluders.
+	 *
+	 * Clear the depth buffer, rasterize the occluders seen through the given
+	 * transformation and build the depth pyramid. Occluders whose side is
+	 * culled are skipped, as _OpenGL_ won’t draw them.
+	 *
+	 * \param transformation Transformation from the mesh’s space to clip
+	 *      space (projection * view * model).
+	 * \param culledFaces Faces culled by _OpenGL_ (`GL_BACK`, `GL_FRONT` or
+	 *      `GL_FRONT_AND_BACK`), or `GL_NONE` if facet culling is disabled.
+	 */
+	void Render(const Eigen::Matrix4f& transformation,
+			GLenum culledFaces = GL_BACK);
+	/**
+	 * \brief Test if a box can be seen.
+	 *
+	 * Test a box against the depth pyramid built by the last call to
+	 * `Render()`. Boxes crossing the near plane are always visible.
+	 * This function can be called from several threads at once.
+	 *
+	 * \param box Box in the mesh’s space.
+	 * \return Either if the box may be visible (`true`) or if it is hidden
+	 *      behind the occluders (`false`).
+	 */
+	bool IsVisible(const Eigen::AlignedBox3f& box) const;
+
+	/**
+	 * \brief Getter of the width of the depth buffer.
+	 *
+	 * \return Width of the depth buffer, in pixels.
+	 */
+	unsigned int GetWidth() const;
+	/**
+	 * \brief Getter of the height of the depth buffer.
+	 *
+	 * \return Height of the depth buffer, in pixels.
+	 */
+	unsigned int GetHeight() const;
+	/**
+	 * \brief Getter of the depth buffer.
+	 *
+	 * \return Depth of each pixel, row by row from the bottom of the screen.
+	 */
+	const float* GetDepthBuffer() const;
+	/**
+	 * \brief Getter of the number of occluders.
+	 *
+	 * \return Number of faces used as occluders.
+	 */
+	unsigned int GetNbOccluders() const;
+	/**
+	 * \brief Getter of the number of rasterized occluders.
+	 *
+	 * \return Number of occluders in front of the camera during the last call
+	 *      to `Render()`.
+	 */
+	unsigned int GetNbRasterizedOccluders() const;
+
+private:
+	/**
+	 * \brief Rasterize the occluders in a band of rows.
+	 *
+	 * \param firstRow First row of the band.
+	 * \param lastRow Row after the last one of the band.
+	 */
+	void RasterizeBand(unsigned int firstRow, unsigned int lastRow);
+	/**
+	 * \brief Build the levels of the depth pyramid from the depth buffer.
+	 */
+	void BuildPyramid();
+
+	/**
+	 * \brief Mesh whose faces are used as occluders.
+	 */
+	Mesh* mesh = nullptr;
+
+	unsigned int width;
+	unsigned int height;
+
+	/**
+	 * \brief Faces used as occluders, from the largest to the smallest.
+	 */
+	std::vector<unsigned int> occluders;
+
+	/* Occluders’ vertices in screen space (one array per component) */
+
+	std::vector<float> screenX;
+	std::vector<float> screenY;
+	std::vector<float> screenZ;
+	/**
+	 * \brief Whether each occluder is rasterized.
+	 */
+	std::vector<unsigned char> rasterized;
+	unsigned int nbRasterizedOccluders = 0;
+
+	/**
+	 * \brief Transformation used by the last call to `Render()`.
+	 */
+	Eigen::Matrix4f transformation;
+
+	/**
+	 * \brief Levels of the depth pyramid.
+	 *
+	 * The first level is the depth buffer, and each other level keeps the
+	 * farthest depth of 2x2 pixels of the previous one.
+	 */
+	std::vector<std::vector<float>> levels;
+	std::vector<unsigned int> levelsWidth;
+	std::vector<unsigned int> levelsHeight;
+};
+
+#endif // OCCLUSION_H
@@ -0,0 +1,85 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <functional>
+
+/**
+ * \brief Get the number of threads used by parallel loops.
+ *
+ * Return the number of threads (including the calling one) that share the
+ * work of `ParallelFor()`. It is based on the number of hardware threads and
+ * is at least 1.
+ *
+ * \return Number of threads used by parallel loops.
+ */
+unsigned int GetNbWorkerThreads();
+
+/**
+ * \brief Run a function over a range of indices using the worker threads.
+ *
+ * Split the range `[begin, end)` into contiguous blocks and call `function`
+ * once per block with the bounds of the block. The blocks only depend on the
+ * size of the range, `grainSize` and the number of worker threads, so the
+ * same range is always split the same way.
+ * The calling thread takes part in the work and the function returns once
+ * every block is done. It can be called from inside another parallel loop.
+ *
+ * \param begin First index of the range.
+ * \param end Index after the last one of the range.
+ * \param function Function called for each block, with the first index of
+ *      the block and the index after its last one.
+ * \param grainSize Minimum number of indices per block (default: 1).
+ */
+void ParallelFor(unsigned int begin, unsigned int end,
+		const std::function<void(unsigned int, unsigned int)>& function,
+		unsigned int grainSize = 1);
+
+/**
+ * \brief Sort an array using the worker threads.
+ *
+ * Sort blocks of the array in parallel, then merge them two by two.
+ * The result is the same as `std::stable_sort()` with the same comparison.
+ *
+ * \param begin Pointer to the first element of the array.
+ * \param end Pointer after the last element of the array.
+ * \param compare Comparison function (as used by `std::sort()`).
+ */
+template<class T, class Compare>
+void ParallelSort(T* begin, T* end, Compare compare) {
+	unsigned int size = (unsigned int) (end - begin);
+	unsigned int nbBlocks = GetNbWorkerThreads();
+	if ((nbBlocks < 2) || (size < (2 * 4096))) {
+		std::stable_sort(begin, end, compare);
+		return;
+	}
+
+	// Find where a block starts
+	auto blockStart = [&](unsigned int b) {
+		return begin + (unsigned int) ((unsigned long long) size * b / nbBlocks);
+	};
+
+	// Sort each block on its own
+	ParallelFor(0, nbBlocks, [&](unsigned int first, unsigned int last) {
+		for (unsigned int b = first; b < last; b++)
+			std::stable_sort(blockStart(b), blockStart(b + 1), compare);
+	});
+
+	// Merge neighbouring blocks until there is only one left
+	for (unsigned int width = 1; width < nbBlocks; width *= 2) {
+		unsigned int nbMerges = (nbBlocks + (2 * width) - 1) / (2 * width);
+		ParallelFor(0, nbMerges, [&](unsigned int first, unsigned int last) {
+			for (unsigned int m = first; m < last; m++) {
+				unsigned int left = 2 * width * m;
+				unsigned int middle = std::min(left + width, nbBlocks);
+				unsigned int right = std::min(left + (2 * width), nbBlocks);
+				if (middle == right)
+					continue;
+				std::inplace_merge(blockStart(left), blockStart(middle),
+						blockStart(right), compare);
+			}
+		});
+	}
+}
+
+#endif // PARALLEL_H
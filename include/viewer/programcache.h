@@ -0,0 +1,363 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include "opengl.h"
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define PROGRAM_CACHE_DEFAULT_CAPACITY	64
+// Directory of the program binaries kept between runs
+#define PROGRAM_BINARIES_DIR			"cache/"
+// Header of the program binary files (changed with their layout)
+#define PROGRAM_BINARY_MAGIC			"3DVPRGB1"
+
+/**
+ * \brief Linked program kept by a `ProgramCache`.
+ */
+struct ProgramCacheEntry
+{
+	/**
+	 * \brief Vertex shader source, once macros and materials are expanded.
+	 */
+	std::string vertexSource;
+	/**
+	 * \brief Fragment shader source, once macros and materials are expanded.
+	 */
+	std::string fragmentSource;
+	/**
+	 * \brief Hash of both sources.
+	 */
+	size_t hash = 0;
+	/**
+	 * \brief Linked program.
+	 */
+	GLuint programID = 0;
+	/**
+	 * \brief Number of shaders readers using the program.
+	 */
+	unsigned int nbUsers = 0;
+};
+
+/**
+ * \brief Compiled shader object shared by the programs of a `ProgramCache`.
+ */
+struct ShaderCacheEntry
+{
+	/**
+	 * \brief Type of the shader (vertex or fragment).
+	 */
+	GLenum type;
+	/**
+	 * \brief Shader source, once macros and materials are expanded.
+	 */
+	std::string source;
+	/**
+	 * \brief Hash of the type and the source.
+	 */
+	size_t hash = 0;
+	/**
+	 * \brief Number of programs (being) linked with the shader.
+	 */
+	unsigned int nbUsers = 0;
+};
+
+/**
+ * \brief Cache of linked shader programs.
+ *
+ * Programs are identified by their final sources, which already contain the
+ * preprocessor macros and the materials, so switching back to a previous
+ * configuration (lights, materials, rendering mode) reuses its program
+ * instead of compiling it again. Shaders readers with the same sources also
+ * share a single program.
+ *
+ * The cache owns its programs. Programs still used are always kept; unused
+ * ones are deleted from the least recently used one when the cache holds more
+ * programs than its capacity.
+ *
+ * Compiled shader objects are shared too, as long as a program uses them:
+ * per-material programs only differ by their fragment shader, so their vertex
+ * shader is compiled once.
+ *
+ * When the driver supports program binaries, linked programs are also saved
+ * in a directory so that later runs load them instead of compiling their
+ * sources. Each file keeps the sources and the driver it was linked with, and
+ * is ignored if they don't match anymore.
+ */
+class ProgramCache
+{
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * `ProgramCache` constructor.
+	 *
+	 * \param capacity Number of programs kept when some of them are unused.
+	 */
+	ProgramCache(unsigned int capacity = PROGRAM_CACHE_DEFAULT_CAPACITY);
+	/**
+	 * \brief Destructor.
+	 *
+	 * `ProgramCache` destructor. Delete all programs and shader objects, even
+	 * if they are used.
+	 */
+	~ProgramCache();
+
+	/**
+	 * \brief Find a program linked from the same sources.
+	 *
+	 * Count a hit or a miss. On a hit, the program gets a new user, which must
+	 * call `Release()` once it doesn't use it anymore.
+	 *
+	 * \param vertexSource Final vertex shader source.
+	 * \param fragmentSource Final fragment shader source.
+	 * \return Program found, 0 if there is none.
+	 */
+	GLuint Acquire(const std::string& vertexSource,
+			const std::string& fragmentSource);
+	/**
+	 * \brief Add a newly linked program.
+	 *
+	 * The cache takes the ownership of the program, whose first user is the
+	 * caller.
+	 *
+	 * \param vertexSource Final vertex shader source.
+	 * \param fragmentSource Final fragment shader source.
+	 * \param programID Linked program.
+	 */
+	void Add(const std::string& vertexSource,
+			const std::string& fragmentSource, GLuint programID);
+	/**
+	 * \brief Stop using a program.
+	 *
+	 * \param programID Program given by `Acquire()` or added by `Add()`.
+	 */
+	void Release(GLuint programID);
+	/**
+	 * \brief Get a shader object compiled from a source.
+	 *
+	 * The shader is compiled if no program uses the same source yet. Its
+	 * compilation status isn't checked, so that the driver can compile it
+	 * while other shaders are submitted. The caller must call
+	 * `ReleaseShader()` once it doesn't use it anymore.
+	 *
+	 * \param type Type of the shader (vertex or fragment).
+	 * \param source Final shader source.
+	 * \return Shader object.
+	 */
+	GLuint AcquireShader(GLenum type, const std::string& source);
+	/**
+	 * \brief Stop using a shader object.
+	 *
+	 * The shader is deleted once it has no user anymore.
+	 *
+	 * \param shaderID Shader given by `AcquireShader()`.
+	 */
+	void ReleaseShader(GLuint shaderID);
+	/**
+	 * \brief Delete all unused programs.
+	 */
+	void Clear();
+	/**
+	 * \brief Reset the numbers of hits and misses.
+	 *
+	 * Loading times, numbers of programs compiled and loaded from binaries
+	 * and numbers of shader objects compiled and reused are reset too.
+	 */
+	void ResetStatistics();
+
+	/**
+	 * \brief Prepare a program to be saved as a binary once linked.
+	 *
+	 * \param programID Program not linked yet.
+	 */
+	void PrepareBinary(GLuint programID);
+	/**
+	 * \brief Load a program saved by a previous run.
+	 *
+	 * \param vertexSource Final vertex shader source.
+	 * \param fragmentSource Final fragment shader source.
+	 * \return Linked program, 0 if there is no binary or if the driver doesn't
+	 * accept it anymore.
+	 */
+	GLuint LoadBinary(const std::string& vertexSource,
+			const std::string& fragmentSource);
+	/**
+	 * \brief Save a linked program for the next runs.
+	 *
+	 * \param vertexSource Final vertex shader source.
+	 * \param fragmentSource Final fragment shader source.
+	 * \param programID Program linked from these sources.
+	 * \return True if the binary was written.
+	 */
+	bool SaveBinary(const std::string& vertexSource,
+			const std::string& fragmentSource, GLuint programID);
+	/**
+	 * \brief Count the time spent to get a new program.
+	 *
+	 * \param time Time from the compilation to the check of the linked
+	 * program, or to load its binary (in ms).
+	 * \param fromBinary If the program was loaded from a binary.
+	 */
+	void AddLoadingTime(float time, bool fromBinary);
+
+	/**
+	 * \brief Getter of the capacity of the cache.
+	 *
+	 * \return Number of programs kept when some of them are unused.
+	 */
+	unsigned int GetCapacity() const;
+	/**
+	 * \brief Getter of the number of programs in the cache.
+	 *
+	 * \return Number of programs, used or not.
+	 */
+	unsigned int GetSize() const;
+	/**
+	 * \brief Getter of the number of programs currently used.
+	 *
+	 * \return Number of programs with at least one user.
+	 */
+	unsigned int GetNbUsedPrograms() const;
+	/**
+	 * \brief Getter of the number of hits.
+	 *
+	 * \return Number of calls to `Acquire()` which found a program.
+	 */
+	unsigned int GetNbHits() const;
+	/**
+	 * \brief Getter of the number of misses.
+	 *
+	 * \return Number of calls to `Acquire()` which found no program.
+	 */
+	unsigned int GetNbMisses() const;
+	/**
+	 * \brief Getter of the number of shader objects currently shared.
+	 *
+	 * \return Number of shader objects with at least one user.
+	 */
+	unsigned int GetNbShaders() const;
+	/**
+	 * \brief Getter of the number of shader objects compiled.
+	 *
+	 * \return Number of calls to `AcquireShader()` which compiled a shader.
+	 */
+	unsigned int GetNbCompiledShaders() const;
+	/**
+	 * \brief Getter of the number of shader objects reused.
+	 *
+	 * \return Number of calls to `AcquireShader()` which found a shader.
+	 */
+	unsigned int GetNbReusedShaders() const;
+	/**
+	 * \brief Getter of the number of programs compiled from their sources.
+	 *
+	 * \return Number of programs compiled and linked.
+	 */
+	unsigned int GetNbCompiledPrograms() const;
+	/**
+	 * \brief Getter of the number of programs loaded from binaries.
+	 *
+	 * \return Number of programs loaded from the binaries directory.
+	 */
+	unsigned int GetNbLoadedBinaries() const;
+	/**
+	 * \brief Getter of the time spent compiling programs.
+	 *
+	 * \return Time to compile and link all compiled programs (in ms).
+	 */
+	float GetCompilationTime() const;
+	/**
+	 * \brief Getter of the time spent loading binaries.
+	 *
+	 * \return Time to load all programs loaded from binaries (in ms).
+	 */
+	float GetBinariesLoadingTime() const;
+	/**
+	 * \brief Getter of the directory of the program binaries.
+	 *
+	 * \return Directory, empty if binaries are disabled.
+	 */
+	const std::string& GetBinariesDirectory() const;
+	/**
+	 * \brief Check if program binaries are used.
+	 *
+	 * Needs a current OpenGL context.
+	 *
+	 * \return True if binaries are enabled and supported by the driver.
+	 */
+	bool UseBinaries();
+
+	/**
+	 * \brief Setter of the capacity of the cache.
+	 *
+	 * Unused programs over the new capacity are deleted.
+	 *
+	 * \param capacity Number of programs kept when some of them are unused.
+	 */
+	void SetCapacity(unsigned int capacity);
+	/**
+	 * \brief Setter of the directory of the program binaries.
+	 *
+	 * \param directory Directory, created if needed (empty to disable the
+	 * binaries).
+	 */
+	void SetBinariesDirectory(const std::string& directory);
+
+private:
+	/**
+	 * \brief Delete least recently used programs while over capacity.
+	 */
+	void Evict();
+	/**
+	 * \brief Delete a program and remove it from the cache.
+	 *
+	 * \param entry Position of the program in `entries`.
+	 */
+	void Erase(std::list<ProgramCacheEntry>::iterator entry);
+	/**
+	 * \brief Path of the binary of a program.
+	 *
+	 * \param vertexSource Final vertex shader source.
+	 * \param fragmentSource Final fragment shader source.
+	 * \return Path of the file in the binaries directory.
+	 */
+	std::string GetBinaryPath(const std::string& vertexSource,
+			const std::string& fragmentSource) const;
+
+	unsigned int capacity;
+
+	// Programs from the most recently used to the least recently used one,
+	// indexed by the hash of their sources and by their ID
+	std::list<ProgramCacheEntry> entries;
+	std::unordered_multimap<size_t, std::list<ProgramCacheEntry>::iterator>
+			entriesByHash;
+	std::unordered_map<GLuint, std::list<ProgramCacheEntry>::iterator>
+			entriesByProgram;
+
+	unsigned int nbHits = 0;
+	unsigned int nbMisses = 0;
+
+	// Shader objects indexed by their ID and by the hash of their source
+	std::unordered_map<GLuint, ShaderCacheEntry> shaders;
+	std::unordered_multimap<size_t, GLuint> shadersByHash;
+
+	unsigned int nbCompiledShaders = 0;
+	unsigned int nbReusedShaders = 0;
+
+	// Binaries kept between runs, if the driver supports them
+	// (Support is checked on first use, once an OpenGL context exists.)
+	std::string binariesDirectory = PROGRAM_BINARIES_DIR;
+	bool binariesChecked = false;
+	std::vector<GLint> binariesFormats;
+	std::string driver;
+
+	unsigned int nbCompiledPrograms = 0;
+	unsigned int nbLoadedBinaries = 0;
+	float compilationTime = 0.;
+	float binariesLoadingTime = 0.;
+};
+
+#endif // PROGRAMCACHE_H
@@ -0,0 +1,83 @@
+#ifndef PROVOKINGMATERIALS_H
+#define PROVOKINGMATERIALS_H
+
+#include <vector>
+
+#include "mesh.h"
+
+/**
+ * \brief Materials of the faces of a mesh, stored on their provoking vertex.
+ *
+ * A `flat` vertex attribute takes the value of the provoking vertex of each
+ * face, the last one by default with _OpenGL_. The vertices of each face are
+ * rotated (keeping their winding) so that its last vertex is one whose
+ * material is still free or already the one of the face. Only if none of the
+ * three is, the last one is duplicated (once per material, copies being
+ * shared by the faces of that material).
+ *
+ * Duplicated vertices are added after the ones of the mesh, in the order of
+ * `GetDuplicatedVertices()`. Faces are processed in order, so the result
+ * doesn’t depend on anything but the mesh.
+ */
+class ProvokingMaterials
+{
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * `ProvokingMaterials` constructor. Assign the materials of the faces of
+	 * a mesh to their vertices.
+	 *
+	 * \param mesh Mesh whose faces are processed.
+	 */
+	ProvokingMaterials(Mesh* mesh);
+	/**
+	 * \brief Destructor.
+	 *
+	 * `ProvokingMaterials` destructor.
+	 */
+	~ProvokingMaterials();
+
+	/**
+	 * \brief Getter of the vertices of the faces.
+	 *
+	 * \return Three vertex indexes per face, in the same order as the faces
+	 * of the mesh, the last one carrying the face material.
+	 */
+	const unsigned int* GetFacesVertices() const;
+	/**
+	 * \brief Getter of the duplicated vertices.
+	 *
+	 * \return Index of the vertex of the mesh copied by each added vertex.
+	 */
+	const std::vector<unsigned int>& GetDuplicatedVertices() const;
+	/**
+	 * \brief Getter of the materials of the vertices.
+	 *
+	 * \return Material ID of each vertex, added ones included (0 for
+	 * vertices provoking no face).
+	 */
+	const std::vector<unsigned char>& GetVerticesMaterials() const;
+	/**
+	 * \brief Getter of the number of vertices.
+	 *
+	 * \return Number of vertices of the mesh, plus the duplicated ones.
+	 */
+	unsigned int GetNbVertices() const;
+
+	/**
+	 * \brief Getter of the time spent assigning the materials.
+	 *
+	 * \return Duration of the assignment, in milliseconds.
+	 */
+	float GetComputingTime() const;
+
+private:
+	std::vector<unsigned int> facesVertices;
+	std::vector<unsigned int> duplicatedVertices;
+	std::vector<unsigned char> verticesMaterials;
+
+	float computingTime = 0.;
+};
+
+#endif // PROVOKINGMATERIALS_H
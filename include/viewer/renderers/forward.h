@@ -1,8 +1,17 @@
 #ifndef RENDERER_FORWARD_H
 #define RENDERER_FORWARD_H
 
+#include <vector>
+
 #include "renderers/renderer.h"
 
+// Lights buffers, one per attribute
+#define LB_DIR_DIRECTION	0
+#define LB_DIR_INTENSITY	1
+#define LB_PT_POSITION		2
+#define LB_PT_INTENSITY		3
+#define LB_COUNT			4
+
 /**
  * \brief Forward shading-based renderer.
  * 
@@ -63,8 +72,8 @@ public:
 	 * Render `scene`: activate the _OpenGL_ context, prepare the texture and
 	 * the buffers, render the mesh for each pair of shaders, then return to
 	 * the default _OpenGL_ context.
-	 * Because the size of the window can change at any moment, the size of the
-	 * texture generated is always updated using the `size` parameter.
+	 * Because the size of the window can change at any moment, the texture
+	 * generated is resized (and only then) when the `size` parameter changes.
 	 * 
 	 * \param size Size of the texture to render.
 	 */
@@ -74,26 +83,26 @@ public:
 	 * \brief Update the list of directional lights.
 	 * 
 	 * Update the list of directional lights as it will be passed to the
-	 * shaders (uniform array). Because the number of lights is directly set in
-	 * the code of the shaders, shaders should be reloaded.
-	 * 
-	 * \param reload Reload shaders (`true`, default) or not (`false`). Might
-	 *      be useful when adding or removing multiple lights via multiple
-	 *      calls of the adding or removing function.
+	 * shaders (texture buffers). The number of lights is a uniform, so shaders
+	 * don’t need to be reloaded.
 	 */
-	void UpdateDirectionalLightList(bool reload = true);
+	void UpdateDirectionalLightList();
 	/**
 	 * \brief Update the list of point lights.
 	 * 
 	 * Update the list of point lights as it will be passed to the shaders
-	 * (uniform array). Because the number of lights is directly set in the
-	 * code of the shaders, shaders should be reloaded.
+	 * (texture buffers). The number of lights is a uniform, so shaders don’t
+	 * need to be reloaded.
+	 */
+	void UpdatePointLightList();
+	/**
+	 * \brief Update the parameters of the materials.
 	 * 
-	 * \param reload Reload shaders (`true`, default) or not (`false`). Might
-	 *      be useful when adding or removing multiple lights via multiple
-	 *      calls of the adding or removing function.
+	 * Upload the parameters of the scene’s materials in the materials table
+	 * (texture buffer), read by the one-pass shaders for the materials without
+	 * a function.
 	 */
-	void UpdatePointLightList(bool reload = true);
+	void UpdateMaterialList();
 
 	/**
 	 * \brief Setter of `scene`.
@@ -110,65 +119,94 @@ protected:
 	/**
 	 * \brief Initialize the shaders for the one-pass approach.
 	 * 
-	 * Create the shaders that will handle the one-pass approach.
+	 * Create the shaders that will handle the one-pass approach. They are
+	 * compiled by `CompileShaders()`, without waiting for them.
 	 */
 	void InitFullPassShaders();
 	/**
 	 * \brief Initialize the shaders for the per-material approach.
 	 * 
 	 * Create as many pairs of shaders as materials in the mesh that handle the
-	 * per-material approach.
+	 * per-material approach. They are compiled by `CompileShaders()`, without
+	 * waiting for them. If materials are batched, a single program draws them
+	 * all, reading the material of each draw.
 	 */
 	void InitPerMaterialShaders();
 
 private:
+	/**
+	 * \brief Load the fallback shaders.
+	 * 
+	 * Load `fallbackShaders` if they aren’t yet, waiting for them.
+	 */
+	void InitFallbackShaders();
+	/**
+	 * \brief Upload a texture buffer.
+	 * 
+	 * Upload values in a buffer read by the shaders as a texture of 4 floats
+	 * per texel, creating the buffer and its texture if needed, then bind the
+	 * texture on its unit.
+	 * 
+	 * \param bufferID ID of the buffer (0 if not created yet).
+	 * \param textureID ID of the texture (0 if not created yet).
+	 * \param textureUnit Texture unit of the buffer (`STU_*`).
+	 * \param data Values, 4 per element (the last one may be padding).
+	 */
+	void UploadTextureBuffer(GLuint& bufferID, GLuint& textureID,
+			unsigned char textureUnit, const std::vector<float>& data);
+
 	/**
 	 * \brief Number of directional lights in the list.
 	 * 
-	 * Number of directional lights in the list (splitted into two arrays).
-	 * Should be the size of both `directionalLightsDirection` (3 elements per
-	 * light) and `directionalLightsIntensity` (3 elements per light).
+	 * Number of directional lights in the list (splitted into two buffers,
+	 * `LB_DIR_DIRECTION` and `LB_DIR_INTENSITY`).
 	 */
 	unsigned int nbDirectionalLights = 0;
 	/**
-	 * \brief Array of directions of the directional lights.
+	 * \brief Number of point lights in the list.
 	 * 
-	 * Array of directions of the directional lights. There are 3 values per
-	 * light (`x`, `y` and `z`), so it should 3 times `nbDirectionalLights`
-	 * value.
+	 * Number of point lights in the list (splitted into two buffers,
+	 * `LB_PT_POSITION` and `LB_PT_INTENSITY`).
 	 */
-	float* directionalLightsDirection = nullptr;
+	unsigned int nbPointLights = 0;
+
 	/**
-	 * \brief Array of intensities of the directional lights.
+	 * \brief Buffers of the lights’ attributes.
 	 * 
-	 * Array of intensities of the directional lights. There are 3 values per
-	 * light (`r`, `g` and `b`), so it should 3 times `nbDirectionalLights`
-	 * value.
+	 * Buffers storing one attribute of all lights each (structure of arrays),
+	 * only uploaded when lights change. Shaders read them through
+	 * `lightsTexturesIDs`.
 	 */
-	float* directionalLightsIntensity = nullptr;
+	GLuint lightsBuffersIDs[LB_COUNT] = { 0, 0, 0, 0 };
+	/**
+	 * \brief Texture buffers of the lights’ attributes.
+	 * 
+	 * Texture buffers bound to `lightsBuffersIDs`, with 4 floats per light.
+	 */
+	GLuint lightsTexturesIDs[LB_COUNT] = { 0, 0, 0, 0 };
 
 	/**
-	 * \brief Number of point lights in the list.
+	 * \brief Buffer of the materials’ parameters.
 	 * 
-	 * Number of point lights in the list (splitted into two arrays).
-	 * Should be the size of both `pointLightsPosition` (3 elements per light)
-	 * and `pointLightsIntensity` (3 elements per light).
+	 * Buffer storing the parameters of the materials (`SMP_SIZE` floats per
+	 * material, from the first one), only uploaded when materials change.
+	 * Shaders read it through `materialsTableTextureID`.
 	 */
-	unsigned int nbPointLights = 0;
+	GLuint materialsTableBufferID = 0;
 	/**
-	 * \brief Array of positions of the point lights.
+	 * \brief Texture buffer of the materials’ parameters.
 	 * 
-	 * Array of positions of the point lights. There are 3 values per
-	 * light (`x`, `y` and `z`), so it should 3 times `nbPointLights` value.
+	 * Texture buffer bound to `materialsTableBufferID`.
 	 */
-	float* pointLightsPosition = nullptr;
+	GLuint materialsTableTextureID = 0;
+
 	/**
-	 * \brief Array of intensities of the point lights.
+	 * \brief Shaders used while the others are compiling.
 	 * 
-	 * Array of intensities of the point lights. There are 3 values per
-	 * light (`r`, `g` and `b`), so it should 3 times `nbPointLights` value.
+	 * Simple shaders (vertices’ colors, no lights), used for the materials
+	 * whose program isn’t linked yet or failed to compile.
 	 */
-	float* pointLightsIntensity = nullptr;
+	ShadersReader* fallbackShaders = nullptr;
 };
 
 #endif // RENDERER_FORWARD_H
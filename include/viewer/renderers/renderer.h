@@ -3,8 +3,12 @@
 
 #include "opengl.h"
 
+#include <string>
+#include <vector>
+
 #include <imgui.h>
 
+#include "rendertargetmanager.h"
 #include "scene.h"
 #include "shadersreader.h"
 
@@ -63,39 +67,49 @@ public:
 	 * \brief Render the scene.
 	 * 
 	 * Pure virtual function for the rendering function.
-	 * Because the size of the window can change at any moment, the size of the
-	 * texture generated is always updated using the `size` parameter.
+	 * Because the size of the window can change at any moment, the texture
+	 * generated is resized (and only then) when the `size` parameter changes.
 	 * 
 	 * \param size Size of the texture to render.
 	 */
 	virtual void Render(ImVec2 size) = 0;
+	/**
+	 * \brief Check if the scene must be rendered again.
+	 * 
+	 * The last render is still valid unless `size` changed, the camera moved,
+	 * the scene or the renderer changed since, or shaders are being compiled
+	 * (and will be swapped in by the next renders).
+	 * 
+	 * \param size Size of the texture to render.
+	 * \return True if the texture must be rendered again.
+	 */
+	bool NeedsRender(ImVec2 size);
 
 	/**
 	 * \brief Update the list of directional lights.
 	 * 
 	 * Update the list of directional lights as it will be passed to the
-	 * shaders (uniform array). Because the number of lights is directly set in
-	 * the code of the shaders, shaders should be reloaded.
+	 * shaders. Renderers must not need to reload their shaders for it.
 	 * Pure virtual function.
-	 * 
-	 * \param reload Reload shaders (`true`, default) or not (`false`). Might
-	 *      be useful when adding or removing multiple lights via multiple
-	 *      calls of the adding or removing function.
 	 */
-	virtual void UpdateDirectionalLightList(bool reload = true) = 0;
+	virtual void UpdateDirectionalLightList() = 0;
 	/**
 	 * \brief Update the list of point lights.
 	 * 
-	 * Update the list of point lights as it will be passed to the shaders
-	 * (uniform array). Because the number of lights is directly set in the
-	 * code of the shaders, shaders should be reloaded.
+	 * Update the list of point lights as it will be passed to the shaders.
+	 * Renderers must not need to reload their shaders for it.
 	 * Pure virtual function.
+	 */
+	virtual void UpdatePointLightList() = 0;
+	/**
+	 * \brief Update the parameters of the materials.
 	 * 
-	 * \param reload Reload shaders (`true`, default) or not (`false`). Might
-	 *      be useful when adding or removing multiple lights via multiple
-	 *      calls of the adding or removing function.
+	 * Update the parameters of the materials without a function as they will
+	 * be passed to the shaders (materials table). Parameters are read by the
+	 * shaders, so they don’t need to be reloaded.
+	 * Virtual function, doing nothing by default.
 	 */
-	virtual void UpdatePointLightList(bool reload = true) = 0;
+	virtual void UpdateMaterialList();
 
 	/**
 	 * \brief Launch shaders initialization and will adapt _OpenGL_ buffers.
@@ -114,6 +128,16 @@ public:
 	 * Reload all shaders if there is any.
 	 */
 	void ReloadShaders();
+	/**
+	 * \brief Reload the shaders depending on some files.
+	 * 
+	 * Compile again, in the background, the shaders expanded from one of the
+	 * files (shaders sources or materials). Current programs are kept until
+	 * the new ones are linked.
+	 * 
+	 * \param paths Paths of the modified files.
+	 */
+	void ReloadShaders(const std::vector<std::string>& paths);
 
 	/**
 	 * \brief Getter of `context`.
@@ -135,15 +159,14 @@ public:
 	 */
 	const Eigen::Vector4f& GetClearColor();
 	/**
-	 * \brief Getter of `renderTextureID`.
+	 * \brief Getter of the render texture.
 	 * 
-	 * Return the value of the `renderTextureID` field, corresponding to the
-	 * texture ID created by _OpenGL_ on the graphics card where the scene will
-	 * be rendered.
+	 * Return the ID of the color texture of `renderTarget`, created by
+	 * _OpenGL_ on the graphics card where the scene is rendered.
 	 * 
-	 * \return Value of the `renderTextureID` field.
+	 * \return ID of the texture (0 before the first render).
 	 */
-	const GLuint& GetRenderTexture() const;
+	GLuint GetRenderTexture() const;
 	/**
 	 * \brief Getter of `scene`.
 	 * 
@@ -183,6 +206,47 @@ public:
 	 * \return Value of the `renderingPerMaterial` field.
 	 */
 	bool IsRenderingPerMaterial();
+	/**
+	 * \brief Getter of `usingMaterialsTable`.
+	 * 
+	 * Return the value of the `usingMaterialsTable` field, corresponding to
+	 * the way the one-pass approach selects the material of each face: a
+	 * materials table (`true`) or a branch per material (`false`).
+	 * 
+	 * \return Value of the `usingMaterialsTable` field.
+	 */
+	bool IsUsingMaterialsTable();
+	/**
+	 * \brief Getter of `batchingMaterials`.
+	 * 
+	 * Return the value of the `batchingMaterials` field, corresponding to the
+	 * way the per-material approach draws the materials: all at once with a
+	 * single program (`true`) or with a program and a draw each (`false`).
+	 * 
+	 * \return Value of the `batchingMaterials` field.
+	 */
+	bool IsBatchingMaterials();
+	/**
+	 * \brief Getter of `usingProvokingMaterials`.
+	 * 
+	 * Return the value of the `usingProvokingMaterials` field, corresponding
+	 * to the way the one-pass approach reads the material of each face: from
+	 * its provoking vertex (`true`) or from the faces materials buffer
+	 * (`false`).
+	 * 
+	 * \return Value of the `usingProvokingMaterials` field.
+	 */
+	bool IsUsingProvokingMaterials();
+	/**
+	 * \brief Getter of `pullingVertices`.
+	 * 
+	 * Return the value of the `pullingVertices` field, corresponding to the
+	 * way the vertex shaders read the mesh: from buffer textures (`true`) or
+	 * from vertex attributes (`false`).
+	 * 
+	 * \return Value of the `pullingVertices` field.
+	 */
+	bool IsPullingVertices();
 
 	/**
 	 * \brief Setter of `clearColor`.
@@ -206,6 +270,54 @@ public:
 	 *      (`true`) or one-pass (`false`)
 	 */
 	void SetRenderingPerMaterial(bool value);
+	/**
+	 * \brief Setter of `usingMaterialsTable`.
+	 * 
+	 * Set the value of the `usingMaterialsTable` field, corresponding to the
+	 * way the one-pass approach selects the material of each face.
+	 * If the new value is different from the previous one, the renderer will be
+	 * automatically re-initialized.
+	 * 
+	 * \param value Use a materials table (`true`) or a branch per material
+	 *      (`false`).
+	 */
+	void SetUsingMaterialsTable(bool value);
+	/**
+	 * \brief Setter of `batchingMaterials`.
+	 * 
+	 * Set the value of the `batchingMaterials` field, corresponding to the
+	 * way the per-material approach draws the materials.
+	 * If the new value is different from the previous one, the renderer will be
+	 * automatically re-initialized.
+	 * 
+	 * \param value Draw all materials at once (`true`) or one after the other
+	 *      (`false`).
+	 */
+	void SetBatchingMaterials(bool value);
+	/**
+	 * \brief Setter of `usingProvokingMaterials`.
+	 * 
+	 * Set the value of the `usingProvokingMaterials` field, corresponding to
+	 * the way the one-pass approach reads the material of each face.
+	 * If the new value is different from the previous one, the renderer will be
+	 * automatically re-initialized.
+	 * 
+	 * \param value Read the material from the provoking vertex (`true`) or
+	 *      from the faces materials buffer (`false`).
+	 */
+	void SetUsingProvokingMaterials(bool value);
+	/**
+	 * \brief Setter of `pullingVertices`.
+	 * 
+	 * Set the value of the `pullingVertices` field, corresponding to the way
+	 * the vertex shaders read the mesh.
+	 * If the new value is different from the previous one, the buffers of the
+	 * scene will be automatically updated (shaders don’t change).
+	 * 
+	 * \param value Pull the vertices from buffer textures (`true`) or read
+	 *      them from vertex attributes (`false`).
+	 */
+	void SetPullingVertices(bool value);
 	/**
 	 * \brief Setter of `scene`.
 	 * 
@@ -221,9 +333,12 @@ protected:
 	/**
 	 * \brief Activate the _OpenGL_ context.
 	 * 
-	 * Activate the _OpenGL_ context to begin rendering.
+	 * Activate the _OpenGL_ context to begin rendering. The render target is
+	 * only resized if `size` changed since the previous render.
+	 * 
+	 * \param size Size of the texture to render.
 	 */
-	void ActivateContext();
+	void ActivateContext(ImVec2 size);
 	/**
 	 * \brief Deactivate the _OpenGL_ context.
 	 * 
@@ -264,6 +379,32 @@ protected:
 	 * The corresponding objects will be deleted.
 	 */
 	void CleanShaders();
+	/**
+	 * \brief Compile shaders without waiting for them.
+	 * 
+	 * Expand the sources of the shaders on worker threads, then submit all
+	 * compilations at once. They are checked by `FinishShaders()`.
+	 * 
+	 * \param readers Shaders to compile (with their files already set).
+	 */
+	void CompileShaders(const std::vector<ShadersReader*>& readers);
+	/**
+	 * \brief Swap in the shaders whose compilation is done.
+	 * 
+	 * Check the shaders being compiled, and replace their programs by the new
+	 * ones once linked. Without KHR_parallel_shader_compile, a program can
+	 * only be checked by waiting for it, so at most one is waited for per
+	 * call.
+	 */
+	void FinishShaders();
+	/**
+	 * \brief Watch the files the shaders were expanded from.
+	 * 
+	 * Give the shaders to the context, so that they are reloaded when their
+	 * files are modified. Called each time the shaders change, instead of on
+	 * each frame.
+	 */
+	void WatchShaders();
 
 	/**
 	 * \brief Application context using this module
@@ -294,6 +435,41 @@ protected:
 	 * (`false`).
 	 */
 	bool renderingPerMaterial = false;
+	/**
+	 * \brief Way to select the material of each face.
+	 * 
+	 * With the one-pass approach, the color of the face material is computed
+	 * once from a materials table, by a `switch` on the materials declaring a
+	 * function and from their parameters for the others (`true`), or the
+	 * lighting code is repeated in a branch per material (`false`).
+	 */
+	bool usingMaterialsTable = true;
+	/**
+	 * \brief Way to draw the materials with the per-material approach.
+	 * 
+	 * Draw the ranges of faces of all materials at once, with a single
+	 * program reading the material of each draw (`true`), or switch programs
+	 * and draw each material after the other (`false`).
+	 */
+	bool batchingMaterials = false;
+	/**
+	 * \brief Way to read the material of each face with the one-pass
+	 * approach.
+	 * 
+	 * Read it from a `flat` attribute of the provoking vertex of the face,
+	 * computed once per mesh (`true`), or fetch it from the faces materials
+	 * buffer in each fragment (`false`).
+	 */
+	bool usingProvokingMaterials = false;
+	/**
+	 * \brief Way the vertex shaders read the mesh.
+	 * 
+	 * Pull each vertex from buffer textures, using the index of the vertex
+	 * of the draw, and decode it whatever the layout of the vertices
+	 * (`true`), or read vertex attributes set up by the fixed-function
+	 * pipeline (`false`). Batched per-material draws always use attributes.
+	 */
+	bool pullingVertices = false;
 
 	/**
 	 * \brief Number of pairs of shaders.
@@ -314,40 +490,32 @@ private:
 	/**
 	 * \brief Initialize common elements of renderers.
 	 * 
-	 * Create the render FBO and the texture where the scene will be rendered.
-	 * Will create objects and buffers on the graphics card.
-	 * 
-	 * In case of problem, a message is printed in the console.
+	 * Create the render target where the scene will be rendered, with a color
+	 * texture and a depth buffer. Its attachments are taken from the render
+	 * targets manager of the context on the first render.
 	 */
 	void Init();
 	/**
 	 * \brief Delete elements created during initialization.
 	 * 
-	 * Delete objects created on the graphics card.
+	 * Delete the render target, its attachments going back to the pool of the
+	 * render targets manager (so that a next renderer can reuse them).
 	 */
 	void Clean();
-
 	/**
-	 * \brief ID of the render FBO.
+	 * \brief Getter of the render targets manager.
 	 * 
-	 * ID returned by _OpenGL_ when generating the Frame Buffer Object (FBO)
-	 * that will be used for rendering, that will contains the texture.
+	 * \return Manager of the context, `nullptr` if there is no context.
 	 */
-	GLuint renderFboID;
-	/**
-	 * \brief ID of the render RBO.
-	 * 
-	 * ID returned by _OpenGL_ when generating the Render Buffer Object (RBO)
-	 * that will be used for rendering, that will contains the depth buffer.
-	 */
-	GLuint renderRboID;
+	RenderTargetManager* GetRenderTargets();
+
 	/**
-	 * \brief ID of the render texture.
+	 * \brief Render target.
 	 * 
-	 * ID returned by _OpenGL_ when generating the texture that will be used to
-	 * render the scene.
+	 * Framebuffer created by the render targets manager, with the texture
+	 * where the scene is rendered and the depth buffer.
 	 */
-	GLuint renderTextureID;
+	RenderTarget* renderTarget = nullptr;
 };
 
 #endif // RENDERERS_RENDERER_H
@@ -63,8 +63,8 @@ public:
 	 * Render `scene`: activate the _OpenGL_ context, prepare the texture and
 	 * the buffers, render the mesh for each pair of shaders, then return to
 	 * the default _OpenGL_ context.
-	 * Because the size of the window can change at any moment, the size of the
-	 * texture generated is always updated using the `size` parameter.
+	 * Because the size of the window can change at any moment, the texture
+	 * generated is resized (and only then) when the `size` parameter changes.
 	 * 
 	 * \param size Size of the texture to render.
 	 */
@@ -75,19 +75,15 @@ public:
 	 * 
 	 * It does nothing, it is just here to fulfill the pure virtual function,
 	 * that is useful for other types of renderers.
-	 * 
-	 * \param reload (Unused)
 	 */
-	void UpdateDirectionalLightList(bool reload = true);
+	void UpdateDirectionalLightList();
 	/**
 	 * \brief (Not implemented)
 	 * 
 	 * It does nothing, it is just here to fulfill the pure virtual function,
 	 * that is useful for other types of renderers.
-	 * 
-	 * \param reload (Unused)
 	 */
-	void UpdatePointLightList(bool reload = true);
+	void UpdatePointLightList();
 
 protected:
 	/**
@@ -100,7 +96,7 @@ protected:
 	 * \brief Initialize the shaders for the per-material approach.
 	 * 
 	 * Create as many pairs of shaders as materials in the mesh that handle the
-	 * per-material approach.
+	 * per-material approach (a single one if materials are batched).
 	 */
 	void InitPerMaterialShaders();
 };
@@ -0,0 +1,232 @@
+#ifndef RENDERTARGETMANAGER_H
+#define RENDERTARGETMANAGER_H
+
+#include "opengl.h"
+
+#include <cstddef>
+#include <list>
+#include <vector>
+
+/**
+ * \brief Storage of a texture or a renderbuffer, kept by a
+ * `RenderTargetManager`.
+ */
+struct RenderAttachment
+{
+	/**
+	 * \brief ID of the texture or of the renderbuffer.
+	 */
+	GLuint id = 0;
+	/**
+	 * \brief Whether it is a texture (sampled by later passes) or a
+	 * renderbuffer.
+	 */
+	bool isTexture = true;
+	/**
+	 * \brief Internal format of the storage.
+	 */
+	GLenum format = GL_RGB;
+	/**
+	 * \brief Width of the storage (in pixels).
+	 */
+	int width = 0;
+	/**
+	 * \brief Height of the storage (in pixels).
+	 */
+	int height = 0;
+	/**
+	 * \brief Whether a render target (or a pass) uses it.
+	 */
+	bool used = false;
+};
+
+/**
+ * \brief Framebuffer created by a `RenderTargetManager`, with its attachments
+ * of the same size.
+ */
+struct RenderTarget
+{
+	/**
+	 * \brief ID of the framebuffer.
+	 */
+	GLuint fboID = 0;
+	/**
+	 * \brief Internal formats of the color textures, one per draw buffer.
+	 */
+	std::vector<GLenum> colorFormats;
+	/**
+	 * \brief Internal format of the depth renderbuffer (`GL_NONE` for none).
+	 */
+	GLenum depthFormat = GL_NONE;
+	/**
+	 * \brief Color textures, attached in the order of `colorFormats` (empty
+	 * until the target is first resized).
+	 */
+	std::vector<GLuint> colorTextures;
+	/**
+	 * \brief Depth renderbuffer (0 if none or not allocated yet).
+	 */
+	GLuint depthRboID = 0;
+	/**
+	 * \brief Width of the attachments (in pixels).
+	 */
+	int width = 0;
+	/**
+	 * \brief Height of the attachments (in pixels).
+	 */
+	int height = 0;
+};
+
+/**
+ * \brief Manager of the framebuffers and of their attachments.
+ *
+ * Render targets only get new attachments when their size changes, instead
+ * of reallocating them on each frame. Attachments are pooled by size, format
+ * and type: those released by a target (resized or deleted) are reused by the
+ * next target asking for the same storage, so renderers replacing each other
+ * share theirs, as can several passes of a frame. Free attachments of another
+ * size than the one asked for are deleted when a new one has to be allocated,
+ * so the pool doesn't grow while the window is resized.
+ *
+ * Targets can have several color textures (with their draw buffers) and a
+ * depth renderbuffer. Color formats must be normalized or floating-point
+ * ones.
+ */
+class RenderTargetManager
+{
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * `RenderTargetManager` constructor, with no target. No _OpenGL_ object
+	 * is created until a target is.
+	 */
+	RenderTargetManager();
+	/**
+	 * \brief Destructor.
+	 *
+	 * `RenderTargetManager` destructor. Delete all targets and attachments,
+	 * even if they are used.
+	 */
+	~RenderTargetManager();
+
+	/**
+	 * \brief Create a render target.
+	 *
+	 * Its attachments are allocated (or reused) by its first `Resize()`.
+	 *
+	 * \param colorFormats Internal formats of the color textures.
+	 * \param depthFormat Internal format of the depth renderbuffer
+	 * (`GL_NONE` for none).
+	 * \return Target, owned by the manager until `DeleteTarget()`.
+	 */
+	RenderTarget* CreateTarget(const std::vector<GLenum>& colorFormats,
+			GLenum depthFormat = GL_DEPTH_COMPONENT);
+	/**
+	 * \brief Delete a render target, releasing its attachments in the pool.
+	 *
+	 * \param target Target given by `CreateTarget()`.
+	 */
+	void DeleteTarget(RenderTarget* target);
+	/**
+	 * \brief Set the size of a render target.
+	 *
+	 * Do nothing if the size didn't change. Otherwise, release the
+	 * attachments of the target, then take free ones of the new size from the
+	 * pool or allocate them.
+	 *
+	 * \param target Target given by `CreateTarget()`.
+	 * \param width New width (in pixels, at least 1).
+	 * \param height New height (in pixels, at least 1).
+	 * \return True if the attachments changed.
+	 */
+	bool Resize(RenderTarget* target, int width, int height);
+
+	/**
+	 * \brief Take an attachment from the pool, allocating it if needed.
+	 *
+	 * The caller must call `Release()` once it doesn't use it anymore.
+	 *
+	 * \param isTexture Whether a texture or a renderbuffer is needed.
+	 * \param format Internal format of the storage.
+	 * \param width Width of the storage (in pixels).
+	 * \param height Height of the storage (in pixels).
+	 * \return ID of the texture or of the renderbuffer.
+	 */
+	GLuint Acquire(bool isTexture, GLenum format, int width, int height);
+	/**
+	 * \brief Give an attachment back to the pool.
+	 *
+	 * \param isTexture Whether it is a texture or a renderbuffer.
+	 * \param id ID given by `Acquire()`.
+	 */
+	void Release(bool isTexture, GLuint id);
+	/**
+	 * \brief Delete all free attachments.
+	 */
+	void Clear();
+	/**
+	 * \brief Reset the numbers of allocations, reuses and resizes.
+	 */
+	void ResetStatistics();
+
+	/**
+	 * \brief Getter of the number of render targets.
+	 *
+	 * \return Number of targets created and not deleted.
+	 */
+	unsigned int GetNbTargets() const;
+	/**
+	 * \brief Getter of the number of attachments in the pool.
+	 *
+	 * \return Number of attachments, used or not.
+	 */
+	unsigned int GetNbAttachments() const;
+	/**
+	 * \brief Getter of the number of attachments currently used.
+	 *
+	 * \return Number of attachments acquired and not released.
+	 */
+	unsigned int GetNbUsedAttachments() const;
+	/**
+	 * \brief Getter of the memory of the attachments.
+	 *
+	 * \return Estimated size of all attachments, used or not (in bytes).
+	 */
+	size_t GetMemorySize() const;
+	/**
+	 * \brief Getter of the number of allocations.
+	 *
+	 * \return Number of calls to `Acquire()` which allocated a storage.
+	 */
+	unsigned int GetNbAllocations() const;
+	/**
+	 * \brief Getter of the number of reuses.
+	 *
+	 * \return Number of calls to `Acquire()` which found a free attachment.
+	 */
+	unsigned int GetNbReuses() const;
+	/**
+	 * \brief Getter of the number of resizes.
+	 *
+	 * \return Number of calls to `Resize()` which changed the attachments.
+	 */
+	unsigned int GetNbResizes() const;
+
+private:
+	/**
+	 * \brief Release the attachments of a render target.
+	 *
+	 * \param target Target whose attachments are released.
+	 */
+	void ReleaseAttachments(RenderTarget* target);
+
+	std::list<RenderTarget> targets;
+	std::vector<RenderAttachment> attachments;
+
+	unsigned int nbAllocations = 0;
+	unsigned int nbReuses = 0;
+	unsigned int nbResizes = 0;
+};
+
+#endif // RENDERTARGETMANAGER_H
@@ -6,12 +6,23 @@
 #include <Eigen/Geometry>
 #include <imgui.h>
 
+#include "bvh.h"
 #include "camera.h"
+#include "compactvertices.h"
+#include "culling.h"
 #include "light.h"
 #include "material.h"
 #include "mesh.h"
+#include "provokingmaterials.h"
 #include "shadersreader.h"
 
+// Layout of the per-frame constants (std140, offsets in floats)
+#define FC_PROJECTION	0
+#define FC_VIEW			16
+#define FC_MODEL		32
+#define FC_NORMAL		48
+#define FC_SIZE			60
+
 class Scene
 {
 public:
@@ -19,24 +30,47 @@ public:
 	Scene(Mesh* mesh);
 	~Scene();
 
+	void CullMesh();
+	bool PickMesh(const Eigen::Vector2f& position, RayHit& hit);
 	bool RenderMesh(ShadersReader* shaders, unsigned char material = 0);
 	void UpdateCameraViewport(ImVec2 size);
+	void UpdateFrameConstants();
 	void UpdateVbos();
+	void AskForRender();
+	bool NeedsRender();
+
+	void BeginUpdate();
+	void EndUpdate();
 
 	void AddDirectionalLight(DirectionalLight* light);
 	void AddPointLight(PointLight *light);
 	void AddRandomPointLight(PointLight *light);
+	bool RemoveDirectionalLight(DirectionalLight* light);
+	bool RemovePointLight(PointLight* light);
 
 	const Eigen::Vector3f& GetAmbientColor();
 	Camera* GetCamera();
+	ClusterCuller* GetClusterCuller();
+	CompactVertices* GetCompactVertices();
 	std::vector<DirectionalLight*>* GetDirectionalLights();
+	float GetDrawTime();
+	unsigned int GetNbDrawCalls();
+	size_t GetFacesVbosMemorySize();
+	unsigned char GetNbShortFacesVbos();
+	unsigned char GetNbVboFaces();
 	std::vector<PointLight*>* GetPointLights();
+	ProvokingMaterials* GetProvokingMaterials();
 	MaterialList* GetMaterialsPaths();
 	Mesh* GetMesh();
 	const Eigen::Matrix4f& GetMeshTransformationMatrix();
 	Eigen::Matrix3f GetNormalMatrix();
+	bool IsClusterCullingEnabled();
+	bool IsCompactVerticesEnabled();
+	bool IsPullingVertices();
 
 	void SetCamera(Camera* camera);
+	void SetClusterCulling(bool enabled);
+	void SetCompactVertices(bool enabled);
 	void SetMaterialsPaths(MaterialList* materialsPaths);
 	void SetMesh(Mesh* mesh);
 	void SetMeshTransformationMatrix(Eigen::Matrix4f transformationMatrix);
@@ -47,25 +81,68 @@ public:
 private:
 	void Init();
 	void InitVbos(bool force = false);
+	void InitVerticesVbo();
+	void InitVertexAttributes();
+	void InitProvokingMaterials(bool enabled);
 	void InitAllFaceVbo();
 	void InitPerMaterialVbos();
+	void InitMaterialsDraws(bool enabled);
+	void InitPulledVertices(bool enabled);
+	void InitFacesVbo(unsigned char vbo, unsigned int firstFace,
+			unsigned int nbFaces);
+	const unsigned int* GetVboFacesVertices();
+	unsigned int GetNbVboVertices();
+	void ResetFacesVbosFormats();
+	void SetMeshUniforms(ShadersReader* shaders);
+	void DrawPulledVertices(unsigned char material);
+	void UpdateClusterCullerIndexFormats();
 	void Clean();
 	void CleanFacesVbos();
+	void CleanPulledVertices();
 	void CleanVboFacesNbElements();
+	void UpdateRenderer(bool directionalLights, bool pointLights,
+			bool materials);
 
 	void* renderer = nullptr;
 
 	Camera* camera = nullptr;
 	Mesh* mesh = nullptr;
 
+	ClusterCuller* clusterCuller = nullptr;
+	bool clusterCulling = true;
+	bool clusterCullingIsValid = false;
+
+	CompactVertices* compactVertices = nullptr;
+	bool compactVerticesEnabled = false;
+
+	// Materials of the faces on their last vertex (with the vertices copied
+	// for them), if the one-pass approach reads them from the vertices
+	ProvokingMaterials* provokingMaterials = nullptr;
+	GLuint vboVerticesMaterialsID = 0;
+
 	MaterialList* materialsPaths = nullptr;
 
+	// Changes waiting for the end of the current update (if any)
+	unsigned int updateDepth = 0;
+	bool directionalLightsChanged = false;
+	bool pointLightsChanged = false;
+	bool materialsChanged = false;
+
 	Eigen::Vector3f ambientColor = Eigen::Vector3f(.1, .1, .1);
 	std::vector<DirectionalLight*> directionalLights;
 	std::vector<PointLight*> pointLights;
 
 	Eigen::Matrix4f meshTransformationMatrix = Eigen::Matrix4f::Identity();
 
+	// Per-frame constants, as uploaded in their uniform buffer
+	GLuint uboFrameID = 0;
+	float frameConstants[FC_SIZE];
+	bool modelIsDirty = true;
+
+	// Changes since the last render, other than the camera and the model
+	// matrices (compared to the per-frame constants)
+	bool needsRender = true;
+
 	GLuint vaoID;
 	GLuint* vboFacesID;
 	GLuint vboVerticesID;
@@ -74,6 +151,40 @@ private:
 
 	unsigned char nbVboFaces = 0;
 	unsigned int* vboFacesNbElements = nullptr;
+
+	// Format of each face VBO: 16-bit indices are relative to a base vertex,
+	// either of the whole VBO or of each chunk of clusters
+	std::vector<GLenum> vboFacesTypes;
+	std::vector<GLint> vboFacesBaseVertices;
+	std::vector<ClusterDrawList> vboFacesChunks;
+	std::vector<GLint> clustersBaseVertex;
+	std::vector<unsigned int> vboFacesFirstFace;
+	size_t vboFacesMemorySize = 0;
+
+	// Ranges of each material in the face VBO, when materials are batched
+	// (split along its chunks), with the material of each range
+	ClusterDrawList materialsDraws;
+	std::vector<GLuint> materialsDrawsIDs;
+	// Materials of the ranges (as an instanced attribute) and their indirect
+	// draws, if `glMultiDrawElementsIndirect()` is supported
+	GLuint vboMaterialsDrawsID = 0;
+	GLuint indirectMaterialsDrawsID = 0;
+
+	// Vertices pulled by the vertex shaders from buffer textures instead of
+	// attributes: the vertices VBO as is, and the faces of all face VBOs
+	// with 32-bit indices (drawn by an empty VAO)
+	bool pullingVertices = false;
+	GLuint vaoPullingID = 0;
+	GLuint tboPulledIndicesID = 0;
+	GLuint tboPulledIndicesTex = 0;
+	GLuint tboPulledVerticesTex = 0;
+	GLuint tboPulledMaterialsTex = 0;
+	std::vector<GLint> pulledDrawsFirsts;
+
+	// CPU time spent in `RenderMesh()` since the last culling (in ms), and
+	// number of draw calls made
+	float drawTime = 0.;
+	unsigned int nbDrawCalls = 0;
 };
 
 #endif // SCENE_H
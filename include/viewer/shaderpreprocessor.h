@@ -0,0 +1,251 @@
+#ifndef SHADERPREPROCESSOR_H
+#define SHADERPREPROCESSOR_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils.h"
+
+// Shaders tags
+#define ST_DEFINE_MACROS	"define_macros"
+#define ST_DEFINE_MATERIALS	"define_materials"
+#define ST_CALL_MATERIALS	"call_materials"
+#define STCM_TAG			"@mat"
+
+// Call used for materials without a function declaration
+#define ST_DEFAULT_MATERIAL_CALL	"vec3(0, 0, 0)"
+
+// Macro selecting the materials table instead of a branch per material
+#define ST_MATERIALS_TABLE			"MATERIALS_TABLE"
+// Macro reading the material from the draw (`vert_material`) instead of the
+// face
+#define ST_MATERIAL_PER_DRAW		"MATERIAL_PER_DRAW"
+// Macro reading the material from the provoking vertex of the face
+// (`vert_material` too) instead of the faces materials buffer
+#define ST_MATERIAL_PER_VERTEX		"MATERIAL_PER_VERTEX"
+
+// Materials parameters (lines `@<name> <values>` of the materials files)
+#define SMP_ALBEDO		"albedo"
+#define SMP_DIFFUSE		"diffuse"
+// Number of floats per material in the materials table
+#define SMP_SIZE		4
+
+/**
+ * \brief Types of the tags of the shaders templates.
+ */
+enum ShaderTagType {
+	STT_DEFINE_MACROS,
+	STT_DEFINE_MATERIALS,
+	STT_CALL_MATERIALS,
+	STT_UNKNOWN
+};
+
+/**
+ * \brief Tag of a shader template, replacing a whole line.
+ */
+struct ShaderTemplateTag
+{
+	/**
+	 * \brief Type of the tag.
+	 */
+	ShaderTagType type = STT_UNKNOWN;
+	/**
+	 * \brief Argument of the tag, split around each `STCM_TAG`.
+	 */
+	std::vector<std::string> argumentParts;
+};
+
+/**
+ * \brief Shader template, split into texts and tags.
+ */
+struct ShaderTemplate
+{
+	/**
+	 * \brief Modification time and size of the file when it was read.
+	 */
+	FileVersion version;
+	/**
+	 * \brief Texts before each tag, then after the last one.
+	 */
+	std::vector<std::string> texts;
+	/**
+	 * \brief Tags, in the order of the file.
+	 */
+	std::vector<ShaderTemplateTag> tags;
+};
+
+/**
+ * \brief Material file, with the call of its function or its parameters.
+ */
+struct ShaderMaterial
+{
+	/**
+	 * \brief Modification time and size of the file when it was read.
+	 */
+	FileVersion version;
+	/**
+	 * \brief Content of the file, without its parameters.
+	 */
+	std::string content;
+	/**
+	 * \brief Call of the function declared by the file, or its color if it
+	 * only has parameters.
+	 */
+	std::string call;
+	/**
+	 * \brief Whether the file declares a function.
+	 */
+	bool hasFunction = false;
+	/**
+	 * \brief Parameters, as stored in the materials table: albedo (RGB),
+	 * then diffuse coefficient.
+	 */
+	float parameters[SMP_SIZE] = { 0., 0., 0., 1. };
+};
+
+/**
+ * \brief Preprocessor of the shaders templates.
+ *
+ * Replace the tags of a shader template (lines starting with `@`, except the
+ * first one) by the preprocessor macros, the materials functions and their
+ * calls:
+ * - `@define_macros`: a `#define` per macro.
+ * - `@define_materials`: the content of each material file.
+ * - `@call_materials <code>`: the code, with `@mat` replaced by the call of
+ *   the material function (or of each one, depending on the face material,
+ *   if there are several materials).
+ *
+ * Materials files either declare a function, or only parameters (lines
+ * `@albedo <r> <g> <b>` and `@diffuse <coefficient>`). If the
+ * `ST_MATERIALS_TABLE` macro is defined, several materials are no longer
+ * selected by a branch each around the code: the color of the face material
+ * is computed once, by a `switch` calling the functions, or by default from
+ * the parameters read in the `materials_table` buffer (see
+ * `GetMaterialsTable()`), then the code is added once. If the
+ * `ST_MATERIAL_PER_DRAW` macro is defined, the material is the one of the
+ * draw (`vert_material`, given by the vertex shader) instead of the one of
+ * the face (`face_material` buffer). The `ST_MATERIAL_PER_VERTEX` macro reads
+ * it from `vert_material` too, the vertex shader giving the material of the
+ * provoking vertex of the face.
+ *
+ * Templates are split into texts and tags once, and materials are read once,
+ * then kept as long as their file keeps the same modification time (in ns)
+ * and size.
+ * The expanded source is written in a buffer allocated once with its final
+ * size. Shaders can be expanded by several threads at once.
+ */
+class ShaderPreprocessor
+{
+public:
+	/**
+	 * \brief Constructor.
+	 *
+	 * `ShaderPreprocessor` constructor, with no file cached.
+	 */
+	ShaderPreprocessor();
+	/**
+	 * \brief Destructor.
+	 *
+	 * `ShaderPreprocessor` destructor.
+	 */
+	~ShaderPreprocessor();
+
+	/**
+	 * \brief Expand a shader template.
+	 *
+	 * \param path Path of the template.
+	 * \param macros Preprocessor macros, by name.
+	 * \param materialsPaths Paths of the materials files.
+	 * \param nbMaterials Number of materials.
+	 * \param firstMaterial ID of the first material (used to select the
+	 * material of each face, if there are several ones).
+	 * \param dependencies If not null, the paths of the files used are added
+	 * to it.
+	 * \return Expanded source, empty if the template couldn’t be read.
+	 */
+	std::string Expand(const std::string& path,
+			const std::unordered_map<std::string, std::string>& macros,
+			const std::string* materialsPaths, unsigned int nbMaterials,
+			unsigned int firstMaterial,
+			std::vector<std::string>* dependencies = nullptr);
+	/**
+	 * \brief Forget a file, so that it is read again on its next use.
+	 *
+	 * \param path Path of the template or material file.
+	 */
+	void Invalidate(const std::string& path);
+	/**
+	 * \brief Forget all files.
+	 */
+	void Clear();
+
+	/**
+	 * \brief Getter of the number of files cached.
+	 *
+	 * \return Number of templates and materials kept.
+	 */
+	unsigned int GetNbCachedFiles() const;
+	/**
+	 * \brief Getter of the number of files read.
+	 *
+	 * \return Number of templates and materials read from the disk.
+	 */
+	unsigned int GetNbFileReads() const;
+
+	/**
+	 * \brief Get a material, reading it if needed.
+	 *
+	 * \param path Path of the material file.
+	 * \return Material (empty if the file couldn’t be read).
+	 */
+	std::shared_ptr<const ShaderMaterial> GetMaterial(const std::string& path);
+	/**
+	 * \brief Get the parameters of materials, as stored in the materials
+	 * table.
+	 *
+	 * \param materialsPaths Paths of the materials files.
+	 * \param nbMaterials Number of materials.
+	 * \return `SMP_SIZE` floats per material (those of materials declaring a
+	 * function are unused).
+	 */
+	std::vector<float> GetMaterialsTable(const std::string* materialsPaths,
+			unsigned int nbMaterials);
+
+	/**
+	 * \brief Split a shader template into texts and tags.
+	 *
+	 * \param content Content of the template.
+	 * \return Template, without file version.
+	 */
+	static ShaderTemplate ParseTemplate(const std::string& content);
+	/**
+	 * \brief Read the parameters of a material file and prepare its call.
+	 *
+	 * \param content Content of the material file.
+	 * \return Material, without file version.
+	 */
+	static ShaderMaterial ParseMaterial(const std::string& content);
+
+private:
+	/**
+	 * \brief Get a template, reading it if needed.
+	 *
+	 * \param path Path of the template.
+	 * \return Template (empty if the file couldn’t be read).
+	 */
+	std::shared_ptr<const ShaderTemplate> GetTemplate(const std::string& path);
+
+	// (Cached files are never modified, they are replaced, so threads still
+	// expanding an old version can keep it.)
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, std::shared_ptr<const ShaderTemplate>>
+			templates;
+	std::unordered_map<std::string, std::shared_ptr<const ShaderMaterial>>
+			materials;
+	unsigned int nbFileReads = 0;
+};
+
+#endif // SHADERPREPROCESSOR_H
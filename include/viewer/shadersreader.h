@@ -3,21 +3,61 @@
 
 #include "opengl.h"
 
+#include <chrono>
 #include <unordered_map>
+#include <vector>
 
 #include "material.h"
-
-// Shaders pre-processor macros’ names
-#define SPPM_NB_DIR_LIGHTS	"NB_DIR_LIGHTS"
-#define SPPM_NB_PT_LIGHTS	"NB_PT_LIGHTS"
-
-// Shaders tags
-#define ST_DEFINE_MACROS	"define_macros"
-#define ST_DEFINE_MATERIALS	"define_materials"
-#define ST_CALL_MATERIALS	"call_materials"
-#define STCM_TAG			"@mat"
+#include "programcache.h"
+#include "shaderpreprocessor.h"
+
+// Shaders attributes’ locations (shared by all programs)
+#define SAL_VTX_POSITION	0
+#define SAL_VTX_COLOR		1
+#define SAL_VTX_NORMAL		2
+#define SAL_VTX_MATERIAL	3
+
+// Shaders uniform blocks’ binding points (shared by all programs)
+#define SUB_FRAME_CONSTANTS			0
+#define SUB_FRAME_CONSTANTS_NAME	"FrameConstants"
+
+// Shaders texture units (shared by all programs)
+#define STU_FACE_MATERIAL			0
+#define STU_LIGHTS_DIR_DIRECTION	1
+#define STU_LIGHTS_DIR_INTENSITY	2
+#define STU_LIGHTS_PT_POSITION		3
+#define STU_LIGHTS_PT_INTENSITY		4
+#define STU_MATERIALS_TABLE			5
+#define STU_VTX_INDICES				6
+#define STU_VTX_VERTICES			7
+#define STU_VTX_MATERIALS			8
+
+// Shaders uniforms’ handles (locations are resolved once after linking)
+enum ShaderUniform {
+	SU_AMBIENT_COLOR,
+	SU_LIGHTS_DIR_DIRECTION,
+	SU_LIGHTS_DIR_INTENSITY,
+	SU_LIGHTS_PT_POSITION,
+	SU_LIGHTS_PT_INTENSITY,
+	SU_NB_DIR_LIGHTS,
+	SU_NB_PT_LIGHTS,
+	SU_VTX_POSITION_OFFSET,
+	SU_VTX_POSITION_SCALE,
+	SU_VTX_OCTAHEDRAL,
+	SU_VTX_PULLING,
+	SU_VTX_INDICES,
+	SU_VTX_VERTICES,
+	SU_VTX_STRIDE,
+	SU_VTX_OFFSETS,
+	SU_VTX_DEFAULT_COLOR,
+	SU_VTX_MATERIALS,
+	SU_FACE_MATERIAL,
+	SU_MATERIALS_TABLE,
+	SU_COUNT
+};
 
 std::string GetShaderLog(GLuint shader);
+bool IsParallelCompileSupported();
 
 class ShadersReader
 {
@@ -26,6 +66,9 @@ public:
 	~ShadersReader();
 
 	bool Load();
+	bool Preprocess();
+	bool Compile();
+	bool Finish(bool wait = true);
 	bool LoadFiles(const std::string& vertexShaderPath,
 			const std::string& fragmentShaderPath);
 	bool LoadFiles(const std::string& vertexShaderPath,
@@ -34,6 +77,14 @@ public:
 	bool LoadFiles(const std::string& vertexShaderPath,
 			const std::string& fragmentShaderPath,
 			std::string* specificMaterialPath);
+	void SetFiles(const std::string& vertexShaderPath,
+			const std::string& fragmentShaderPath);
+	void SetFiles(const std::string& vertexShaderPath,
+			const std::string& fragmentShaderPath,
+			MaterialList* materialsPaths);
+	void SetFiles(const std::string& vertexShaderPath,
+			const std::string& fragmentShaderPath,
+			std::string* specificMaterialPath);
 
 	void Activate() const;
 	void Deactivate() const;
@@ -41,6 +92,7 @@ public:
 	void SetPreProcessorMacro(const std::string& name,
 			const std::string& value);
 
+	int GetUniformLocation(ShaderUniform uniform) const;
 	int GetUniformLocation(const std::string& name) const;
 	int GetAttribLocation(const std::string& name) const;
 
@@ -48,6 +100,8 @@ public:
 			const std::string& fragmentShaderPath);
 
 	bool AreLoaded();
+	bool IsCompiling();
+	bool DependsOn(const std::vector<std::string>& paths);
 
 	const std::string& GetVertexShaderPath();
 	const std::string& GetFragmentShaderPath();
@@ -55,15 +109,20 @@ public:
 	std::string* GetSpecificMaterialPath();
 	const std::string& GetVertexShaderSource();
 	const std::string& GetFragmentShaderSource();
+	const std::vector<std::string>& GetDependencies();
 
 private:
-	void SetDefaultMacrosValues();
+	void ReplaceProgram(GLuint programID, GLuint vertexShaderID,
+			GLuint fragmentShaderID, ProgramCache* cache,
+			const std::string& vertexShaderSource,
+			const std::string& fragmentShaderSource);
+	void ResolveUniforms();
+	GLuint CreateShader(GLenum type, const std::string& source);
+	void DeleteShader(GLuint shaderID);
+	void CancelCompilation();
 	void Clean();
 	std::string GetFileContent(const std::string& path);
 
-	std::string PrepareMaterialCallArgument(const std::string& text,
-			const std::string& materialCall);
-
 	void* context = nullptr;
 
 	std::string vertexShaderPath;
@@ -80,6 +139,30 @@ private:
 	GLuint programID;
 	GLuint vertexShaderID;
 	GLuint fragmentShaderID;
+	// (Cache owning the program, if any.)
+	ProgramCache* programCache = nullptr;
+
+	// Files read by the last `Preprocess()` (shaders and materials)
+	std::vector<std::string> dependencies;
+
+	// Sources expanded by `Preprocess()`, not compiled yet
+	std::string preprocessedVertexSource;
+	std::string preprocessedFragmentSource;
+	bool isPreprocessed = false;
+	float preprocessingTime = 0.;
+
+	// Program being compiled, replacing the current one once linked
+	std::string pendingVertexSource;
+	std::string pendingFragmentSource;
+	GLuint pendingProgramID = 0;
+	GLuint pendingVertexShaderID = 0;
+	GLuint pendingFragmentShaderID = 0;
+	// (Time spent preprocessing, submitting and checking it, in ms.)
+	float compilationTime = 0.;
+	bool isCompiling = false;
+
+	// Locations of the known uniforms in the current program (-1 if unused)
+	GLint uniformsLocations[SU_COUNT];
 
 	bool areLoaded = false;
 };
@@ -1,6 +1,7 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <ctime>
 #include <iostream>
 
 #ifdef _WIN32
@@ -13,9 +14,23 @@ namespace Global {
 	extern unsigned int nextModuleID;
 };
 
+// Modification time (in ns) and size of a file, so that any write changes it
+struct FileVersion
+{
+	long long modificationTime = 0;
+	long long size = -1;
+
+	bool operator==(const FileVersion& other) const;
+	bool operator!=(const FileVersion& other) const;
+};
+
 bool FileExists(std::string path);
 std::string LoadTextFile(const std::string& path);
 bool SaveTextFile(const std::string& path, const std::string& content);
+time_t GetFileModificationTime(const std::string& path);
+FileVersion GetFileVersion(const std::string& path);
+bool MakeDirectory(const std::string& path);
+bool DeleteDirectory(const std::string& path);
 
 std::string GetFunctionCallFromDeclaration(const std::string& content);
 
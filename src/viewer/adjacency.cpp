@@ -0,0 +1,206 @@
+#include "adjacency.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+#include "parallel.h"
+
+// Minimum number of elements handled by each worker thread
+#define ADJACENCY_GRAIN_SIZE 16384
+
+static unsigned int IntersectFaces(const unsigned int* faces0,
+		const unsigned int* faces0End, const unsigned int* faces1,
+		const unsigned int* faces1End, unsigned int face,
+		unsigned int* result) {
+	// Both lists are sorted, so walk through them together
+	// (A face using a vertex twice is listed twice, but only kept once.)
+	unsigned int nbFaces = 0;
+	unsigned int previous = face;
+	while ((faces0 < faces0End) && (faces1 < faces1End)) {
+		if (*faces0 < *faces1) {
+			faces0++;
+		} else if (*faces1 < *faces0) {
+			faces1++;
+		} else {
+			if ((*faces0 != face) && (*faces0 != previous)) {
+				if (result != nullptr)
+					result[nbFaces] = *faces0;
+				nbFaces++;
+				previous = *faces0;
+			}
+			faces0++;
+			faces1++;
+		}
+	}
+	return nbFaces;
+}
+
+MeshAdjacency::MeshAdjacency(Mesh* mesh, bool edgeNeighbors)
+		: mesh(mesh) {
+	if (this->mesh == nullptr)
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+
+	this->BuildVertexFaces();
+	if (edgeNeighbors)
+		this->BuildEdgeNeighbors();
+
+	this->buildTime = std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+}
+
+MeshAdjacency::~MeshAdjacency() {}
+
+unsigned int MeshAdjacency::GetNbVertexFaces(unsigned int vertex) const {
+	return this->vertexFacesStart[vertex + 1]
+			- this->vertexFacesStart[vertex];
+}
+
+const unsigned int* MeshAdjacency::GetVertexFaces(unsigned int vertex)
+		const {
+	return this->vertexFaces.data() + this->vertexFacesStart[vertex];
+}
+
+unsigned int MeshAdjacency::GetNbFaceNeighbors(unsigned int face) const {
+	return this->edgeNeighborsStart[(3 * face) + 3]
+			- this->edgeNeighborsStart[3 * face];
+}
+
+const unsigned int* MeshAdjacency::GetFaceNeighbors(unsigned int face)
+		const {
+	return this->edgeNeighbors.data() + this->edgeNeighborsStart[3 * face];
+}
+
+unsigned int MeshAdjacency::GetNbEdgeNeighbors(unsigned int face,
+		unsigned char edge) const {
+	return this->edgeNeighborsStart[(3 * face) + edge + 1]
+			- this->edgeNeighborsStart[(3 * face) + edge];
+}
+
+const unsigned int* MeshAdjacency::GetEdgeNeighbors(unsigned int face,
+		unsigned char edge) const {
+	return this->edgeNeighbors.data()
+			+ this->edgeNeighborsStart[(3 * face) + edge];
+}
+
+bool MeshAdjacency::IsBoundaryEdge(unsigned int face, unsigned char edge)
+		const {
+	return this->GetNbEdgeNeighbors(face, edge) == 0;
+}
+
+size_t MeshAdjacency::GetMemorySize() const {
+	return sizeof(unsigned int) * (this->vertexFacesStart.size()
+			+ this->vertexFaces.size() + this->edgeNeighborsStart.size()
+			+ this->edgeNeighbors.size());
+}
+
+float MeshAdjacency::GetBuildTime() const {
+	return this->buildTime;
+}
+
+void MeshAdjacency::BuildVertexFaces() {
+	unsigned int nbVertices = this->mesh->nbVertices;
+	unsigned int nbFaces = this->mesh->nbFaces;
+	const unsigned int* facesVertices = this->mesh->facesVertices;
+	std::unique_ptr<std::atomic<unsigned int>[]> counters(
+			new std::atomic<unsigned int>[nbVertices]);
+
+	/* Count the faces of each vertex */
+
+	ParallelFor(0, nbVertices, [&](unsigned int first, unsigned int last) {
+		for (unsigned int v = first; v < last; v++)
+			counters[v].store(0, std::memory_order_relaxed);
+	}, ADJACENCY_GRAIN_SIZE);
+	ParallelFor(0, 3 * nbFaces, [&](unsigned int first, unsigned int last) {
+		for (unsigned int i = first; i < last; i++) {
+			counters[facesVertices[i]].fetch_add(1,
+					std::memory_order_relaxed);
+		}
+	}, ADJACENCY_GRAIN_SIZE);
+
+	// Find where each vertex starts in the list
+	this->vertexFacesStart.resize(nbVertices + 1);
+	this->vertexFacesStart[0] = 0;
+	for (unsigned int v = 0; v < nbVertices; v++) {
+		this->vertexFacesStart[v + 1] = this->vertexFacesStart[v]
+				+ counters[v].load(std::memory_order_relaxed);
+	}
+
+	/* Fill the list */
+
+	// (Counters are reused as the next free place of each vertex.)
+	ParallelFor(0, nbVertices, [&](unsigned int first, unsigned int last) {
+		for (unsigned int v = first; v < last; v++) {
+			counters[v].store(this->vertexFacesStart[v],
+					std::memory_order_relaxed);
+		}
+	}, ADJACENCY_GRAIN_SIZE);
+	this->vertexFaces.resize(3 * (size_t) nbFaces);
+	ParallelFor(0, nbFaces, [&](unsigned int first, unsigned int last) {
+		for (unsigned int f = first; f < last; f++) {
+			for (unsigned int c = 0; c < 3; c++) {
+				this->vertexFaces[counters[facesVertices[(3 * f) + c]]
+						.fetch_add(1, std::memory_order_relaxed)] = f;
+			}
+		}
+	}, ADJACENCY_GRAIN_SIZE);
+
+	// Sort the faces of each vertex, so that the order doesn't depend on
+	// threads
+	ParallelFor(0, nbVertices, [this](unsigned int first, unsigned int last) {
+		for (unsigned int v = first; v < last; v++) {
+			std::sort(this->vertexFaces.begin() + this->vertexFacesStart[v],
+					this->vertexFaces.begin()
+							+ this->vertexFacesStart[v + 1]);
+		}
+	}, ADJACENCY_GRAIN_SIZE);
+}
+
+void MeshAdjacency::BuildEdgeNeighbors() {
+	unsigned int nbEdges = 3 * this->mesh->nbFaces;
+	const unsigned int* facesVertices = this->mesh->facesVertices;
+
+	// Faces sharing an edge are the ones around both of its vertices
+	auto findNeighbors = [this, facesVertices](unsigned int edge,
+			unsigned int* result) -> unsigned int {
+		unsigned int face = edge / 3;
+		unsigned int vertex0 = facesVertices[edge];
+		unsigned int vertex1 = facesVertices[(3 * face) + ((edge + 1) % 3)];
+		if (vertex0 == vertex1)
+			return 0;
+		return IntersectFaces(
+				this->GetVertexFaces(vertex0),
+				this->GetVertexFaces(vertex0)
+						+ this->GetNbVertexFaces(vertex0),
+				this->GetVertexFaces(vertex1),
+				this->GetVertexFaces(vertex1)
+						+ this->GetNbVertexFaces(vertex1),
+				face, result);
+	};
+
+	/* Count the neighbors of each edge */
+
+	this->edgeNeighborsStart.resize(nbEdges + 1);
+	this->edgeNeighborsStart[0] = 0;
+	ParallelFor(0, nbEdges, [&](unsigned int first, unsigned int last) {
+		for (unsigned int e = first; e < last; e++)
+			this->edgeNeighborsStart[e + 1] = findNeighbors(e, nullptr);
+	}, ADJACENCY_GRAIN_SIZE);
+
+	// Find where each edge starts in the list
+	for (unsigned int e = 0; e < nbEdges; e++)
+		this->edgeNeighborsStart[e + 1] += this->edgeNeighborsStart[e];
+
+	/* Fill the list */
+
+	this->edgeNeighbors.resize(this->edgeNeighborsStart[nbEdges]);
+	ParallelFor(0, nbEdges, [&](unsigned int first, unsigned int last) {
+		for (unsigned int e = first; e < last; e++) {
+			findNeighbors(e, this->edgeNeighbors.data()
+					+ this->edgeNeighborsStart[e]);
+		}
+	}, ADJACENCY_GRAIN_SIZE);
+}
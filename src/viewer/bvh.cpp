@@ -0,0 +1,408 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+
+#include "parallel.h"
+
+// Minimum number of faces handled by each worker thread
+#define BVH_GRAIN_SIZE			16384
+
+// Minimum number of faces of a node to build its children in parallel
+#define BVH_PARALLEL_NB_FACES	65536
+
+// Depth after which nodes are split by their middle instead of with the SAH
+// (So that the traversal stack can’t overflow.)
+#define BVH_MAX_SAH_DEPTH		64
+#define BVH_STACK_SIZE			128
+
+// Cost of visiting a node, relatively to the cost of testing a face
+#define BVH_TRAVERSAL_COST		1.f
+
+static inline float GetHalfArea(const Eigen::AlignedBox3f& box) {
+	if (box.isEmpty())
+		return 0.;
+	Eigen::Vector3f sizes = box.sizes();
+	return (sizes.x() * sizes.y()) + (sizes.y() * sizes.z())
+			+ (sizes.z() * sizes.x());
+}
+
+static inline bool IntersectBox(const BVHNode& node,
+		const Eigen::Vector3f& origin, const Eigen::Vector3f& inverse,
+		float maxDistance) {
+	float tMin = 0.;
+	float tMax = maxDistance;
+	for (unsigned int a = 0; a < 3; a++) {
+		float t0 = (node.boxMin[a] - origin[a]) * inverse[a];
+		float t1 = (node.boxMax[a] - origin[a]) * inverse[a];
+		tMin = std::max(tMin, std::min(t0, t1));
+		tMax = std::min(tMax, std::max(t0, t1));
+	}
+	return tMin <= tMax;
+}
+
+static inline bool IntersectTriangle(const float* triangle,
+		const Eigen::Vector3f& origin, const Eigen::Vector3f& direction,
+		float maxDistance, float& t, float& u, float& v) {
+	// Möller–Trumbore algorithm, without culling back faces
+	Eigen::Map<const Eigen::Vector3f> vertex(triangle);
+	Eigen::Map<const Eigen::Vector3f> edge1(triangle + 3);
+	Eigen::Map<const Eigen::Vector3f> edge2(triangle + 6);
+
+	Eigen::Vector3f p = direction.cross(edge2);
+	float determinant = edge1.dot(p);
+	if (determinant == 0.)
+		return false;
+	float inverse = 1.f / determinant;
+
+	Eigen::Vector3f s = origin - vertex;
+	u = s.dot(p) * inverse;
+	if ((u < 0.) || (u > 1.))
+		return false;
+
+	Eigen::Vector3f q = s.cross(edge1);
+	v = direction.dot(q) * inverse;
+	if ((v < 0.) || ((u + v) > 1.))
+		return false;
+
+	t = edge2.dot(q) * inverse;
+	return (t >= 0.) && (t < maxDistance);
+}
+
+BVH::BVH(Mesh* mesh, unsigned int maxLeafFaces)
+		: mesh(mesh)
+		, maxLeafFaces(std::max(1u, std::min(maxLeafFaces, 0xffffu))) {
+	if ((this->mesh == nullptr) || (this->mesh->nbFaces == 0))
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+	unsigned int nbFaces = this->mesh->nbFaces;
+
+	/* Compute the bounds of each face */
+
+	const Eigen::Vector3f* positions = this->mesh->GetPositions();
+	unsigned int stride = this->mesh->GetVerticesStride();
+	this->faces.resize(nbFaces);
+	this->facesBoxes.resize(nbFaces);
+	this->facesCentroids.resize(nbFaces);
+	ParallelFor(0, nbFaces, [&](unsigned int first, unsigned int last) {
+		unsigned int* face;
+		for (unsigned int i = first; i < last; i++) {
+			face = this->mesh->facesVertices + (3 * i);
+			Eigen::AlignedBox3f box(positions[stride * face[0]]);
+			box.extend(positions[stride * face[1]]);
+			box.extend(positions[stride * face[2]]);
+			this->faces[i] = i;
+			this->facesBoxes[i] = box;
+			this->facesCentroids[i] = box.center();
+		}
+	}, BVH_GRAIN_SIZE);
+
+	/* Build the tree */
+
+	this->depth = this->BuildNode(0, nbFaces, this->nodes, 1);
+	this->nodes.shrink_to_fit();
+
+	// Bounds of the faces are not needed anymore
+	std::vector<Eigen::AlignedBox3f>().swap(this->facesBoxes);
+	std::vector<Eigen::Vector3f>().swap(this->facesCentroids);
+
+	/* Copy the faces in the order of the leaves */
+
+	this->triangles.resize(9 * (size_t) nbFaces);
+	ParallelFor(0, nbFaces, [&](unsigned int first, unsigned int last) {
+		unsigned int* face;
+		for (unsigned int i = first; i < last; i++) {
+			face = this->mesh->facesVertices + (3 * this->faces[i]);
+			const Eigen::Vector3f& vertex = positions[stride * face[0]];
+			Eigen::Map<Eigen::Vector3f>(this->triangles.data() + (9 * i)) =
+					vertex;
+			Eigen::Map<Eigen::Vector3f>(this->triangles.data() + (9 * i) + 3) =
+					positions[stride * face[1]] - vertex;
+			Eigen::Map<Eigen::Vector3f>(this->triangles.data() + (9 * i) + 6) =
+					positions[stride * face[2]] - vertex;
+		}
+	}, BVH_GRAIN_SIZE);
+
+	this->buildTime = std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+}
+
+BVH::~BVH() {}
+
+bool BVH::Intersect(const Eigen::Vector3f& origin,
+		const Eigen::Vector3f& direction, RayHit& hit,
+		float maxDistance) const {
+	if (this->nodes.empty())
+		return false;
+
+	Eigen::Vector3f inverse = direction.cwiseInverse();
+	bool negative[3] = {
+			(direction.x() < 0.), (direction.y() < 0.), (direction.z() < 0.) };
+
+	bool found = false;
+	float closest = maxDistance;
+	float t, u, v;
+
+	unsigned int stack[BVH_STACK_SIZE];
+	unsigned int stackSize = 0;
+	unsigned int current = 0;
+	while (true) {
+		const BVHNode& node = this->nodes[current];
+		if (IntersectBox(node, origin, inverse, closest)) {
+			if (node.nbFaces) {
+				// Test each face of the leaf
+				unsigned int last = node.offset + node.nbFaces;
+				for (unsigned int f = node.offset; f < last; f++) {
+					if (IntersectTriangle(this->triangles.data() + (9 * f),
+							origin, direction, closest, t, u, v)) {
+						found = true;
+						closest = t;
+						hit.face = this->faces[f];
+						hit.u = u;
+						hit.v = v;
+					}
+				}
+			} else {
+				// Visit the nearest child first
+				unsigned int nearChild = current + 1;
+				unsigned int farChild = current + node.offset;
+				if (negative[node.axis])
+					std::swap(nearChild, farChild);
+				stack[stackSize++] = farChild;
+				current = nearChild;
+				continue;
+			}
+		}
+
+		if (stackSize == 0)
+			break;
+		current = stack[--stackSize];
+	}
+
+	if (found) {
+		hit.distance = closest;
+		hit.position = origin + (closest * direction);
+	}
+	return found;
+}
+
+bool BVH::IntersectAny(const Eigen::Vector3f& origin,
+		const Eigen::Vector3f& direction, float maxDistance) const {
+	if (this->nodes.empty())
+		return false;
+
+	Eigen::Vector3f inverse = direction.cwiseInverse();
+	float t, u, v;
+
+	unsigned int stack[BVH_STACK_SIZE];
+	unsigned int stackSize = 0;
+	unsigned int current = 0;
+	while (true) {
+		const BVHNode& node = this->nodes[current];
+		if (IntersectBox(node, origin, inverse, maxDistance)) {
+			if (node.nbFaces) {
+				unsigned int last = node.offset + node.nbFaces;
+				for (unsigned int f = node.offset; f < last; f++) {
+					if (IntersectTriangle(this->triangles.data() + (9 * f),
+							origin, direction, maxDistance, t, u, v))
+						return true;
+				}
+			} else {
+				stack[stackSize++] = current + node.offset;
+				current = current + 1;
+				continue;
+			}
+		}
+
+		if (stackSize == 0)
+			break;
+		current = stack[--stackSize];
+	}
+
+	return false;
+}
+
+unsigned int BVH::GetNbNodes() const {
+	return this->nodes.size();
+}
+
+unsigned int BVH::GetDepth() const {
+	return this->depth;
+}
+
+float BVH::GetBuildTime() const {
+	return this->buildTime;
+}
+
+unsigned int BVH::BuildNode(unsigned int first, unsigned int last,
+		std::vector<BVHNode>& nodes, unsigned int depth) {
+	unsigned int nbFaces = last - first;
+	std::mutex mutex;
+
+	/* Compute the bounds of the node and of its faces’ centroids */
+
+	Eigen::AlignedBox3f box;
+	Eigen::AlignedBox3f centroidsBox;
+	ParallelFor(first, last, [&](unsigned int begin, unsigned int end) {
+		Eigen::AlignedBox3f localBox;
+		Eigen::AlignedBox3f localCentroidsBox;
+		for (unsigned int i = begin; i < end; i++) {
+			localBox.extend(this->facesBoxes[this->faces[i]]);
+			localCentroidsBox.extend(this->facesCentroids[this->faces[i]]);
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		box.extend(localBox);
+		centroidsBox.extend(localCentroidsBox);
+	}, BVH_GRAIN_SIZE);
+
+	unsigned int index = nodes.size();
+	nodes.push_back(BVHNode());
+	for (unsigned int a = 0; a < 3; a++) {
+		nodes[index].boxMin[a] = box.min()[a];
+		nodes[index].boxMax[a] = box.max()[a];
+	}
+
+	/* Find the best split along each axis */
+
+	Eigen::Vector3f extent = centroidsBox.sizes();
+	Eigen::Vector3f scale;
+	for (unsigned int a = 0; a < 3; a++)
+		scale[a] = (extent[a] > 0.) ? (BVH_NB_BINS / extent[a]) : 0.f;
+	auto getBin = [&centroidsBox, &scale](const Eigen::Vector3f& centroid,
+			unsigned int axis) {
+		return std::min(BVH_NB_BINS - 1, (int) ((centroid[axis]
+				- centroidsBox.min()[axis]) * scale[axis]));
+	};
+
+	int bestAxis = -1;
+	int bestBin = 0;
+	float bestCost = FLT_MAX;
+	if ((nbFaces > 1) && (depth < BVH_MAX_SAH_DEPTH)) {
+		// Put faces’ bounds in bins
+		Eigen::AlignedBox3f binsBoxes[3][BVH_NB_BINS];
+		unsigned int binsNbFaces[3][BVH_NB_BINS] = {};
+		ParallelFor(first, last, [&](unsigned int begin, unsigned int end) {
+			Eigen::AlignedBox3f localBoxes[3][BVH_NB_BINS];
+			unsigned int localNbFaces[3][BVH_NB_BINS] = {};
+			for (unsigned int i = begin; i < end; i++) {
+				unsigned int face = this->faces[i];
+				for (unsigned int a = 0; a < 3; a++) {
+					int bin = getBin(this->facesCentroids[face], a);
+					localBoxes[a][bin].extend(this->facesBoxes[face]);
+					localNbFaces[a][bin]++;
+				}
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			for (unsigned int a = 0; a < 3; a++) {
+				for (unsigned int b = 0; b < BVH_NB_BINS; b++) {
+					binsBoxes[a][b].extend(localBoxes[a][b]);
+					binsNbFaces[a][b] += localNbFaces[a][b];
+				}
+			}
+		}, BVH_GRAIN_SIZE);
+
+		// Sweep the bins from both sides to evaluate each split
+		for (unsigned int a = 0; a < 3; a++) {
+			if (extent[a] <= 0.)
+				continue;
+
+			float rightCosts[BVH_NB_BINS];
+			Eigen::AlignedBox3f sideBox;
+			unsigned int sideNbFaces = 0;
+			for (int b = BVH_NB_BINS - 1; b > 0; b--) {
+				sideBox.extend(binsBoxes[a][b]);
+				sideNbFaces += binsNbFaces[a][b];
+				rightCosts[b] = GetHalfArea(sideBox) * sideNbFaces;
+			}
+
+			sideBox.setEmpty();
+			sideNbFaces = 0;
+			for (int b = 0; b < BVH_NB_BINS - 1; b++) {
+				sideBox.extend(binsBoxes[a][b]);
+				sideNbFaces += binsNbFaces[a][b];
+				float cost = (GetHalfArea(sideBox) * sideNbFaces)
+						+ rightCosts[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = a;
+					bestBin = b;
+				}
+			}
+		}
+	}
+
+	/* Make a leaf if splitting isn’t worth it */
+
+	float area = GetHalfArea(box);
+	float leafCost = area * nbFaces;
+	bestCost += BVH_TRAVERSAL_COST * area;
+	if ((nbFaces <= this->maxLeafFaces)
+			&& ((bestAxis < 0) || (leafCost <= bestCost))) {
+		nodes[index].offset = first;
+		nodes[index].nbFaces = nbFaces;
+		nodes[index].axis = 0;
+		return depth;
+	}
+
+	/* Split the faces */
+
+	unsigned int middle = first;
+	if (bestAxis >= 0) {
+		middle = std::partition(this->faces.begin() + first,
+				this->faces.begin() + last,
+				[this, &getBin, bestAxis, bestBin](unsigned int face) {
+			return getBin(this->facesCentroids[face], bestAxis) <= bestBin;
+		}) - this->faces.begin();
+	}
+
+	// Split by the middle if all centroids are at the same place or if the
+	// tree is too deep
+	if ((middle == first) || (middle == last)) {
+		unsigned int a = 0;
+		centroidsBox.sizes().maxCoeff(&a);
+		bestAxis = a;
+		middle = first + (nbFaces / 2);
+		std::nth_element(this->faces.begin() + first,
+				this->faces.begin() + middle, this->faces.begin() + last,
+				[this, a](unsigned int f0, unsigned int f1) {
+			float c0 = this->facesCentroids[f0][a];
+			float c1 = this->facesCentroids[f1][a];
+			if (c0 != c1)
+				return c0 < c1;
+			return f0 < f1;
+		});
+	}
+
+	nodes[index].nbFaces = 0;
+	nodes[index].axis = bestAxis;
+
+	/* Build the children */
+
+	unsigned int leftDepth = depth;
+	unsigned int rightDepth = depth;
+	if (nbFaces >= BVH_PARALLEL_NB_FACES) {
+		// Build the second child in its own list, then append it
+		std::vector<BVHNode> rightNodes;
+		ParallelFor(0, 2, [&](unsigned int begin, unsigned int end) {
+			for (unsigned int c = begin; c < end; c++) {
+				if (c == 0)
+					leftDepth = this->BuildNode(first, middle, nodes,
+							depth + 1);
+				else
+					rightDepth = this->BuildNode(middle, last, rightNodes,
+							depth + 1);
+			}
+		}, 1);
+		nodes[index].offset = nodes.size() - index;
+		nodes.insert(nodes.end(), rightNodes.begin(), rightNodes.end());
+	} else {
+		leftDepth = this->BuildNode(first, middle, nodes, depth + 1);
+		nodes[index].offset = nodes.size() - index;
+		rightDepth = this->BuildNode(middle, last, nodes, depth + 1);
+	}
+
+	return std::max(leftDepth, rightDepth);
+}
@@ -17,7 +17,8 @@ int CLILoader::LoadContext(void *c, int argc, char **argv) {
 	bool benchmarkMode = false, noBenchmarkMode = false, debugMode = false,
 			noDebugMode = false, darkMode = false, lightMode = false,
 			simpleShadingMode = false, forwardShadingMode = false,
-			forceUnsortedMeshMode = false;
+			forceUnsortedMeshMode = false, compactVerticesMode = false,
+			soaVerticesMode = false, pullingVerticesMode = false;
 
 	/* Set CLI options */
 
@@ -46,6 +47,13 @@ int CLILoader::LoadContext(void *c, int argc, char **argv) {
 			forceUnsortedMeshMode,
 			"Force the program to don’t sort the input mesh if it needs to");
 
+	app.add_flag("--cv, --compact-vertices", compactVerticesMode,
+			"Upload the mesh’s vertices quantized in a compact format");
+	app.add_flag("--soa", soaVerticesMode,
+			"Store each attribute of the mesh’s vertices in its own array");
+	app.add_flag("--pv, --pull-vertices", pullingVerticesMode,
+			"Pull the mesh’s vertices from buffers in the vertex shaders");
+
 	CLI::Option *benchmark = app.add_flag("-b, --benchmark",
 			benchmarkMode,
 			"Run the program in benchmark mode");
@@ -118,6 +126,18 @@ int CLILoader::LoadContext(void *c, int argc, char **argv) {
 	if (forceUnsortedMeshMode)
 		context->SetForceUnsortedMesh(forceUnsortedMeshMode);
 
+	// Compact vertices
+	if (compactVerticesMode)
+		context->SetCompactVertices(compactVerticesMode);
+
+	// Structure of arrays
+	if (soaVerticesMode)
+		context->SetSoAVertices(soaVerticesMode);
+
+	// Vertex pulling
+	if (pullingVerticesMode)
+		context->SetPullingVertices(pullingVerticesMode);
+
 	// Benchmark mode
 	if (benchmarkMode || noBenchmarkMode)
 		context->SetBenchmarkMode(benchmarkMode);
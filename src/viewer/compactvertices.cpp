@@ -0,0 +1,189 @@
+#include "compactvertices.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "parallel.h"
+
+// Minimum number of vertices encoded by each worker thread
+#define COMPACT_VERTICES_GRAIN_SIZE 16384
+
+// Largest values of the normalized integers
+#define UNORM8_MAX	255.f
+#define UNORM16_MAX	65535.f
+#define SNORM16_MAX	32767.f
+
+static float Clamp(float value, float min, float max) {
+	return std::min(std::max(value, min), max);
+}
+
+static float SignNotZero(float value) {
+	return (value >= 0.) ? 1. : -1.;
+}
+
+void EncodeOctahedral(const Eigen::Vector3f& normal, short* result) {
+	float length = std::abs(normal.x()) + std::abs(normal.y())
+			+ std::abs(normal.z());
+	float x = 0., y = 0.;
+	if (length > 0.) {
+		x = normal.x() / length;
+		y = normal.y() / length;
+		// Fold the lower half of the octahedron over the upper one
+		if (normal.z() < 0.) {
+			float foldedX = (1. - std::abs(y)) * SignNotZero(x);
+			y = (1. - std::abs(x)) * SignNotZero(y);
+			x = foldedX;
+		}
+	}
+	result[0] = (short) std::round(Clamp(x, -1., 1.) * SNORM16_MAX);
+	result[1] = (short) std::round(Clamp(y, -1., 1.) * SNORM16_MAX);
+}
+
+Eigen::Vector3f DecodeOctahedral(const short* encoded) {
+	// Same conversion as OpenGL for signed normalized integers
+	Eigen::Vector3f normal(
+			std::max(encoded[0] / SNORM16_MAX, -1.f),
+			std::max(encoded[1] / SNORM16_MAX, -1.f),
+			0.);
+	normal.z() = 1. - std::abs(normal.x()) - std::abs(normal.y());
+	float t = std::max(-normal.z(), 0.f);
+	normal.x() += (normal.x() >= 0.) ? -t : t;
+	normal.y() += (normal.y() >= 0.) ? -t : t;
+	return normal.normalized();
+}
+
+CompactVertices::CompactVertices(Mesh* mesh)
+		: mesh(mesh) {
+	if (this->mesh == nullptr)
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+
+	/* Layout */
+
+	// Positions are padded to 8 bytes so that each attribute is aligned on 4
+	this->haveColors = this->mesh->HaveColors();
+	this->normalOffset = 4 * sizeof(unsigned short);
+	this->colorOffset = this->normalOffset + (2 * sizeof(short));
+	this->stride = this->colorOffset
+			+ (this->haveColors ? 4 * sizeof(unsigned char) : 0);
+	this->size = (size_t) this->stride * this->mesh->nbVertices;
+
+	Eigen::AlignedBox3f boundingBox = this->mesh->GetBoundingBox();
+	if (!boundingBox.isEmpty()) {
+		this->positionOffset = boundingBox.min();
+		this->positionScale = boundingBox.sizes();
+	}
+
+	/* Encoding */
+
+	this->data.resize(this->size);
+	Eigen::Vector3f inverseScale;
+	for (unsigned int c = 0; c < 3; c++) {
+		inverseScale[c] = (this->positionScale[c] > 0.)
+				? (UNORM16_MAX / this->positionScale[c]) : 0.f;
+	}
+	ParallelFor(0, this->mesh->nbVertices,
+			[this, &inverseScale](unsigned int first, unsigned int last) {
+		for (unsigned int v = first; v < last; v++) {
+			unsigned char* destination = this->data.data()
+					+ ((size_t) this->stride * v);
+
+			const Eigen::Vector3f& vertexPosition = this->mesh->GetPosition(v);
+			unsigned short position[4] = { 0, 0, 0, 0 };
+			for (unsigned int c = 0; c < 3; c++) {
+				position[c] = (unsigned short) std::round(Clamp(
+						(vertexPosition[c] - this->positionOffset[c])
+								* inverseScale[c],
+						0., UNORM16_MAX));
+			}
+			memcpy(destination, position, sizeof(position));
+
+			short normal[2];
+			EncodeOctahedral(this->mesh->GetNormal(v), normal);
+			memcpy(destination + this->normalOffset, normal, sizeof(normal));
+
+			if (this->haveColors) {
+				const Eigen::Vector3f& vertexColor = this->mesh->GetColor(v);
+				unsigned char* color = destination + this->colorOffset;
+				for (unsigned int c = 0; c < 3; c++) {
+					color[c] = (unsigned char) std::round(
+							Clamp(vertexColor[c], 0., 1.) * UNORM8_MAX);
+				}
+				color[3] = (unsigned char) UNORM8_MAX;
+			}
+		}
+	}, COMPACT_VERTICES_GRAIN_SIZE);
+
+	this->encodingTime = std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+}
+
+CompactVertices::~CompactVertices() {}
+
+void CompactVertices::ReleaseData() {
+	std::vector<unsigned char>().swap(this->data);
+}
+
+Eigen::Vector3f CompactVertices::DecodePosition(unsigned int vertex) const {
+	unsigned short position[4];
+	memcpy(position, this->data.data() + ((size_t) this->stride * vertex),
+			sizeof(position));
+	return this->positionOffset + Eigen::Vector3f(
+			position[0] / UNORM16_MAX,
+			position[1] / UNORM16_MAX,
+			position[2] / UNORM16_MAX).cwiseProduct(this->positionScale);
+}
+
+Eigen::Vector3f CompactVertices::DecodeNormal(unsigned int vertex) const {
+	short normal[2];
+	memcpy(normal, this->data.data() + ((size_t) this->stride * vertex)
+			+ this->normalOffset, sizeof(normal));
+	return DecodeOctahedral(normal);
+}
+
+Eigen::Vector3f CompactVertices::DecodeColor(unsigned int vertex) const {
+	if (!this->haveColors)
+		return this->mesh->GetColor(vertex);
+	const unsigned char* color = this->data.data()
+			+ ((size_t) this->stride * vertex) + this->colorOffset;
+	return Eigen::Vector3f(color[0], color[1], color[2]) / UNORM8_MAX;
+}
+
+const unsigned char* CompactVertices::GetData() const {
+	return this->data.empty() ? nullptr : this->data.data();
+}
+
+size_t CompactVertices::GetSize() const {
+	return this->size;
+}
+
+unsigned int CompactVertices::GetStride() const {
+	return this->stride;
+}
+
+unsigned int CompactVertices::GetNormalOffset() const {
+	return this->normalOffset;
+}
+
+unsigned int CompactVertices::GetColorOffset() const {
+	return this->colorOffset;
+}
+
+bool CompactVertices::HaveColors() const {
+	return this->haveColors;
+}
+
+const Eigen::Vector3f& CompactVertices::GetPositionOffset() const {
+	return this->positionOffset;
+}
+
+const Eigen::Vector3f& CompactVertices::GetPositionScale() const {
+	return this->positionScale;
+}
+
+float CompactVertices::GetEncodingTime() const {
+	return this->encodingTime;
+}
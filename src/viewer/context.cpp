@@ -3,6 +3,9 @@
 #include <Eigen/Geometry>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
 #include <string>
 #include <fstream>
 #include <iostream>
@@ -18,7 +21,10 @@
 #include "utils.h"
 
 Context::Context(std::string glslVersion)
-		: glslVersion(glslVersion) {}
+		: glslVersion(glslVersion)
+		, programCache(new ProgramCache())
+		, shaderPreprocessor(new ShaderPreprocessor())
+		, renderTargets(new RenderTargetManager()) {}
 
 Context::~Context() {
 	/* Cleanup memory */
@@ -33,6 +39,11 @@ Context::~Context() {
 		delete this->viewer;
 	if (this->scene != nullptr)
 		delete this->scene;
+	// (Programs are deleted once all shaders readers released them.)
+	delete this->programCache;
+	delete this->shaderPreprocessor;
+	// (Renderers already released their targets.)
+	delete this->renderTargets;
 	if (this->materialsPaths != nullptr)
 		delete this->materialsPaths;
 
@@ -49,7 +60,20 @@ void Context::Launch() {
 	while (!glfwWindowShouldClose(window) && !this->readyToDie) {
 		/* Poll latest events */
 
-		glfwPollEvents();
+		// Without anything to draw, block until an event comes (or until the
+		// timeout, to check watched files)
+		if (this->renderOnDemand && (this->nbPendingFrames == 0)) {
+			double waitStart = glfwGetTime();
+			glfwWaitEventsTimeout(RENDER_ON_DEMAND_TIMEOUT);
+			// (Any event wakes the loop up before the timeout, even those
+			// only handled by ImGui.)
+			if ((glfwGetTime() - waitStart) < RENDER_ON_DEMAND_TIMEOUT)
+				this->AskForRedraw();
+		} else {
+			glfwPollEvents();
+			if (this->nbPendingFrames > 0)
+				this->nbPendingFrames--;
+		}
 
 		/* Start new ImGui frame */
 
@@ -78,10 +102,22 @@ void Context::Launch() {
 		glfwSwapBuffers(window);
 
 		this->frameCount++;
+
+		// (Renders may go on, e.g. while shaders are compiled.)
+		if (this->viewer->WasSceneRendered())
+			this->nbPendingFrames = std::max(this->nbPendingFrames, 1u);
 	}
 }
 
 void Context::LaunchBenchmark() {
+	this->BenchmarkShaders();
+	this->BenchmarkBVH();
+	this->BenchmarkVertexLayouts();
+	this->BenchmarkLights();
+	this->BenchmarkMaterialsLookup();
+
+	// (Every frame is rendered, so that frame rates stay comparable.)
+	this->renderOnDemand = false;
 	glfwSwapInterval(0);
 	float beginTime = static_cast<float>(glfwGetTime());
 
@@ -227,12 +263,15 @@ int Context::LoadOptions(int argc, char** argv) {
 		return res;
 
 	// Update number of point light
+	// (The renderer is only updated once all lights are added.)
 	if (this->benchmarkMode && (nbPointLight > DEFAULT_NB_POINT_LIGHT)) {
+		this->scene->BeginUpdate();
 		for (int i = 1; i < this->nbPointLight; i++){
 			this->scene->AddRandomPointLight(
 					new PointLight(Eigen::Vector3f(1.f, 1.f, 1.f),
 							Eigen::Vector3f(1.f, 1.f, 1.f)));
 		}
+		this->scene->EndUpdate();
 	}
 
 	// PLY file to load
@@ -294,6 +333,35 @@ void Context::ZoomCamera(float intensity) {
 	}
 }
 
+void Context::PickMesh(const Eigen::Vector2f& position, bool pivot) {
+	Scene* scene = this->GetScene();
+	if ((scene == nullptr) || (scene->GetMesh() == nullptr))
+		return;
+
+	if (this->picking == nullptr) {
+		this->picking = new PickingModule(this);
+		this->AddModule(this->picking);
+	}
+
+	// Build the hierarchy first, so that it isn’t part of the query time
+	scene->GetMesh()->GetBVH();
+
+	RayHit hit;
+	auto start = std::chrono::steady_clock::now();
+	bool found = scene->PickMesh(position, hit);
+	float queryTime = std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	this->picking->SetResult(found, hit, queryTime);
+
+	// Turn the camera around the picked point
+	if (found && pivot && (scene->GetCamera() != nullptr)) {
+		Eigen::Vector4f center = scene->GetMeshTransformationMatrix()
+				* hit.position.homogeneous();
+		scene->navigate3D = false;
+		scene->GetCamera()->SetSceneCenter(center.head<3>());
+	}
+}
+
 void Context::ReloadShaders() {
 	if (this->viewer != nullptr) {
 		Renderer* renderer = this->viewer->GetRenderer();
@@ -302,6 +370,35 @@ void Context::ReloadShaders() {
 	}
 }
 
+void Context::ReloadModifiedShaders() {
+	if (!this->watchShaders || (this->viewer == nullptr))
+		return;
+	Renderer* renderer = this->viewer->GetRenderer();
+	if (renderer == nullptr)
+		return;
+
+	// (Files are watched by `WatchShaders()` when shaders change.)
+	std::vector<std::string> modifiedFiles = this->shadersWatcher.Poll();
+	if (modifiedFiles.empty())
+		return;
+	renderer->ReloadShaders(modifiedFiles);
+}
+
+void Context::WatchShaders(Renderer* renderer) {
+	if (!this->watchShaders || (renderer == nullptr))
+		return;
+
+	// (Already watched files are skipped, so new materials are picked up.)
+	ShadersReader** shaders = renderer->GetShaders();
+	for (unsigned char i = 0; (shaders != nullptr)
+			&& (i < renderer->GetNbShaders()); i++) {
+		if (shaders[i] == nullptr)
+			continue;
+		for (const std::string& path: shaders[i]->GetDependencies())
+			this->shadersWatcher.Watch(path);
+	}
+}
+
 void Context::ResetDefaultMaterialsPaths() {
 	if (this->materialsPaths == nullptr)
 		this->materialsPaths = new MaterialList(DEFAULT_DEF_MATERIAL);
@@ -334,6 +431,14 @@ void Context::ToggleDebugMode() {
 	this->debugMode = !this->debugMode;
 }
 
+void Context::ToggleShadersWatching() {
+	this->watchShaders = !this->watchShaders;
+	// (Files modified meanwhile aren't reloaded once watched again.)
+	this->shadersWatcher.Clear();
+	if (this->viewer != nullptr)
+		this->WatchShaders(this->viewer->GetRenderer());
+}
+
 void Context::Quit() {
 	this->readyToDie = true;
 }
@@ -416,8 +521,29 @@ void Context::ToggleImGuiFPSModule() {
 	}
 }
 
+void Context::ToggleRenderingStatsModule() {
+	if (this->renderingStats == nullptr) {
+		this->renderingStats = new RenderingStatsModule(this);
+		this->AddModule(this->renderingStats);
+	} else {
+		this->renderingStats->Kill();
+		this->renderingStats = nullptr;
+	}
+}
+
+void Context::TogglePickingModule() {
+	if (this->picking == nullptr) {
+		this->picking = new PickingModule(this);
+		this->AddModule(this->picking);
+	} else {
+		this->picking->Kill();
+		this->picking = nullptr;
+	}
+}
+
 void Context::ProcessKeyboardInput(int key, int scancode, int action,
 		int mods) {
+	this->AskForRedraw();
 	if (action == GLFW_PRESS) {
 		if (mods == GLFW_MOD_CONTROL) {
 			switch (key) {
@@ -527,6 +653,7 @@ void Context::ProcessKeyboardInput(int key, int scancode, int action,
 }
 
 void Context::ProcessMouseMovement(double x, double y) {
+	this->AskForRedraw();
 	if (mouseLeftPressed){
 		this->scene->navigate3D = true;
 		float xpos = static_cast<float>(x);
@@ -558,6 +685,7 @@ void Context::ProcessMouseMovement(double x, double y) {
 }
 
 void Context::ProcessMouseButton(int button, int action, int mods) {
+	this->AskForRedraw();
 	if (button == GLFW_MOUSE_BUTTON_1) {
 		if (action == GLFW_PRESS) {
 			mouseLeftPressed = true;
@@ -569,6 +697,7 @@ void Context::ProcessMouseButton(int button, int action, int mods) {
 }
 
 void Context::ProcessMouseScroll(double x, double y) {
+	this->AskForRedraw();
 	this->ZoomCamera(-y);
 }
 
@@ -580,6 +709,10 @@ void Context::AskForUpdate() {
 	this->needToUpdate = true;
 }
 
+void Context::AskForRedraw() {
+	this->nbPendingFrames = RENDER_ON_DEMAND_NB_FRAMES;
+}
+
 void Context::AddModule(GUIModule* module) {
 	if (module != nullptr)
 		this->modules.push_back(module);
@@ -588,14 +721,18 @@ void Context::AddModule(GUIModule* module) {
 void Context::SetMesh(Mesh* mesh) {
 	if (this->scene == nullptr) {
 		this->scene = new Scene();
+		this->scene->SetCompactVertices(this->compactVerticesMode);
 		if (this->viewer == nullptr)
 			this->viewer = new ViewerModule(this);
 		this->viewer->GetRenderer()->SetScene(this->scene);
 	}
 	this->scene->SetMesh(mesh);
+	if (this->picking != nullptr)
+		this->picking->ClearResult();
 	if (this->viewer != nullptr) {
 		Renderer* renderer = this->viewer->GetRenderer();
 		if (renderer != nullptr) {
+			renderer->SetPullingVertices(this->pullingVerticesMode);
 			if (renderer->IsRenderingPerMaterial() && (!mesh->IsSorted()))
 				renderer->SetRenderingPerMaterial(false);
 			else
@@ -667,6 +804,37 @@ bool Context::GetForceUnsortedMesh() {
 	return this->forceUnsortedMeshMode;
 }
 
+void Context::SetCompactVertices(bool value) {
+	this->compactVerticesMode = value;
+	if (this->scene != nullptr)
+		this->scene->SetCompactVertices(value);
+}
+
+bool Context::GetCompactVertices() {
+	return this->compactVerticesMode;
+}
+
+void Context::SetSoAVertices(bool value) {
+	this->soaVerticesMode = value;
+}
+
+bool Context::GetSoAVertices() {
+	return this->soaVerticesMode;
+}
+
+void Context::SetPullingVertices(bool value) {
+	this->pullingVerticesMode = value;
+	if (this->viewer != nullptr) {
+		Renderer* renderer = this->viewer->GetRenderer();
+		if (renderer != nullptr)
+			renderer->SetPullingVertices(value);
+	}
+}
+
+bool Context::GetPullingVertices() {
+	return this->pullingVerticesMode;
+}
+
 void Context::SetBenchmarkMode(bool benchmark) {
 	this->benchmarkMode = benchmark;
 }
@@ -675,6 +843,15 @@ bool Context::GetBenchmarkMode() {
 	return this->benchmarkMode;
 }
 
+void Context::SetRenderOnDemand(bool value) {
+	this->renderOnDemand = value;
+	this->AskForRedraw();
+}
+
+bool Context::GetRenderOnDemand() {
+	return this->renderOnDemand;
+}
+
 void Context::SetDebugMode(bool debug) {
 	this->debugMode = debug;
 }
@@ -714,6 +891,27 @@ GLFWwindow* Context::GetWindow() {
 	return this->window;
 }
 
+Scene* Context::GetScene() {
+	if (this->viewer == nullptr)
+		return nullptr;
+	Renderer* renderer = this->viewer->GetRenderer();
+	if (renderer == nullptr)
+		return nullptr;
+	return renderer->GetScene();
+}
+
+ProgramCache* Context::GetProgramCache() {
+	return this->programCache;
+}
+
+ShaderPreprocessor* Context::GetShaderPreprocessor() {
+	return this->shaderPreprocessor;
+}
+
+RenderTargetManager* Context::GetRenderTargets() {
+	return this->renderTargets;
+}
+
 void Context::RenderMenuBar() {
 	if (ImGui::BeginMainMenuBar()) {
 		if (ImGui::BeginMenu("File")) {
@@ -777,9 +975,44 @@ void Context::RenderMenuBar() {
 									renderer->GetShaders(), nbMaterials);
 						}
 					}
+					if (ImGui::MenuItem("Use a materials table", "",
+							renderer->IsUsingMaterialsTable(),
+							!renderingPerMaterial)) {
+						renderer->SetUsingMaterialsTable(
+								!renderer->IsUsingMaterialsTable());
+						if (this->shadersContent != nullptr) {
+							this->shadersContent->SetShaders(
+									renderer->GetNbShaders(),
+									renderer->GetShaders());
+						}
+					}
+					if (ImGui::MenuItem("Read materials from vertices", "",
+							renderer->IsUsingProvokingMaterials(),
+							!renderingPerMaterial)) {
+						renderer->SetUsingProvokingMaterials(
+								!renderer->IsUsingProvokingMaterials());
+						if (this->shadersContent != nullptr) {
+							this->shadersContent->SetShaders(
+									renderer->GetNbShaders(),
+									renderer->GetShaders());
+						}
+					}
+					if (ImGui::MenuItem("Batch per-material draws", "",
+							renderer->IsBatchingMaterials(),
+							renderingPerMaterial)) {
+						renderer->SetBatchingMaterials(
+								!renderer->IsBatchingMaterials());
+						if (this->shadersContent != nullptr) {
+							this->shadersContent->SetShaders(
+									renderer->GetNbShaders(),
+									renderer->GetShaders());
+						}
+					}
 					ImGui::EndMenu();
 				}
+				Scene* scene = renderer->GetScene();
 				if (ImGui::BeginMenu("Facet culling")) {
+					bool facetCullingChanged = false;
 					int facetCullingIsEnabled = (int) glIsEnabled(GL_CULL_FACE);
 					if (ImGui::MenuItem("Enable facet culling", "",
 							facetCullingIsEnabled)) {
@@ -787,28 +1020,69 @@ void Context::RenderMenuBar() {
 							glDisable(GL_CULL_FACE);
 						else
 							glEnable(GL_CULL_FACE);
+						facetCullingChanged = true;
 					}
 					ImGui::Separator();
 					int faceCullingMode;
 					glGetIntegerv(GL_CULL_FACE_MODE, &faceCullingMode);
 					if (ImGui::MenuItem("Front and back", "",
-							(faceCullingMode == GL_FRONT_AND_BACK)))
+							(faceCullingMode == GL_FRONT_AND_BACK))) {
 						glCullFace(GL_FRONT_AND_BACK);
+						facetCullingChanged = true;
+					}
 					if (ImGui::MenuItem("Front only", "",
-							(faceCullingMode == GL_FRONT)))
+							(faceCullingMode == GL_FRONT))) {
 						glCullFace(GL_FRONT);
+						facetCullingChanged = true;
+					}
 					if (ImGui::MenuItem("Back only", "",
-							(faceCullingMode == GL_BACK)))
+							(faceCullingMode == GL_BACK))) {
 						glCullFace(GL_BACK);
+						facetCullingChanged = true;
+					}
+					// (Culled clusters depend on the facet culling state.)
+					if (facetCullingChanged && (scene != nullptr))
+						scene->AskForRender();
 					ImGui::EndMenu();
 				}
+				if ((scene != nullptr) && ImGui::MenuItem(
+						"Enable cluster culling", "",
+						scene->IsClusterCullingEnabled()))
+					scene->SetClusterCulling(!scene->IsClusterCullingEnabled());
+				ClusterCuller* culler =
+						(scene != nullptr) ? scene->GetClusterCuller() : nullptr;
+				if ((culler != nullptr) && ImGui::MenuItem(
+						"Enable occlusion culling", "",
+						culler->IsOcclusionCullingEnabled(),
+						scene->IsClusterCullingEnabled())) {
+					culler->SetOcclusionCulling(
+							!culler->IsOcclusionCullingEnabled());
+					scene->AskForRender();
+				}
+				if ((scene != nullptr) && ImGui::MenuItem(
+						"Enable compact vertices", "",
+						scene->IsCompactVerticesEnabled()))
+					this->SetCompactVertices(
+							!scene->IsCompactVerticesEnabled());
+				if (ImGui::MenuItem("Pull vertices in shaders", "",
+						this->pullingVerticesMode))
+					this->SetPullingVertices(!this->pullingVerticesMode);
 				ImGui::Separator();
 				if (ImGui::MenuItem("Reload shaders", "R"))
 					this->ReloadShaders();
+				if (ImGui::MenuItem("Watch shaders files", "",
+						this->watchShaders))
+					this->ToggleShadersWatching();
+				if (ImGui::MenuItem("Render on demand", "",
+						this->renderOnDemand))
+					this->SetRenderOnDemand(!this->renderOnDemand);
 				ImGui::Separator();
 			}
 			if (ImGui::MenuItem("Show tools", "Tab", this->showTools))
 				this->showTools = !this->showTools;
+			if (ImGui::MenuItem("Show picking", "",
+					(this->picking != nullptr)))
+				this->TogglePickingModule();
 			if (ImGui::MenuItem("Enable dark mode", "", this->darkMode))
 				this->ToggleDarkMode();
 			if (ImGui::MenuItem("Enable debug menu", "", this->debugMode))
@@ -829,6 +1103,57 @@ void Context::RenderMenuBar() {
 				if (ImGui::MenuItem("Show FPS", "",
 						(this->imguiFPS != nullptr)))
 					this->ToggleImGuiFPSModule();
+				if (ImGui::MenuItem("Show rendering statistics", "",
+						(this->renderingStats != nullptr)))
+					this->ToggleRenderingStatsModule();
+				if (ImGui::BeginMenu("Shaders cache")) {
+					ImGui::Text("Programs: %u (%u used, capacity %u)",
+							this->programCache->GetSize(),
+							this->programCache->GetNbUsedPrograms(),
+							this->programCache->GetCapacity());
+					ImGui::Text("Hits: %u", this->programCache->GetNbHits());
+					ImGui::Text("Misses: %u",
+							this->programCache->GetNbMisses());
+					ImGui::Text("Shader objects: %u (%u compiled, %u reused)",
+							this->programCache->GetNbShaders(),
+							this->programCache->GetNbCompiledShaders(),
+							this->programCache->GetNbReusedShaders());
+					ImGui::Text("Compiled: %u (%.1f ms)",
+							this->programCache->GetNbCompiledPrograms(),
+							this->programCache->GetCompilationTime());
+					ImGui::Text("Loaded from binaries: %u (%.1f ms)",
+							this->programCache->GetNbLoadedBinaries(),
+							this->programCache->GetBinariesLoadingTime());
+					ImGui::Text("Source files: %u (%u read)",
+							this->shaderPreprocessor->GetNbCachedFiles(),
+							this->shaderPreprocessor->GetNbFileReads());
+					if (ImGui::MenuItem("Clear unused programs")) {
+						this->programCache->Clear();
+						this->shaderPreprocessor->Clear();
+					}
+					if (ImGui::MenuItem("Reset statistics"))
+						this->programCache->ResetStatistics();
+					ImGui::EndMenu();
+				}
+				if (ImGui::BeginMenu("Render targets")) {
+					ImGui::Text("Targets: %u",
+							this->renderTargets->GetNbTargets());
+					ImGui::Text("Attachments: %u (%u used, %.2f MiB)",
+							this->renderTargets->GetNbAttachments(),
+							this->renderTargets->GetNbUsedAttachments(),
+							this->renderTargets->GetMemorySize() / 1048576.);
+					ImGui::Text("Allocations: %u",
+							this->renderTargets->GetNbAllocations());
+					ImGui::Text("Reuses: %u",
+							this->renderTargets->GetNbReuses());
+					ImGui::Text("Resizes: %u",
+							this->renderTargets->GetNbResizes());
+					if (ImGui::MenuItem("Clear unused attachments"))
+						this->renderTargets->Clear();
+					if (ImGui::MenuItem("Reset statistics"))
+						this->renderTargets->ResetStatistics();
+					ImGui::EndMenu();
+				}
 				ImGui::EndMenu();
 			}
 		}
@@ -843,6 +1168,7 @@ void Context::Render() {
 	if (this->showTools)
 		this->RenderMenuBar();
 
+	this->ReloadModifiedShaders();
 	this->viewer->Render();
 
 	if (this->showTools) {
@@ -862,3 +1188,199 @@ void Context::Update() {
 	}
 	this->needToUpdate = false;
 }
+
+void Context::BenchmarkShaders() {
+	// Wait for the programs compiled at startup, so that all are counted
+	// (Only preprocessing, compilation and linkage are timed, not frames.)
+	Renderer* renderer = this->viewer->GetRenderer();
+	ShadersReader** shaders = renderer->GetShaders();
+	for (unsigned char i = 0; (shaders != nullptr)
+			&& (i < renderer->GetNbShaders()); i++) {
+		if (shaders[i] != nullptr)
+			shaders[i]->Finish(true);
+	}
+
+	std::fstream shadersFile;
+	shadersFile.open("out/shaders.csv", std::ios::app);
+	shadersFile << this->programCache->GetNbCompiledPrograms() << ", "
+			<< this->programCache->GetCompilationTime() << ", "
+			<< this->programCache->GetNbLoadedBinaries() << ", "
+			<< this->programCache->GetBinariesLoadingTime() << std::endl;
+	shadersFile.close();
+}
+
+void Context::BenchmarkBVH() {
+	Scene* scene = this->GetScene();
+	Mesh* mesh = (scene != nullptr) ? scene->GetMesh() : nullptr;
+	if ((mesh == nullptr) || (mesh->nbFaces == 0))
+		return;
+
+	BVH* bvh = mesh->GetBVH();
+
+	// Cast rays from around the mesh towards random points inside it
+	// (A fixed seed gives the same rays on each run.)
+	Eigen::AlignedBox3f box = mesh->GetBoundingBox();
+	Eigen::Vector3f center = box.center();
+	float radius = box.sizes().norm();
+	std::minstd_rand generator(42);
+	std::uniform_real_distribution<float> distribution(0., 1.);
+	std::vector<Eigen::Vector3f> origins(BENCHMARK_BVH_NB_RAYS);
+	std::vector<Eigen::Vector3f> directions(BENCHMARK_BVH_NB_RAYS);
+	for (unsigned int i = 0; i < BENCHMARK_BVH_NB_RAYS; i++) {
+		Eigen::Vector3f target = box.min() + box.sizes().cwiseProduct(
+				Eigen::Vector3f(distribution(generator),
+						distribution(generator), distribution(generator)));
+		Eigen::Vector3f offset(distribution(generator) - .5f,
+				distribution(generator) - .5f, distribution(generator) - .5f);
+		origins[i] = center + radius * offset.normalized();
+		directions[i] = (target - origins[i]).normalized();
+	}
+
+	unsigned int nbHits = 0;
+	RayHit hit;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < BENCHMARK_BVH_NB_RAYS; i++)
+		nbHits += bvh->Intersect(origins[i], directions[i], hit);
+	float queryTime = std::chrono::duration<float>(
+			std::chrono::steady_clock::now() - start).count();
+
+	/* Write the results to CSV */
+
+	std::fstream bvhFile;
+	bvhFile.open("out/bvh.csv", std::ios::app);
+	bvhFile << mesh->nbFaces << ", " << bvh->GetBuildTime() << ", "
+			<< (BENCHMARK_BVH_NB_RAYS / queryTime) << ", " << nbHits
+			<< std::endl;
+	bvhFile.close();
+}
+
+void Context::BenchmarkVertexLayouts() {
+	Scene* scene = this->GetScene();
+	Mesh* mesh = (scene != nullptr) ? scene->GetMesh() : nullptr;
+	if ((mesh == nullptr) || (mesh->nbVertices == 0))
+		return;
+
+	std::fstream layoutFile;
+	layoutFile.open("out/layout.csv", std::ios::app);
+	layoutFile << mesh->nbVertices;
+	for (bool soa : { false, true }) {
+		Mesh* copy = new Mesh(mesh, soa);
+
+		// Build the adjacency first, it doesn't depend on the layout
+		copy->GetAdjacency();
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < BENCHMARK_LAYOUT_NB_RUNS; i++)
+			copy->ComputeBoundsAndNormals();
+		float passesTime = std::chrono::duration<float, std::milli>(
+				std::chrono::steady_clock::now() - start).count()
+				/ BENCHMARK_LAYOUT_NB_RUNS;
+
+		layoutFile << ", " << passesTime << ", "
+				<< copy->GetBVH()->GetBuildTime();
+		delete copy;
+	}
+	layoutFile << std::endl;
+	layoutFile.close();
+}
+
+void Context::BenchmarkLights() {
+	Renderer* renderer = (this->viewer != nullptr)
+			? this->viewer->GetRenderer() : nullptr;
+	if ((this->scene == nullptr) || (renderer == nullptr))
+		return;
+
+	std::fstream lightsFile;
+	lightsFile.open("out/lights.csv", std::ios::app);
+	for (unsigned int nbLights : { 1u, 250u, 5000u }) {
+		// Create a scene with its lights, as when starting with --pl
+		// (Without a renderer, the scene doesn't update anything.)
+		auto start = std::chrono::steady_clock::now();
+		Scene* scene = new Scene();
+		scene->SetMaterialsPaths(this->materialsPaths);
+		while (scene->GetPointLights()->size() < nbLights) {
+			scene->AddRandomPointLight(new PointLight(
+					Eigen::Vector3f(1.f, 1.f, 1.f),
+					Eigen::Vector3f(1.f, 1.f, 1.f)));
+		}
+		float sceneTime = std::chrono::duration<float, std::milli>(
+				std::chrono::steady_clock::now() - start).count();
+
+		// Initialize the renderer with it, waiting for its programs
+		start = std::chrono::steady_clock::now();
+		renderer->SetScene(scene);
+		ShadersReader** shaders = renderer->GetShaders();
+		for (unsigned char i = 0; (shaders != nullptr)
+				&& (i < renderer->GetNbShaders()); i++) {
+			if (shaders[i] != nullptr)
+				shaders[i]->Finish(true);
+		}
+		glFinish();
+		float rendererTime = std::chrono::duration<float, std::milli>(
+				std::chrono::steady_clock::now() - start).count();
+
+		lightsFile << nbLights << ", " << sceneTime << ", " << rendererTime
+				<< std::endl;
+
+		// Give the renderer back its scene
+		renderer->SetScene(this->scene);
+		delete scene;
+	}
+	lightsFile.close();
+}
+
+void Context::BenchmarkMaterialsLookup() {
+	Scene* scene = this->GetScene();
+	Renderer* renderer = (this->viewer != nullptr)
+			? this->viewer->GetRenderer() : nullptr;
+	if ((scene == nullptr) || (scene->GetMesh() == nullptr)
+			|| (renderer == nullptr) || renderer->IsRenderingPerMaterial())
+		return;
+
+	bool usingProvokingMaterials = renderer->IsUsingProvokingMaterials();
+	ImVec2 size((float) this->windowWidth, (float) this->windowHeight);
+
+	std::fstream materialsFile;
+	materialsFile.open("out/materials.csv", std::ios::app);
+	for (unsigned int nbLights : { 1u, 50u, 250u }) {
+		// Add point lights up to the expected number
+		std::vector<PointLight*> lights;
+		scene->BeginUpdate();
+		while (scene->GetPointLights()->size() < nbLights) {
+			lights.push_back(new PointLight(Eigen::Vector3f(1.f, 1.f, 1.f),
+					Eigen::Vector3f(1.f, 1.f, 1.f)));
+			scene->AddRandomPointLight(lights.back());
+		}
+		scene->EndUpdate();
+
+		materialsFile << nbLights;
+		for (bool provoking : { false, true }) {
+			renderer->SetUsingProvokingMaterials(provoking);
+
+			// Wait for the programs, then render a first frame (not measured)
+			ShadersReader** shaders = renderer->GetShaders();
+			for (unsigned char i = 0; i < renderer->GetNbShaders(); i++) {
+				if ((shaders[i] != nullptr) && shaders[i]->IsCompiling())
+					shaders[i]->Finish();
+			}
+			renderer->Render(size);
+			glFinish();
+
+			auto start = std::chrono::steady_clock::now();
+			for (unsigned int f = 0; f < BENCHMARK_MATERIALS_NB_FRAMES; f++)
+				renderer->Render(size);
+			glFinish();
+			materialsFile << ", " << (std::chrono::duration<float, std::milli>(
+					std::chrono::steady_clock::now() - start).count()
+					/ BENCHMARK_MATERIALS_NB_FRAMES);
+		}
+		materialsFile << std::endl;
+
+		scene->BeginUpdate();
+		for (auto light = lights.rbegin(); light != lights.rend(); light++)
+			scene->RemovePointLight(*light);
+		scene->EndUpdate();
+	}
+	materialsFile.close();
+
+	renderer->SetUsingProvokingMaterials(usingProvokingMaterials);
+}
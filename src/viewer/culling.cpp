@@ -0,0 +1,322 @@
+#include "culling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "parallel.h"
+
+// Minimum number of clusters tested by each worker thread
+#define CULLING_GRAIN_SIZE 1024
+
+ClusterCuller::ClusterCuller(Mesh* mesh)
+		: mesh(mesh) {
+	if (this->mesh == nullptr)
+		return;
+
+	this->nbClusters = this->mesh->nbClusters;
+	this->centersX.resize(this->nbClusters);
+	this->centersY.resize(this->nbClusters);
+	this->centersZ.resize(this->nbClusters);
+	this->radii.resize(this->nbClusters);
+	this->coneAxesX.resize(this->nbClusters);
+	this->coneAxesY.resize(this->nbClusters);
+	this->coneAxesZ.resize(this->nbClusters);
+	this->coneCutoffs.resize(this->nbClusters);
+	this->visibility.resize(this->nbClusters);
+	this->depths.resize(this->nbClusters);
+
+	MeshCluster* cluster;
+	for (unsigned int i = 0; i < this->nbClusters; i++) {
+		cluster = this->mesh->clusters + i;
+		this->centersX[i] = cluster->center.x();
+		this->centersY[i] = cluster->center.y();
+		this->centersZ[i] = cluster->center.z();
+		this->radii[i] = cluster->radius;
+		this->coneAxesX[i] = cluster->coneAxis.x();
+		this->coneAxesY[i] = cluster->coneAxis.y();
+		this->coneAxesZ[i] = cluster->coneAxis.z();
+		this->coneCutoffs[i] = cluster->coneCutoff;
+	}
+
+	if (this->nbClusters)
+		this->occlusionCuller = new OcclusionCuller(this->mesh);
+}
+
+ClusterCuller::~ClusterCuller() {
+	if (this->occlusionCuller != nullptr)
+		delete this->occlusionCuller;
+}
+
+bool ClusterCuller::Cull(const Eigen::Matrix4f& model,
+		const Eigen::Matrix4f& view, const Eigen::Matrix4f& projection,
+		bool orthographic, bool perMaterial, GLenum culledFaces) {
+	if (this->nbClusters == 0)
+		return false;
+	// (Per-material VBOs only follow clusters if faces are sorted.)
+	if (perMaterial && !this->mesh->IsSorted())
+		return false;
+
+	auto start = std::chrono::steady_clock::now();
+
+	/* Express the camera in the mesh’s space */
+
+	// Extract frustum planes from the full transformation
+	// (Planes are normalized so distances are in the mesh’s units.)
+	Eigen::Matrix4f transformation = projection * view * model;
+	float planes[6][4];
+	for (unsigned int p = 0; p < 6; p++) {
+		Eigen::Vector4f plane = transformation.row(3);
+		if (p % 2)
+			plane -= transformation.row(p / 2);
+		else
+			plane += transformation.row(p / 2);
+		float norm = plane.head<3>().norm();
+		for (unsigned int c = 0; c < 4; c++)
+			planes[p][c] = (norm > 0.) ? (plane[c] / norm) : 0.;
+	}
+
+	// Find the camera position, its direction and the depth axis
+	Eigen::Matrix4f modelView = view * model;
+	Eigen::Matrix4f inverseModelView = modelView.inverse();
+	Eigen::Vector3f eye = inverseModelView.col(3).head<3>();
+	Eigen::Vector3f direction =
+			-inverseModelView.col(2).head<3>().normalized();
+	Eigen::Vector4f depthAxis = -modelView.row(2);
+
+	// Only test normal cones against the culled side of the faces
+	// (Front faces are culled when back faces would be with reversed cones.)
+	bool testCones = ((culledFaces == GL_BACK) || (culledFaces == GL_FRONT));
+	float coneSign = (culledFaces == GL_FRONT) ? -1.f : 1.f;
+
+	// Don’t test normal cones if the mesh is mirrored
+	// (Its faces’ orientation is reversed.)
+	testCones &= (model.block<3, 3>(0, 0).determinant() > 0.);
+
+	/* Test each cluster */
+
+	ParallelFor(0, this->nbClusters,
+			[&](unsigned int first, unsigned int last) {
+		const float* centersX = this->centersX.data();
+		const float* centersY = this->centersY.data();
+		const float* centersZ = this->centersZ.data();
+		const float* radii = this->radii.data();
+		const float* coneAxesX = this->coneAxesX.data();
+		const float* coneAxesY = this->coneAxesY.data();
+		const float* coneAxesZ = this->coneAxesZ.data();
+		const float* coneCutoffs = this->coneCutoffs.data();
+		unsigned char* visibility = this->visibility.data();
+		float* depths = this->depths.data();
+
+		// Keep the loop free of branches so it can be vectorized
+		for (unsigned int i = first; i < last; i++) {
+			float x = centersX[i];
+			float y = centersY[i];
+			float z = centersZ[i];
+			float r = -radii[i];
+
+			// Sphere against frustum planes
+			bool inside = ((planes[0][0] * x + planes[0][1] * y
+							+ planes[0][2] * z + planes[0][3]) >= r)
+					& ((planes[1][0] * x + planes[1][1] * y
+							+ planes[1][2] * z + planes[1][3]) >= r)
+					& ((planes[2][0] * x + planes[2][1] * y
+							+ planes[2][2] * z + planes[2][3]) >= r)
+					& ((planes[3][0] * x + planes[3][1] * y
+							+ planes[3][2] * z + planes[3][3]) >= r)
+					& ((planes[4][0] * x + planes[4][1] * y
+							+ planes[4][2] * z + planes[4][3]) >= r)
+					& ((planes[5][0] * x + planes[5][1] * y
+							+ planes[5][2] * z + planes[5][3]) >= r);
+
+			// Normal cone against view direction
+			// (With a perspective, the cone apex is bounded by the sphere.)
+			float dx = x - eye.x();
+			float dy = y - eye.y();
+			float dz = z - eye.z();
+			float coneDot, coneLimit;
+			if (orthographic) {
+				coneDot = direction.x() * coneAxesX[i]
+						+ direction.y() * coneAxesY[i]
+						+ direction.z() * coneAxesZ[i];
+				coneLimit = coneCutoffs[i];
+			} else {
+				coneDot = dx * coneAxesX[i] + dy * coneAxesY[i]
+						+ dz * coneAxesZ[i];
+				coneLimit = coneCutoffs[i] * std::sqrt(dx * dx + dy * dy
+						+ dz * dz) - r;
+			}
+			bool backfacing = testCones & ((coneSign * coneDot) > coneLimit);
+
+			visibility[i] = (unsigned char) ((!inside)
+					| ((inside & backfacing) << 1));
+			depths[i] = depthAxis[0] * x + depthAxis[1] * y
+					+ depthAxis[2] * z + depthAxis[3];
+		}
+	}, CULLING_GRAIN_SIZE);
+
+	/* Test remaining clusters against occluders */
+
+	if (this->occlusionCulling && (this->occlusionCuller != nullptr)) {
+		this->occlusionCuller->Render(transformation, culledFaces);
+		ParallelFor(0, this->nbClusters,
+				[this](unsigned int first, unsigned int last) {
+			for (unsigned int i = first; i < last; i++) {
+				if ((this->visibility[i] == 0)
+						&& !this->occlusionCuller->IsVisible(
+								this->mesh->clusters[i].boundingBox))
+					this->visibility[i] = 3;
+			}
+		}, CULLING_GRAIN_SIZE);
+	}
+
+	this->BuildDrawLists(perMaterial);
+
+	this->cullingTime = std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+ClusterDrawList* ClusterCuller::GetDrawList(unsigned char vbo) {
+	if (vbo >= this->drawLists.size())
+		return nullptr;
+	return &this->drawLists[vbo];
+}
+
+unsigned int ClusterCuller::GetNbClusters() {
+	return this->nbClusters;
+}
+
+unsigned int ClusterCuller::GetNbVisibleClusters() {
+	return this->nbVisibleClusters;
+}
+
+unsigned int ClusterCuller::GetNbSubmittedFaces() {
+	return this->nbSubmittedFaces;
+}
+
+unsigned int ClusterCuller::GetNbFrustumCulledFaces() {
+	return this->nbFrustumCulledFaces;
+}
+
+unsigned int ClusterCuller::GetNbBackfaceCulledFaces() {
+	return this->nbBackfaceCulledFaces;
+}
+
+unsigned int ClusterCuller::GetNbOccludedFaces() {
+	return this->nbOccludedFaces;
+}
+
+float ClusterCuller::GetCullingTime() {
+	return this->cullingTime;
+}
+
+OcclusionCuller* ClusterCuller::GetOcclusionCuller() {
+	return this->occlusionCuller;
+}
+
+void ClusterCuller::SetIndexFormats(
+		const std::vector<unsigned char>& indexSizes,
+		const std::vector<GLint>& clustersBaseVertex) {
+	this->vbosIndexSize = indexSizes;
+	this->clustersBaseVertex = clustersBaseVertex;
+	if (this->clustersBaseVertex.size() != this->nbClusters)
+		this->clustersBaseVertex.clear();
+}
+
+bool ClusterCuller::IsOcclusionCullingEnabled() {
+	return this->occlusionCulling;
+}
+
+void ClusterCuller::SetOcclusionCulling(bool enabled) {
+	this->occlusionCulling = enabled;
+}
+
+void ClusterCuller::BuildDrawLists(bool perMaterial) {
+	unsigned int nbVbos = (perMaterial ? this->mesh->nbMaterials : 1);
+	unsigned char firstMaterial =
+			(unsigned char) this->mesh->GetMaterialsRange().min()[0];
+
+	// Find where each VBO starts in the list of faces
+	std::vector<unsigned int> vbosFirstFace(nbVbos, 0);
+	for (unsigned int i = 1; i < nbVbos; i++) {
+		vbosFirstFace[i] = vbosFirstFace[i - 1]
+				+ this->mesh->nbFacesPerMaterial[i - 1];
+	}
+
+	// Gather visible clusters and count faces
+	// (Clusters are already sorted by material, so each VBO gets a
+	// contiguous part of the list.)
+	this->visibleClusters.clear();
+	this->nbSubmittedFaces = 0;
+	this->nbFrustumCulledFaces = 0;
+	this->nbBackfaceCulledFaces = 0;
+	this->nbOccludedFaces = 0;
+	std::vector<unsigned int> vbosFirstCluster(nbVbos + 1, 0);
+	for (unsigned int i = 0; i < this->nbClusters; i++) {
+		MeshCluster& cluster = this->mesh->clusters[i];
+		switch (this->visibility[i]) {
+			case 0:
+				this->visibleClusters.push_back(i);
+				this->nbSubmittedFaces += cluster.nbFaces;
+				if (perMaterial)
+					vbosFirstCluster[cluster.material - firstMaterial + 1]++;
+				break;
+			case 1:
+				this->nbFrustumCulledFaces += cluster.nbFaces;
+				break;
+			case 2:
+				this->nbBackfaceCulledFaces += cluster.nbFaces;
+				break;
+			default:
+				this->nbOccludedFaces += cluster.nbFaces;
+				break;
+		}
+	}
+	if (!perMaterial)
+		vbosFirstCluster[1] = this->visibleClusters.size();
+	for (unsigned int i = 1; i <= nbVbos; i++)
+		vbosFirstCluster[i] += vbosFirstCluster[i - 1];
+	this->nbVisibleClusters = this->visibleClusters.size();
+
+	// Build each VBO’s list from front to back
+	this->drawLists.resize(nbVbos);
+	const float* depths = this->depths.data();
+	for (unsigned int v = 0; v < nbVbos; v++) {
+		ClusterDrawList& drawList = this->drawLists[v];
+		drawList.counts.clear();
+		drawList.offsets.clear();
+		drawList.baseVertices.clear();
+		size_t indexSize = (v < this->vbosIndexSize.size())
+				? this->vbosIndexSize[v] : sizeof(unsigned int);
+
+		unsigned int* first = this->visibleClusters.data()
+				+ vbosFirstCluster[v];
+		unsigned int* last = this->visibleClusters.data()
+				+ vbosFirstCluster[v + 1];
+		std::sort(first, last, [depths](unsigned int a, unsigned int b) {
+			if (depths[a] != depths[b])
+				return depths[a] < depths[b];
+			return a < b;
+		});
+
+		// Merge clusters following each other in the VBO
+		unsigned int nextFace = 0;
+		for (unsigned int* c = first; c < last; c++) {
+			MeshCluster& cluster = this->mesh->clusters[*c];
+			unsigned int firstFace = cluster.firstFace - vbosFirstFace[v];
+			GLint baseVertex = this->clustersBaseVertex.empty()
+					? 0 : this->clustersBaseVertex[*c];
+			if (!drawList.counts.empty() && (firstFace == nextFace)
+					&& (drawList.baseVertices.back() == baseVertex)) {
+				drawList.counts.back() += 3 * cluster.nbFaces;
+			} else {
+				drawList.counts.push_back(3 * cluster.nbFaces);
+				drawList.offsets.push_back((const void*)
+						(indexSize * 3 * (size_t) firstFace));
+				drawList.baseVertices.push_back(baseVertex);
+			}
+			nextFace = firstFace + cluster.nbFaces;
+		}
+	}
+}
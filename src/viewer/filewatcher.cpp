@@ -0,0 +1,121 @@
+#include "filewatcher.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "utils.h"
+
+FileWatcher::FileWatcher()
+		: lastPoll(std::chrono::steady_clock::now()) {
+#ifdef __linux__
+	this->notifyID = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+	this->Clear();
+#ifdef __linux__
+	if (this->notifyID >= 0)
+		close(this->notifyID);
+#endif
+}
+
+void FileWatcher::Watch(const std::string& path) {
+	if (this->files.count(path))
+		return;
+	this->files[path] = GetFileModificationTime(path);
+
+#ifdef __linux__
+	if (this->notifyID < 0)
+		return;
+
+	// Watch the directory of the file, as editors often replace files
+	// instead of writing them
+	std::size_t end = path.rfind('/');
+	std::string directory = (end == std::string::npos)
+			? "" : path.substr(0, end + 1);
+	if (this->directoriesPaths.count(directory))
+		return;
+	int watchID = inotify_add_watch(this->notifyID,
+			directory.empty() ? "." : directory.c_str(),
+			IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (watchID < 0)
+		return;
+	// (Different paths of the same directory share their watch descriptor.)
+	this->directories[watchID].push_back(directory);
+	this->directoriesPaths.insert(directory);
+#endif
+}
+
+void FileWatcher::Clear() {
+#ifdef __linux__
+	for (auto& directory: this->directories)
+		inotify_rm_watch(this->notifyID, directory.first);
+#endif
+	this->directories.clear();
+	this->directoriesPaths.clear();
+	this->files.clear();
+}
+
+std::vector<std::string> FileWatcher::Poll() {
+	std::vector<std::string> changedFiles;
+
+#ifdef __linux__
+	if (this->notifyID >= 0) {
+		// Read events until there is none left (reads don’t block)
+		alignas(struct inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = read(this->notifyID, buffer, sizeof(buffer))) > 0) {
+			char* position = buffer;
+			while (position < (buffer + length)) {
+				const struct inotify_event* event =
+						(const struct inotify_event*) position;
+				position += sizeof(struct inotify_event) + event->len;
+
+				auto directory = this->directories.find(event->wd);
+				if ((event->len == 0)
+						|| (directory == this->directories.end()))
+					continue;
+				for (const std::string& directoryPath: directory->second) {
+					std::string path = directoryPath + event->name;
+					if (this->files.count(path)
+							&& (std::find(changedFiles.begin(),
+									changedFiles.end(), path)
+									== changedFiles.end()))
+						changedFiles.push_back(path);
+				}
+			}
+		}
+		return changedFiles;
+	}
+#endif
+
+	// Otherwise compare modification times, but not on every call
+	auto now = std::chrono::steady_clock::now();
+	if ((now - this->lastPoll)
+			< std::chrono::milliseconds(FILE_WATCHER_POLL_INTERVAL))
+		return changedFiles;
+	this->lastPoll = now;
+
+	for (auto& file: this->files) {
+		time_t modificationTime = GetFileModificationTime(file.first);
+		if (modificationTime != file.second) {
+			file.second = modificationTime;
+			changedFiles.push_back(file.first);
+		}
+	}
+
+	return changedFiles;
+}
+
+unsigned int FileWatcher::GetNbWatchedFiles() const {
+	return this->files.size();
+}
+
+bool FileWatcher::IsUsingNotifications() const {
+	return (this->notifyID >= 0);
+}
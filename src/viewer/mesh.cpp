@@ -1,10 +1,15 @@
 #include "mesh.h"
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <mutex>
 #include <stdlib.h>
 
+#include "adjacency.h"
+#include "bvh.h"
 #include "context.h"
+#include "parallel.h"
 #include "modules/message.h"
 
 MeshData::~MeshData() {
@@ -81,25 +86,37 @@ Vertex::Vertex(const Eigen::Vector3f &position,
 		, color(color)
 		, normal(normal) {}
 
-Mesh::Mesh(void* context, MeshData* data)
-		: context(context) {
+Mesh::Mesh(void* context, MeshData* data, bool soa)
+		: soa(soa)
+		, context(context) {
 	this->Init(data);
 }
 
 Mesh::Mesh(Mesh* mesh)
-		: context(mesh->GetContext())
-		, nbVertices(mesh->nbVertices)
+		: Mesh(mesh, mesh->IsSoA()) {}
+
+Mesh::Mesh(Mesh* mesh, bool soa)
+		: nbVertices(mesh->nbVertices)
 		, nbFaces(mesh->nbFaces)
 		, haveColors(mesh->HaveColors())
 		, haveMaterials(mesh->HaveMaterials())
+		, isSorted(mesh->IsSorted())
+		, soa(soa)
+		, defaultColor(mesh->defaultColor)
+		, context(mesh->GetContext())
 		, boundingBox(mesh->GetBoundingBox())
-		, materialsRange(mesh->GetMaterialsRange())
-		, isSorted(mesh->IsSorted()) {
+		, materialsRange(mesh->GetMaterialsRange()) {
 	// Copy vertices’ data
-	this->verticesData = (Vertex*)
-			malloc(sizeof(struct Vertex) * this->nbVertices);
-	for (unsigned int i = 0; i < mesh->nbVertices; i++)
-		this->verticesData[i] = mesh->verticesData[i];
+	this->AllocateVertices();
+	bool copyColors = (this->verticesColors != nullptr)
+			&& (mesh->GetColors() != nullptr);
+	for (unsigned int i = 0; i < mesh->nbVertices; i++) {
+		this->verticesPositions[this->verticesStride * i] =
+				mesh->GetPosition(i);
+		this->verticesNormals[this->verticesStride * i] = mesh->GetNormal(i);
+		if (copyColors)
+			this->verticesColors[this->verticesStride * i] = mesh->GetColor(i);
+	}
 
 	// Copy faces’ vertices (indices)
 	unsigned int nbElements = 3 * this->nbFaces;
@@ -112,18 +129,38 @@ Mesh::Mesh(Mesh* mesh)
 			(unsigned char*) malloc(sizeof(char) * this->nbFaces);
 	for (unsigned int i = 0; i < this->nbFaces; i++)
 		this->facesMaterials[i] = mesh->facesMaterials[i];
+
+	// Copy clusters
+	this->nbClusters = mesh->nbClusters;
+	if (this->nbClusters) {
+		this->clusters = (MeshCluster*)
+				malloc(sizeof(struct MeshCluster) * this->nbClusters);
+		for (unsigned int i = 0; i < this->nbClusters; i++)
+			this->clusters[i] = mesh->clusters[i];
+	}
 }
 
 Mesh::~Mesh() {
 	// Deallocate each array if it was allocated
 	if (this->verticesData != nullptr)
 		delete this->verticesData;
+	if (this->soa) {
+		free(this->verticesPositions);
+		free(this->verticesNormals);
+		free(this->verticesColors);
+	}
 	if (this->facesVertices != nullptr)
 		delete this->facesVertices;
 	if (this->facesMaterials != nullptr)
 		delete this->facesMaterials;
 	if (this->nbFacesPerMaterial != nullptr)
 		delete this->nbFacesPerMaterial;
+	if (this->clusters != nullptr)
+		free(this->clusters);
+	if (this->bvh != nullptr)
+		delete this->bvh;
+	if (this->adjacency != nullptr)
+		delete this->adjacency;
 }
 
 bool Mesh::ExportMesh(std::string path) {
@@ -153,18 +190,18 @@ bool Mesh::ExportMesh(std::string path) {
 	// Write vertices data
 	if (haveColors) {
 		for (unsigned int i = 0; i < this->nbVertices; i++) {
-			file << this->verticesData[i].position.x() << " "
-					<< this->verticesData[i].position.y() << " "
-					<< this->verticesData[i].position.z() << " "
-					<< this->verticesData[i].color.x() << " "
-					<< this->verticesData[i].color.y() << " "
-					<< this->verticesData[i].color.z() << std::endl;
+			file << this->GetPosition(i).x() << " "
+					<< this->GetPosition(i).y() << " "
+					<< this->GetPosition(i).z() << " "
+					<< this->GetColor(i).x() << " "
+					<< this->GetColor(i).y() << " "
+					<< this->GetColor(i).z() << std::endl;
 		}
 	} else {
 		for (unsigned int i = 0; i < this->nbVertices; i++) {
-			file << this->verticesData[i].position.x() << " "
-					<< this->verticesData[i].position.y() << " "
-					<< this->verticesData[i].position.z() << std::endl;
+			file << this->GetPosition(i).x() << " "
+					<< this->GetPosition(i).y() << " "
+					<< this->GetPosition(i).z() << std::endl;
 		}
 	}
 
@@ -195,8 +232,12 @@ void Mesh::ChangeDefaultColor(Eigen::Vector3f color) {
 		return;
 
 	// Replace the color for each vertice
-	for (unsigned int i = 0; i < this->nbVertices; i++)
-		this->verticesData->color = color;
+	// (Colors may not be stored, in which case the default one is used.)
+	this->defaultColor = color;
+	if (this->verticesColors != nullptr) {
+		for (unsigned int i = 0; i < this->nbVertices; i++)
+			this->verticesColors[this->verticesStride * i] = color;
+	}
 }
 
 void Mesh::ChangeDefaultMaterial(unsigned char material) {
@@ -208,6 +249,8 @@ void Mesh::ChangeDefaultMaterial(unsigned char material) {
 	// Replace the material for each face
 	for (unsigned int i = 0; i < this->nbFaces; i++)
 		this->facesMaterials[i] = material;
+	for (unsigned int i = 0; i < this->nbClusters; i++)
+		this->clusters[i].material = material;
 
 	// Update the materials range
 	this->materialsRange = Eigen::AlignedBox1i(material, material);
@@ -225,6 +268,47 @@ bool Mesh::IsSorted() {
 	return this->isSorted;
 }
 
+bool Mesh::IsSoA() {
+	return this->soa;
+}
+
+const Eigen::Vector3f* Mesh::GetPositions() {
+	return this->verticesPositions;
+}
+
+const Eigen::Vector3f* Mesh::GetNormals() {
+	return this->verticesNormals;
+}
+
+const Eigen::Vector3f* Mesh::GetColors() {
+	return this->verticesColors;
+}
+
+unsigned int Mesh::GetVerticesStride() {
+	return this->verticesStride;
+}
+
+const Eigen::Vector3f& Mesh::GetPosition(unsigned int vertex) {
+	return this->verticesPositions[this->verticesStride * vertex];
+}
+
+const Eigen::Vector3f& Mesh::GetNormal(unsigned int vertex) {
+	return this->verticesNormals[this->verticesStride * vertex];
+}
+
+const Eigen::Vector3f& Mesh::GetColor(unsigned int vertex) {
+	if (this->verticesColors == nullptr)
+		return this->defaultColor;
+	return this->verticesColors[this->verticesStride * vertex];
+}
+
+size_t Mesh::GetVerticesMemorySize() {
+	if (!this->soa)
+		return sizeof(struct Vertex) * (size_t) this->nbVertices;
+	return sizeof(Eigen::Vector3f) * (size_t) this->nbVertices
+			* ((this->verticesColors != nullptr) ? 3 : 2);
+}
+
 Eigen::AlignedBox3f Mesh::GetBoundingBox() {
 	return this->boundingBox;
 }
@@ -233,6 +317,259 @@ Eigen::AlignedBox1i Mesh::GetMaterialsRange() {
 	return this->materialsRange;
 }
 
+// Spread the 10 lowest bits of a value so that there are two zeros between
+// each of them
+static unsigned int SpreadBits(unsigned int value) {
+	value &= 0x000003ff;
+	value = (value ^ (value << 16)) & 0xff0000ff;
+	value = (value ^ (value << 8)) & 0x0300f00f;
+	value = (value ^ (value << 4)) & 0x030c30c3;
+	value = (value ^ (value << 2)) & 0x09249249;
+	return value;
+}
+
+// Split a range of faces sorted by Morton code into groups of at most maxFaces
+// faces, cutting first where the highest bit of the codes changes so that each
+// group stays in a single cell of the curve
+static void SplitMortonRange(const std::pair<unsigned int, unsigned int>* keys,
+		unsigned int first, unsigned int last, unsigned int maxFaces,
+		std::vector<unsigned int>& groupsStart) {
+	unsigned int size = last - first;
+	if (size <= maxFaces) {
+		groupsStart.push_back(first);
+		return;
+	}
+
+	// If all faces have the same code, split them evenly
+	unsigned int difference = keys[first].first ^ keys[last - 1].first;
+	if (difference == 0) {
+		unsigned int nbGroups = (size + maxFaces - 1) / maxFaces;
+		for (unsigned int g = 0; g < nbGroups; g++)
+			groupsStart.push_back(first + (unsigned int)
+					((unsigned long long) size * g / nbGroups));
+		return;
+	}
+
+	// Find the first face having the highest different bit set
+	unsigned int bit = 31;
+	while (!(difference & (1u << bit)))
+		bit--;
+	unsigned int lower = first;
+	unsigned int upper = last - 1;
+	while (lower < upper) {
+		unsigned int middle = (lower + upper) / 2;
+		if (keys[middle].first & (1u << bit))
+			upper = middle;
+		else
+			lower = middle + 1;
+	}
+
+	SplitMortonRange(keys, first, lower, maxFaces, groupsStart);
+	SplitMortonRange(keys, lower, last, maxFaces, groupsStart);
+}
+
+void Mesh::ComputeClusters(unsigned int maxFaces) {
+	if (maxFaces == 0)
+		maxFaces = MESH_CLUSTER_MAX_FACES;
+
+	// Forget previous clusters
+	if (this->clusters != nullptr)
+		free(this->clusters);
+	this->clusters = nullptr;
+	this->nbClusters = 0;
+
+	// Faces will be reordered, which breaks the hierarchy and adjacency
+	if (this->bvh != nullptr)
+		delete this->bvh;
+	this->bvh = nullptr;
+	if (this->adjacency != nullptr)
+		delete this->adjacency;
+	this->adjacency = nullptr;
+	if (this->nbFaces == 0)
+		return;
+
+	/* Find ranges of faces sharing a material */
+
+	std::vector<unsigned int> rangesStart;
+	for (unsigned int i = 0; i < this->nbFaces; i++) {
+		if ((i == 0) || (this->facesMaterials[i] != this->facesMaterials[i - 1]))
+			rangesStart.push_back(i);
+	}
+	unsigned int nbRanges = rangesStart.size();
+	rangesStart.push_back(this->nbFaces);
+
+	int processingCurrent = 0;
+	int processingExpected = nbRanges + 1;
+	ProcessingMessageModule* processingMessage;
+	if (this->context != nullptr) {
+		processingMessage = new ProcessingMessageModule(
+				this->context, "Computing clusters...",
+				&processingCurrent, &processingExpected);
+		((Context*) this->context)->AddModule(processingMessage);
+	}
+
+	/* Reorder faces of large ranges along a Morton curve and split them */
+
+	Eigen::Vector3f boxMin = this->boundingBox.min();
+	Eigen::Vector3f boxScale = this->boundingBox.sizes();
+	for (unsigned int a = 0; a < 3; a++)
+		boxScale[a] = (boxScale[a] > 0.) ? (1023. / boxScale[a]) : 0.;
+
+	std::vector<unsigned int> clustersStart;
+	for (unsigned int r = 0; r < nbRanges; r++) {
+		unsigned int rangeStart = rangesStart[r];
+		unsigned int rangeSize = rangesStart[r + 1] - rangeStart;
+		if (rangeSize <= maxFaces) {
+			// Small ranges are a cluster on their own
+			clustersStart.push_back(rangeStart);
+			processingCurrent++;
+			continue;
+		}
+
+		// Compute the Morton code of each face’s centroid
+		std::vector<std::pair<unsigned int, unsigned int>> keys(rangeSize);
+		ParallelFor(0, rangeSize,
+				[&](unsigned int first, unsigned int last) {
+			Eigen::Vector3f centroid;
+			unsigned int* face;
+			for (unsigned int i = first; i < last; i++) {
+				face = this->facesVertices + (3 * (rangeStart + i));
+				centroid = (this->GetPosition(face[0])
+						+ this->GetPosition(face[1])
+						+ this->GetPosition(face[2])) / 3.;
+				centroid = (centroid - boxMin).cwiseProduct(boxScale);
+				keys[i] = std::make_pair(
+						(SpreadBits((unsigned int) centroid.x()) << 2)
+						| (SpreadBits((unsigned int) centroid.y()) << 1)
+						| SpreadBits((unsigned int) centroid.z()), i);
+			}
+		}, 4096);
+
+		// Sort faces by code
+		// (The sort is stable, so faces with the same code keep their
+		// original order.)
+		ParallelSort(keys.data(), keys.data() + rangeSize,
+				[](const std::pair<unsigned int, unsigned int>& a,
+						const std::pair<unsigned int, unsigned int>& b) {
+			return a.first < b.first;
+		});
+
+		// Move faces’ vertices
+		unsigned int* rangeVertices = this->facesVertices + (3 * rangeStart);
+		std::vector<unsigned int> sortedVertices(3 * rangeSize);
+		ParallelFor(0, rangeSize,
+				[&](unsigned int first, unsigned int last) {
+			for (unsigned int i = first; i < last; i++) {
+				sortedVertices[(3 * i)] = rangeVertices[(3 * keys[i].second)];
+				sortedVertices[(3 * i) + 1] =
+						rangeVertices[(3 * keys[i].second) + 1];
+				sortedVertices[(3 * i) + 2] =
+						rangeVertices[(3 * keys[i].second) + 2];
+			}
+		}, 4096);
+		std::copy(sortedVertices.begin(), sortedVertices.end(),
+				rangeVertices);
+
+		// Split the range along the cells of the curve
+		unsigned int firstCluster = clustersStart.size();
+		SplitMortonRange(keys.data(), 0, rangeSize, maxFaces, clustersStart);
+		for (unsigned int c = firstCluster; c < clustersStart.size(); c++)
+			clustersStart[c] += rangeStart;
+
+		processingCurrent++;
+	}
+	this->nbClusters = clustersStart.size();
+	clustersStart.push_back(this->nbFaces);
+
+	/* Create clusters */
+
+	this->clusters = (MeshCluster*)
+			malloc(sizeof(struct MeshCluster) * this->nbClusters);
+	for (unsigned int c = 0; c < this->nbClusters; c++) {
+		this->clusters[c].firstFace = clustersStart[c];
+		this->clusters[c].nbFaces = clustersStart[c + 1] - clustersStart[c];
+		this->clusters[c].material = this->facesMaterials[clustersStart[c]];
+	}
+
+	/* Compute clusters’ bounds */
+
+	ParallelFor(0, this->nbClusters,
+			[this](unsigned int first, unsigned int last) {
+		Eigen::Vector3f normal;
+		for (unsigned int c = first; c < last; c++) {
+			MeshCluster& cluster = this->clusters[c];
+			unsigned int* clusterVertices =
+					this->facesVertices + (3 * cluster.firstFace);
+			unsigned int nbElements = 3 * cluster.nbFaces;
+
+			// Compute the bounding box
+			cluster.boundingBox.setEmpty();
+			for (unsigned int i = 0; i < nbElements; i++)
+				cluster.boundingBox.extend(
+						this->GetPosition(clusterVertices[i]));
+
+			// Compute the bounding sphere around the box center
+			cluster.center = cluster.boundingBox.center();
+			float radius = 0.;
+			for (unsigned int i = 0; i < nbElements; i++) {
+				radius = std::max(radius,
+						(this->GetPosition(clusterVertices[i])
+								- cluster.center).squaredNorm());
+			}
+			cluster.radius = std::sqrt(radius);
+
+			// Compute the mean normal of the faces
+			cluster.coneAxis = Eigen::Vector3f::Constant(0);
+			for (unsigned int f = 0; f < nbElements; f += 3) {
+				normal = this->GetFaceNormal(clusterVertices + f);
+				if (normal.squaredNorm() > 0.)
+					cluster.coneAxis += normal.normalized();
+			}
+
+			// Compute the cone angle from the farthest normal
+			// (If normals are too spread, the cluster is never backfacing.)
+			cluster.coneCutoff = 1.;
+			float axisNorm = cluster.coneAxis.norm();
+			if (axisNorm < 1e-6) {
+				cluster.coneAxis = Eigen::Vector3f(0., 0., 1.);
+				continue;
+			}
+			cluster.coneAxis /= axisNorm;
+			float minDot = 1.;
+			for (unsigned int f = 0; f < nbElements; f += 3) {
+				normal = this->GetFaceNormal(clusterVertices + f);
+				if (normal.squaredNorm() > 0.)
+					minDot = std::min(minDot,
+							normal.normalized().dot(cluster.coneAxis));
+			}
+			if (minDot > .1)
+				cluster.coneCutoff = std::sqrt(1. - (minDot * minDot));
+		}
+	}, 16);
+
+	processingCurrent++;
+
+	if (this->context != nullptr)
+		processingMessage->Kill();
+}
+
+void Mesh::ComputeBoundsAndNormals() {
+	this->ComputeRanges();
+	this->ComputeNormals();
+}
+
+BVH* Mesh::GetBVH() {
+	if (this->bvh == nullptr)
+		this->bvh = new BVH(this);
+	return this->bvh;
+}
+
+MeshAdjacency* Mesh::GetAdjacency() {
+	if (this->adjacency == nullptr)
+		this->adjacency = new MeshAdjacency(this);
+	return this->adjacency;
+}
+
 void* Mesh::GetContext() {
 	return this->context;
 }
@@ -241,9 +578,34 @@ void Mesh::Init(MeshData* data) {
 	bool forceUnsorted = false;
 	if (this->context != nullptr)
 		forceUnsorted = ((Context*) this->context)->GetForceUnsortedMesh();
+	if (this->context != nullptr)
+		this->soa |= ((Context*) this->context)->GetSoAVertices();
 	this->CopyDataFromMeshData(data, forceUnsorted);
-	this->ComputeNormals();
 	this->ComputeRanges();
+	this->ComputeClusters();
+	// (Normals are computed once faces are reordered by clusters.)
+	this->ComputeNormals();
+}
+
+void Mesh::AllocateVertices() {
+	if (this->soa) {
+		// Each attribute in its own array, colors only if there are some
+		size_t size = sizeof(Eigen::Vector3f) * this->nbVertices;
+		this->verticesPositions = (Eigen::Vector3f*) malloc(size);
+		this->verticesNormals = (Eigen::Vector3f*) calloc(this->nbVertices,
+				sizeof(Eigen::Vector3f));
+		if (this->haveColors)
+			this->verticesColors = (Eigen::Vector3f*) malloc(size);
+		this->verticesStride = 1;
+	} else {
+		// Attributes interleaved in verticesData
+		this->verticesData = (Vertex*) calloc(this->nbVertices,
+				sizeof(struct Vertex));
+		this->verticesPositions = &this->verticesData[0].position;
+		this->verticesNormals = &this->verticesData[0].normal;
+		this->verticesColors = &this->verticesData[0].color;
+		this->verticesStride = sizeof(struct Vertex) / sizeof(Eigen::Vector3f);
+	}
 }
 
 void Mesh::CopyDataFromMeshData(MeshData* data, bool forceUnsorted) {
@@ -278,9 +640,9 @@ void Mesh::CopyDataFromMeshData(MeshData* data, bool forceUnsorted) {
 
 	/* Vertices data */
 
-	// Allocate vertices’ data array
-	this->verticesData = (Vertex*) malloc(
-			sizeof(struct Vertex) * this->nbVertices);
+	// Allocate vertices’ data arrays
+	this->AllocateVertices();
+	unsigned int stride = this->verticesStride;
 
 	// Copy vertices’ data
 	unsigned int tmp;
@@ -317,7 +679,9 @@ void Mesh::CopyDataFromMeshData(MeshData* data, bool forceUnsorted) {
 						data->verticesColors[(3 * i)],
 						data->verticesColors[(3 * i) + 1],
 						data->verticesColors[(3 * i) + 2]) / maxIntensity;
-				verticesData[nextIndex++] = Vertex(position, color);
+				this->verticesPositions[stride * nextIndex] = position;
+				this->verticesColors[stride * nextIndex] = color;
+				nextIndex++;
 
 				processingCurrent++;
 			}
@@ -337,7 +701,8 @@ void Mesh::CopyDataFromMeshData(MeshData* data, bool forceUnsorted) {
 						data->verticesPositions[(3 * i)],
 						data->verticesPositions[(3 * i) + 1],
 						data->verticesPositions[(3 * i) + 2]);
-				verticesData[nextIndex++] = Vertex(position);
+				this->verticesPositions[stride * nextIndex] = position;
+				nextIndex++;
 
 				processingCurrent++;
 			}
@@ -359,7 +724,8 @@ void Mesh::CopyDataFromMeshData(MeshData* data, bool forceUnsorted) {
 						data->verticesColors[(3 * i)],
 						data->verticesColors[(3 * i) + 1],
 						data->verticesColors[(3 * i) + 2]) / maxIntensity;
-				verticesData[i] = Vertex(position, color);
+				this->verticesPositions[stride * i] = position;
+				this->verticesColors[stride * i] = color;
 
 				processingCurrent++;
 			}
@@ -370,7 +736,7 @@ void Mesh::CopyDataFromMeshData(MeshData* data, bool forceUnsorted) {
 						data->verticesPositions[(3 * i)],
 						data->verticesPositions[(3 * i) + 1],
 						data->verticesPositions[(3 * i) + 2]);
-				verticesData[i] = Vertex(position);
+				this->verticesPositions[stride * i] = position;
 
 				processingCurrent++;
 			}
@@ -530,7 +896,7 @@ void Mesh::CopyDataFromMeshData(MeshData* data, bool forceUnsorted) {
 
 void Mesh::ComputeNormals() {
 	int processingCurrent = 0;
-	int processingExpected = this->nbFaces + this->nbVertices;
+	int processingExpected = 3;
 	ProcessingMessageModule* processingMessage;
 	if (this->context != nullptr) {
 		processingMessage = new ProcessingMessageModule(
@@ -539,87 +905,71 @@ void Mesh::ComputeNormals() {
 		((Context*) this->context)->AddModule(processingMessage);
 	}
 
-	// Reinitialize vertices’ normals
-	for (unsigned int i = 0; i < this->nbVertices; i++)
-		this->verticesData[i].normal = Eigen::Vector3f::Constant(0);
+	// Only find the faces around each vertex
+	// (The full adjacency is built when a consumer asks for it, and this one
+	// is freed once normals are computed.)
+	MeshAdjacency adjacency(this, false);
+	processingCurrent++;
 
-	/* Compute vertices’ normals using faces */
-	{
-		unsigned int vertex1ID, vertex2ID, vertex3ID;
-		Eigen::Vector3f faceNormal;
-		for (unsigned int i = 0; i < this->nbFaces; i++) {
-			// Find face’s vertices
-			vertex1ID = this->facesVertices[3 * i];
-			vertex2ID = this->facesVertices[(3 * i) + 1];
-			vertex3ID = this->facesVertices[(3 * i) + 2];
-
-			// Compute face normal using its vertices’ positions
-			faceNormal = (this->verticesData[vertex2ID].position
-							- this->verticesData[vertex1ID].position)
-					.cross(this->verticesData[vertex3ID].position
-							- this->verticesData[vertex1ID].position);
-
-			// Add face normal to vertices’ normals
-			this->verticesData[vertex1ID].normal += faceNormal;
-			this->verticesData[vertex2ID].normal += faceNormal;
-			this->verticesData[vertex3ID].normal += faceNormal;
+	/* Compute faces’ normals */
 
-			processingCurrent++;
+	// (Their norm is twice their area, so that large faces weigh more.)
+	std::vector<Eigen::Vector3f> facesNormals(this->nbFaces);
+	ParallelFor(0, this->nbFaces, [&](unsigned int first, unsigned int last) {
+		for (unsigned int i = first; i < last; i++) {
+			facesNormals[i] =
+					this->GetFaceNormal(this->facesVertices + (3 * i));
 		}
-	}
-
-	/* Normalize vertices’ normals */
-	for (unsigned int i = 0; i < this->nbVertices; i++) {
-		this->verticesData[i].normal.normalize();
-
-		processingCurrent++;
-	}
+	}, 4096);
+	processingCurrent++;
+
+	/* Gather them around each vertex */
+
+	// (Faces are sorted, so normals are summed in the same order whatever the
+	// number of threads.)
+	ParallelFor(0, this->nbVertices,
+			[&](unsigned int first, unsigned int last) {
+		for (unsigned int i = first; i < last; i++) {
+			Eigen::Vector3f normal = Eigen::Vector3f::Constant(0);
+			unsigned int nbVertexFaces = adjacency.GetNbVertexFaces(i);
+			const unsigned int* vertexFaces = adjacency.GetVertexFaces(i);
+			for (unsigned int f = 0; f < nbVertexFaces; f++)
+				normal += facesNormals[vertexFaces[f]];
+			this->verticesNormals[this->verticesStride * i] =
+					normal.normalized();
+		}
+	}, 4096);
+	processingCurrent++;
 
 	if (this->context != nullptr)
 		processingMessage->Kill();
 }
 
+Eigen::Vector3f Mesh::GetFaceNormal(unsigned int* face) {
+	return (this->GetPosition(face[1]) - this->GetPosition(face[0]))
+			.cross(this->GetPosition(face[2]) - this->GetPosition(face[0]));
+}
+
 void Mesh::ComputeRanges() {
 	/* Compute bounding box */
-	{
-		float value;
-
-		// Search X position range
-		float minPosX = this->verticesData[0].position.x();
-		float maxPosX = this->verticesData[0].position.x();
-		for (unsigned int i = 1; i < this->nbVertices; i++) {
-			value = this->verticesData[i].position.x();
-			if (minPosX > value)
-				minPosX = value;
-			if (maxPosX < value)
-				maxPosX = value;
-		}
-
-		// Search Y position range
-		float minPosY = this->verticesData[0].position.y();
-		float maxPosY = this->verticesData[0].position.y();
-		for (unsigned int i = 1; i < this->nbVertices; i++) {
-			value = this->verticesData[i].position.y();
-			if (minPosY > value)
-				minPosY = value;
-			if (maxPosY < value)
-				maxPosY = value;
-		}
 
-		// Search Z position range
-		float minPosZ = this->verticesData[0].position.z();
-		float maxPosZ = this->verticesData[0].position.z();
-		for (unsigned int i = 1; i < this->nbVertices; i++) {
-			value = this->verticesData[i].position.z();
-			if (minPosZ > value)
-				minPosZ = value;
-			if (maxPosZ < value)
-				maxPosZ = value;
-		}
-
-		// Save X, Y and Z ranges
-		this->boundingBox = Eigen::AlignedBox3f(
-				Eigen::Vector3f(minPosX, minPosY, minPosZ),
-				Eigen::Vector3f(maxPosX, maxPosY, maxPosZ));
-	}
+	// Each worker thread scans a block of positions, then blocks are merged
+	// (Positions are read as the columns of a matrix, which are contiguous if
+	// vertices are stored as a structure of arrays.)
+	std::mutex mutex;
+	Eigen::AlignedBox3f boundingBox;
+	ParallelFor(0, this->nbVertices,
+			[&](unsigned int first, unsigned int last) {
+		Eigen::Map<const Eigen::Matrix3Xf, 0, Eigen::OuterStride<>> positions(
+				this->GetPosition(first).data(), 3, last - first,
+				Eigen::OuterStride<>(3 * this->verticesStride));
+		Eigen::AlignedBox3f blockBox(positions.rowwise().minCoeff(),
+				positions.rowwise().maxCoeff());
+
+		std::lock_guard<std::mutex> lock(mutex);
+		boundingBox.extend(blockBox);
+	}, 65536);
+
+	// Save X, Y and Z ranges
+	this->boundingBox = boundingBox;
 }
@@ -1,5 +1,9 @@
 #include "modules/meshcontent.h"
 
+#include <algorithm>
+
+#include "context.h"
+
 #define MAX_CONTENT		15
 
 MeshContentModule::MeshContentModule(void* context, std::string filename,
@@ -37,6 +41,24 @@ void MeshContentModule::Render() {
 					(this->mesh->HaveColors() ? "yes" : "no"));
 			ImGui::Text("  Have materials: %s",
 					(this->mesh->HaveMaterials() ? "yes" : "no"));
+			ImGui::Text("  Vertices layout: %s (%.2f MiB)",
+					(this->mesh->IsSoA() ? "structure of arrays"
+							: "array of structures"),
+					this->mesh->GetVerticesMemorySize() / 1048576.);
+
+			// Indices are only known once uploaded by the scene
+			Scene* scene = ((Context*) this->context)->GetScene();
+			if ((scene != nullptr) && (scene->GetMesh() == this->mesh)
+					&& scene->GetNbVboFaces()) {
+				size_t fullSize = sizeof(unsigned int) * 3
+						* (size_t) this->mesh->nbFaces;
+				size_t size = scene->GetFacesVbosMemorySize();
+				ImGui::Text("  Index buffers: %u/%u 16-bit (%.2f MiB)",
+						scene->GetNbShortFacesVbos(), scene->GetNbVboFaces(),
+						size / 1048576.);
+				ImGui::Text("  Saved by 16-bit indices: %.2f MiB",
+						(fullSize - std::min(size, fullSize)) / 1048576.);
+			}
 			ImGui::Separator();
 
 			ImGui::Text("Values range:");
@@ -85,23 +107,23 @@ void MeshContentModule::Render() {
 						ImGui::Text("%u", i);
 						ImGui::TableNextColumn();
 						ImGui::Text("%.2f",
-								this->mesh->verticesData[i].position.x());
+								this->mesh->GetPosition(i).x());
 						ImGui::TableNextColumn();
 						ImGui::Text("%.2f",
-								this->mesh->verticesData[i].position.y());
+								this->mesh->GetPosition(i).y());
 						ImGui::TableNextColumn();
 						ImGui::Text("%.2f",
-								this->mesh->verticesData[i].position.z());
+								this->mesh->GetPosition(i).z());
 						if (this->mesh->HaveColors()) {
 							ImGui::TableNextColumn();
 							ImGui::Text("%.2f",
-									this->mesh->verticesData[i].color.x());
+									this->mesh->GetColor(i).x());
 							ImGui::TableNextColumn();
 							ImGui::Text("%.2f",
-									this->mesh->verticesData[i].color.y());
+									this->mesh->GetColor(i).y());
 							ImGui::TableNextColumn();
 							ImGui::Text("%.2f",
-									this->mesh->verticesData[i].color.z());
+									this->mesh->GetColor(i).z());
 						}
 					}
 				}
@@ -179,13 +201,13 @@ void MeshContentModule::Render() {
 						ImGui::Text("%u", i);
 						ImGui::TableNextColumn();
 						ImGui::Text("%.2f",
-								this->mesh->verticesData[i].normal.x());
+								this->mesh->GetNormal(i).x());
 						ImGui::TableNextColumn();
 						ImGui::Text("%.2f",
-								this->mesh->verticesData[i].normal.y());
+								this->mesh->GetNormal(i).y());
 						ImGui::TableNextColumn();
 						ImGui::Text("%.2f",
-								this->mesh->verticesData[i].normal.z());
+								this->mesh->GetNormal(i).z());
 					}
 				}
 				ImGui::EndTable();
@@ -0,0 +1,103 @@
+#include "modules/picking.h"
+
+#include "context.h"
+
+PickingModule::PickingModule(void* context)
+		: GUIModule(context) {
+	this->title = "Picking";
+}
+
+PickingModule::PickingModule(PickingModule* module)
+		: GUIModule(module->GetContext())
+		, picked(module->IsPicked())
+		, found(module->IsFound())
+		, hit(module->GetHit())
+		, queryTime(module->GetQueryTime()) {
+	this->title = module->GetTitle();
+}
+
+PickingModule::~PickingModule() {}
+
+void PickingModule::Render() {
+	if (ImGui::Begin(std::string(this->title + "###"
+			+ std::to_string(this->id)).c_str())) {
+		Scene* scene = ((Context*) this->context)->GetScene();
+		Mesh* mesh = (scene != nullptr) ? scene->GetMesh() : nullptr;
+		if (mesh == nullptr) {
+			ImGui::Text("No mesh loaded.");
+			ImGui::End();
+			return;
+		}
+
+		ImGui::TextWrapped("Right-click on the mesh to pick a face, "
+				"middle-click to also turn the camera around it.");
+		ImGui::Separator();
+
+		if (!this->picked) {
+			ImGui::Text("Nothing picked yet.");
+		} else if (!this->found || (this->hit.face >= mesh->nbFaces)) {
+			ImGui::Text("No face under the cursor.");
+		} else {
+			// Find the vertex of the face nearest to the hit point
+			unsigned int* face = mesh->facesVertices + (3 * this->hit.face);
+			float weights[3] = {
+					(1.f - this->hit.u - this->hit.v), this->hit.u,
+					this->hit.v };
+			unsigned int nearest = 0;
+			for (unsigned int v = 1; v < 3; v++) {
+				if (weights[v] > weights[nearest])
+					nearest = v;
+			}
+
+			ImGui::Text("Picked face:");
+			ImGui::Text("  Face ID: %u", this->hit.face);
+			ImGui::Text("  Material ID: %u",
+					(unsigned int) mesh->facesMaterials[this->hit.face]);
+			ImGui::Text("  Nearest vertex ID: %u", face[nearest]);
+			ImGui::Text("  Position: ( %.3f, %.3f, %.3f )",
+					this->hit.position.x(), this->hit.position.y(),
+					this->hit.position.z());
+			ImGui::Text("  Distance: %.3f", this->hit.distance);
+		}
+
+		if (this->picked) {
+			BVH* bvh = mesh->GetBVH();
+			ImGui::Separator();
+			ImGui::Text("Hierarchy:");
+			ImGui::Text("  Nodes: %u", bvh->GetNbNodes());
+			ImGui::Text("  Depth: %u", bvh->GetDepth());
+			ImGui::Text("  Build time: %.1f ms", bvh->GetBuildTime());
+			ImGui::Text("  Query time: %.3f ms", this->queryTime);
+		}
+	}
+	ImGui::End();
+}
+
+void PickingModule::SetResult(bool found, const RayHit& hit,
+		float queryTime) {
+	this->picked = true;
+	this->found = found;
+	this->hit = hit;
+	this->queryTime = queryTime;
+}
+
+void PickingModule::ClearResult() {
+	this->picked = false;
+	this->found = false;
+}
+
+bool PickingModule::IsPicked() {
+	return this->picked;
+}
+
+bool PickingModule::IsFound() {
+	return this->found;
+}
+
+const RayHit& PickingModule::GetHit() {
+	return this->hit;
+}
+
+float PickingModule::GetQueryTime() {
+	return this->queryTime;
+}
@@ -0,0 +1,103 @@
+#include "modules/renderingstats.h"
+
+#include "context.h"
+
+RenderingStatsModule::RenderingStatsModule(void* context)
+		: GUIModule(context) {
+	this->title = "Rendering statistics";
+}
+
+RenderingStatsModule::RenderingStatsModule(RenderingStatsModule* module)
+		: GUIModule(module->GetContext()) {
+	this->title = module->GetTitle();
+}
+
+RenderingStatsModule::~RenderingStatsModule() {}
+
+void RenderingStatsModule::Render() {
+	if (ImGui::Begin(std::string(this->title + "###"
+			+ std::to_string(this->id)).c_str())) {
+		Scene* scene = ((Context*) this->context)->GetScene();
+		Mesh* mesh = (scene != nullptr) ? scene->GetMesh() : nullptr;
+		if (mesh == nullptr) {
+			ImGui::Text("No mesh loaded.");
+			ImGui::End();
+			return;
+		}
+
+		size_t fullSize = sizeof(Vertex) * (size_t) mesh->nbVertices;
+		CompactVertices* compactVertices = scene->GetCompactVertices();
+		ImGui::Text("Vertex buffer:");
+		if (compactVertices == nullptr) {
+			ImGui::Text("  Full precision (%u bytes per vertex)",
+					(unsigned int) sizeof(Vertex));
+			ImGui::Text("  Size: %.2f MiB", fullSize / 1048576.);
+		} else {
+			ImGui::Text("  Compact (%u bytes per vertex)",
+					compactVertices->GetStride());
+			ImGui::Text("  Size: %.2f MiB (%.1fx smaller)",
+					compactVertices->GetSize() / 1048576.,
+					(compactVertices->GetSize()
+							? (float) fullSize / compactVertices->GetSize()
+							: 1.f));
+			ImGui::Text("  Encoding time: %.3f ms",
+					compactVertices->GetEncodingTime());
+		}
+		ProvokingMaterials* provokingMaterials = scene->GetProvokingMaterials();
+		if (provokingMaterials != nullptr) {
+			ImGui::Text("  Vertices copied for materials: %u (%.3f ms)",
+					(unsigned int)
+							provokingMaterials->GetDuplicatedVertices().size(),
+					provokingMaterials->GetComputingTime());
+		}
+		if (scene->IsPullingVertices())
+			ImGui::Text("  Pulled by the vertex shaders");
+		ImGui::Separator();
+
+		ImGui::Text("Draw submission:");
+		ImGui::Text("  CPU time: %.3f ms", scene->GetDrawTime());
+		ImGui::Text("  Draw calls: %u", scene->GetNbDrawCalls());
+		ImGui::Separator();
+
+		ClusterCuller* culler = scene->GetClusterCuller();
+		ImGui::Text("Cluster culling:");
+		if (!scene->IsClusterCullingEnabled() || (culler == nullptr)) {
+			ImGui::Text("  Disabled");
+			ImGui::Text("  Triangles submitted: %u", mesh->nbFaces);
+		} else {
+			float ratio = (mesh->nbFaces
+					? (100.f / mesh->nbFaces) : 0.f);
+			ImGui::Text("  Clusters visible: %u / %u",
+					culler->GetNbVisibleClusters(), culler->GetNbClusters());
+			ImGui::Text("  Triangles submitted: %u (%.1f%%)",
+					culler->GetNbSubmittedFaces(),
+					culler->GetNbSubmittedFaces() * ratio);
+			ImGui::Text("  Culled by frustum: %u (%.1f%%)",
+					culler->GetNbFrustumCulledFaces(),
+					culler->GetNbFrustumCulledFaces() * ratio);
+			ImGui::Text("  Culled by normal cones: %u (%.1f%%)",
+					culler->GetNbBackfaceCulledFaces(),
+					culler->GetNbBackfaceCulledFaces() * ratio);
+			ImGui::Text("  Culled by occlusion: %u (%.1f%%)",
+					culler->GetNbOccludedFaces(),
+					culler->GetNbOccludedFaces() * ratio);
+			ImGui::Text("  Culling time: %.3f ms", culler->GetCullingTime());
+			ImGui::Separator();
+
+			OcclusionCuller* occlusionCuller = culler->GetOcclusionCuller();
+			ImGui::Text("Occlusion culling:");
+			if (!culler->IsOcclusionCullingEnabled()
+					|| (occlusionCuller == nullptr)) {
+				ImGui::Text("  Disabled");
+			} else {
+				ImGui::Text("  Depth buffer: %ux%u",
+						occlusionCuller->GetWidth(),
+						occlusionCuller->GetHeight());
+				ImGui::Text("  Occluders rasterized: %u / %u",
+						occlusionCuller->GetNbRasterizedOccluders(),
+						occlusionCuller->GetNbOccluders());
+			}
+		}
+	}
+	ImGui::End();
+}
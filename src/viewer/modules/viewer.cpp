@@ -1,5 +1,6 @@
 #include "modules/viewer.h"
 
+#include "context.h"
 #include "renderers/simple.h"
 
 ViewerModule::ViewerModule(void* context)
@@ -33,10 +34,28 @@ void ViewerModule::Render() {
 	ImGui::Begin(std::string(this->title + "###"
 			+ std::to_string(this->id)).c_str(), nullptr, this->flags);
 	if (this->renderer != nullptr) {
-		this->renderer->Render(size);
+		// (The last render is shown again while nothing changed.)
+		this->sceneRendered =
+				!((Context*) this->context)->GetRenderOnDemand()
+				|| this->renderer->NeedsRender(size);
+		if (this->sceneRendered)
+			this->renderer->Render(size);
 		ImGui::Image(reinterpret_cast<ImTextureID>(
 				this->renderer->GetRenderTexture()),
 				size, ImVec2(0, 1), ImVec2(1, 0));
+
+		// Pick the face under the cursor
+		if (ImGui::IsItemHovered() && (size.x > 0) && (size.y > 0)) {
+			bool pivot = ImGui::IsMouseClicked(2)
+					|| (ImGui::IsMouseClicked(1) && ImGui::GetIO().KeyShift);
+			if (pivot || ImGui::IsMouseClicked(1)) {
+				ImVec2 mouse = ImGui::GetMousePos();
+				ImVec2 corner = ImGui::GetItemRectMin();
+				((Context*) this->context)->PickMesh(Eigen::Vector2f(
+						(2.f * (mouse.x - corner.x) / size.x) - 1.f,
+						1.f - (2.f * (mouse.y - corner.y) / size.y)), pivot);
+			}
+		}
 	} else {
 		ImGui::Text("No renderer");
 	}
@@ -49,6 +68,10 @@ Renderer* ViewerModule::GetRenderer() {
 	return this->renderer;
 }
 
+bool ViewerModule::WasSceneRendered() {
+	return this->sceneRendered;
+}
+
 Mesh* ViewerModule::GetMesh() {
 	if (this->renderer != nullptr) {
 		if (this->renderer->GetScene() != nullptr)
@@ -0,0 +1,336 @@
+#include "occlusion.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "parallel.h"
+
+// Minimum w for a point to be considered in front of the camera
+#define OCCLUSION_MIN_W		1e-5f
+
+// Minimum number of rows rasterized by each worker thread
+#define OCCLUSION_GRAIN_SIZE	8
+
+OcclusionCuller::OcclusionCuller(Mesh* mesh, unsigned int width,
+		unsigned int height, unsigned int maxNbOccluders)
+		: mesh(mesh)
+		, width(std::max(width, 1u))
+		, height(std::max(height, 1u))
+		, transformation(Eigen::Matrix4f::Identity()) {
+	/* Depth pyramid */
+
+	unsigned int levelWidth = this->width;
+	unsigned int levelHeight = this->height;
+	while (true) {
+		this->levels.push_back(std::vector<float>(levelWidth * levelHeight,
+				FLT_MAX));
+		this->levelsWidth.push_back(levelWidth);
+		this->levelsHeight.push_back(levelHeight);
+		if ((levelWidth == 1) && (levelHeight == 1))
+			break;
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+
+	/* Occluders */
+
+	if ((this->mesh == nullptr) || (this->mesh->nbFaces == 0))
+		return;
+
+	// Compute the area of each face
+	std::vector<float> areas(this->mesh->nbFaces);
+	const Eigen::Vector3f* positions = this->mesh->GetPositions();
+	unsigned int stride = this->mesh->GetVerticesStride();
+	ParallelFor(0, this->mesh->nbFaces,
+			[&](unsigned int first, unsigned int last) {
+		unsigned int* face;
+		for (unsigned int i = first; i < last; i++) {
+			face = this->mesh->facesVertices + (3 * i);
+			areas[i] = (positions[stride * face[1]]
+							- positions[stride * face[0]])
+					.cross(positions[stride * face[2]]
+							- positions[stride * face[0]])
+					.squaredNorm();
+		}
+	}, 4096);
+
+	// Keep the largest ones
+	// (Ties are broken by index so that the choice is always the same.)
+	unsigned int nbOccluders = std::min(maxNbOccluders, this->mesh->nbFaces);
+	std::vector<unsigned int> faces(this->mesh->nbFaces);
+	for (unsigned int i = 0; i < this->mesh->nbFaces; i++)
+		faces[i] = i;
+	auto isLarger = [&areas](unsigned int a, unsigned int b) {
+		if (areas[a] != areas[b])
+			return areas[a] > areas[b];
+		return a < b;
+	};
+	std::nth_element(faces.begin(), faces.begin() + nbOccluders, faces.end(),
+			isLarger);
+	std::sort(faces.begin(), faces.begin() + nbOccluders, isLarger);
+	for (unsigned int i = 0; i < nbOccluders; i++) {
+		if (areas[faces[i]] <= 0.)
+			break;
+		this->occluders.push_back(faces[i]);
+	}
+
+	this->screenX.resize(3 * this->occluders.size());
+	this->screenY.resize(3 * this->occluders.size());
+	this->screenZ.resize(3 * this->occluders.size());
+	this->rasterized.resize(this->occluders.size());
+}
+
+OcclusionCuller::~OcclusionCuller() {}
+
+void OcclusionCuller::Render(const Eigen::Matrix4f& transformation,
+		GLenum culledFaces) {
+	this->transformation = transformation;
+	bool cullFront = (culledFaces == GL_FRONT)
+			|| (culledFaces == GL_FRONT_AND_BACK);
+	bool cullBack = (culledFaces == GL_BACK)
+			|| (culledFaces == GL_FRONT_AND_BACK);
+
+	// Clear the depth buffer
+	std::fill(this->levels[0].begin(), this->levels[0].end(), FLT_MAX);
+
+	/* Project occluders’ vertices on the screen */
+
+	unsigned int nbOccluders = this->occluders.size();
+	const Eigen::Vector3f* positions = this->mesh->GetPositions();
+	unsigned int stride = this->mesh->GetVerticesStride();
+	ParallelFor(0, nbOccluders, [&](unsigned int first, unsigned int last) {
+		Eigen::Vector4f clip;
+		for (unsigned int i = first; i < last; i++) {
+			unsigned int* face =
+					this->mesh->facesVertices + (3 * this->occluders[i]);
+			this->rasterized[i] = 1;
+			for (unsigned int v = 0; v < 3; v++) {
+				clip = this->transformation
+						* positions[stride * face[v]].homogeneous();
+
+				// Don’t clip faces crossing the near plane, just skip them
+				if (clip.w() < OCCLUSION_MIN_W) {
+					this->rasterized[i] = 0;
+					break;
+				}
+
+				this->screenX[(3 * i) + v] =
+						((clip.x() / clip.w()) * .5f + .5f) * this->width;
+				this->screenY[(3 * i) + v] =
+						((clip.y() / clip.w()) * .5f + .5f) * this->height;
+				this->screenZ[(3 * i) + v] = clip.z() / clip.w();
+			}
+			if (!this->rasterized[i])
+				continue;
+
+			// Skip the faces OpenGL would cull
+			// (Counter-clockwise faces on the screen are front faces.)
+			const float* x = this->screenX.data() + (3 * i);
+			const float* y = this->screenY.data() + (3 * i);
+			float area = ((x[1] - x[0]) * (y[2] - y[0]))
+					- ((x[2] - x[0]) * (y[1] - y[0]));
+			if ((area > 0.) ? cullFront : cullBack)
+				this->rasterized[i] = 0;
+		}
+	}, 256);
+
+	this->nbRasterizedOccluders = 0;
+	for (unsigned int i = 0; i < nbOccluders; i++)
+		this->nbRasterizedOccluders += this->rasterized[i];
+
+	/* Rasterize them, one band of rows per thread */
+
+	ParallelFor(0, this->height, [this](unsigned int first, unsigned int last) {
+		this->RasterizeBand(first, last);
+	}, OCCLUSION_GRAIN_SIZE);
+
+	this->BuildPyramid();
+}
+
+bool OcclusionCuller::IsVisible(const Eigen::AlignedBox3f& box) const {
+	if (box.isEmpty())
+		return false;
+
+	/* Project the box on the screen */
+
+	float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+	float maxX = -FLT_MAX, maxY = -FLT_MAX;
+	Eigen::Vector4f clip;
+	for (unsigned int c = 0; c < 8; c++) {
+		clip = this->transformation * box.corner(
+				(Eigen::AlignedBox3f::CornerType) c).homogeneous();
+		if (clip.w() < OCCLUSION_MIN_W)
+			return true;
+
+		float x = ((clip.x() / clip.w()) * .5f + .5f) * this->width;
+		float y = ((clip.y() / clip.w()) * .5f + .5f) * this->height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		minZ = std::min(minZ, clip.z() / clip.w());
+	}
+
+	// Leave boxes out of the screen to frustum culling
+	if ((maxX < 0.) || (maxY < 0.) || (minX >= this->width)
+			|| (minY >= this->height))
+		return true;
+
+	/* Compare its nearest depth to the pyramid */
+
+	// (The box is grown by a pixel, as occluders can cover a pixel only partly
+	// but are stored as covering it whole.)
+	int x0 = std::max(0, (int) std::floor(minX) - 1);
+	int y0 = std::max(0, (int) std::floor(minY) - 1);
+	int x1 = std::min((int) this->width - 1, (int) std::floor(maxX) + 1);
+	int y1 = std::min((int) this->height - 1, (int) std::floor(maxY) + 1);
+
+	// Choose the level where the box covers at most 4x4 pixels
+	unsigned int level = 0;
+	while ((level + 1 < this->levels.size())
+			&& ((((x1 >> level) - (x0 >> level)) > 3)
+					|| (((y1 >> level) - (y0 >> level)) > 3)))
+		level++;
+
+	const std::vector<float>& depths = this->levels[level];
+	unsigned int levelWidth = this->levelsWidth[level];
+	for (int y = (y0 >> level); y <= (y1 >> level); y++) {
+		for (int x = (x0 >> level); x <= (x1 >> level); x++) {
+			if (minZ <= depths[(y * levelWidth) + x])
+				return true;
+		}
+	}
+
+	return false;
+}
+
+unsigned int OcclusionCuller::GetWidth() const {
+	return this->width;
+}
+
+unsigned int OcclusionCuller::GetHeight() const {
+	return this->height;
+}
+
+const float* OcclusionCuller::GetDepthBuffer() const {
+	return this->levels[0].data();
+}
+
+unsigned int OcclusionCuller::GetNbOccluders() const {
+	return this->occluders.size();
+}
+
+unsigned int OcclusionCuller::GetNbRasterizedOccluders() const {
+	return this->nbRasterizedOccluders;
+}
+
+void OcclusionCuller::RasterizeBand(unsigned int firstRow,
+		unsigned int lastRow) {
+	float* depths = this->levels[0].data();
+	unsigned int nbOccluders = this->occluders.size();
+	for (unsigned int i = 0; i < nbOccluders; i++) {
+		if (!this->rasterized[i])
+			continue;
+
+		float x0 = this->screenX[(3 * i)];
+		float y0 = this->screenY[(3 * i)];
+		float z0 = this->screenZ[(3 * i)];
+		float x1 = this->screenX[(3 * i) + 1];
+		float y1 = this->screenY[(3 * i) + 1];
+		float z1 = this->screenZ[(3 * i) + 1];
+		float x2 = this->screenX[(3 * i) + 2];
+		float y2 = this->screenY[(3 * i) + 2];
+		float z2 = this->screenZ[(3 * i) + 2];
+
+		// Make the face counter-clockwise
+		// (Clockwise faces left are only the ones OpenGL doesn’t cull.)
+		float area = ((x1 - x0) * (y2 - y0)) - ((x2 - x0) * (y1 - y0));
+		if (std::abs(area) < 1e-6f)
+			continue;
+		if (area < 0.) {
+			std::swap(x1, x2);
+			std::swap(y1, y2);
+			std::swap(z1, z2);
+			area = -area;
+		}
+
+		// Find the pixels to visit in the band
+		int minX = std::max(0,
+				(int) std::floor(std::min(x0, std::min(x1, x2))));
+		int maxX = std::min((int) this->width - 1,
+				(int) std::floor(std::max(x0, std::max(x1, x2))));
+		int minY = std::max((int) firstRow,
+				(int) std::floor(std::min(y0, std::min(y1, y2))));
+		int maxY = std::min((int) lastRow - 1,
+				(int) std::floor(std::max(y0, std::max(y1, y2))));
+		if ((minX > maxX) || (minY > maxY))
+			continue;
+
+		// Set up edge functions (positive inside)
+		// (Pixels are covered if their center is inside the face, so faces
+		// sharing an edge don’t leave holes between them.)
+		float a0 = y1 - y2, b0 = x2 - x1;
+		float a1 = y2 - y0, b1 = x0 - x2;
+		float a2 = y0 - y1, b2 = x1 - x0;
+		float c0 = -(a0 * x1 + b0 * y1);
+		float c1 = -(a1 * x2 + b1 * y2);
+		float c2 = -(a2 * x0 + b2 * y0);
+
+		// Set up the depth plane
+		// (Its value is the farthest depth reached in each pixel.)
+		float dzdx =
+				(((z1 - z0) * (y2 - y0)) - ((z2 - z0) * (y1 - y0))) / area;
+		float dzdy =
+				(((z2 - z0) * (x1 - x0)) - ((z1 - z0) * (x2 - x0))) / area;
+		float dz = z0 - (dzdx * x0) - (dzdy * y0)
+				+ .5f * (std::abs(dzdx) + std::abs(dzdy));
+		float maxZ = std::max(z0, std::max(z1, z2));
+
+		for (int y = minY; y <= maxY; y++) {
+			float py = y + .5f;
+			float e0y = (b0 * py) + c0;
+			float e1y = (b1 * py) + c1;
+			float e2y = (b2 * py) + c2;
+			float zy = (dzdy * py) + dz;
+			float* row = depths + (y * this->width);
+
+			// Keep the loop free of branches so it can be vectorized
+			for (int x = minX; x <= maxX; x++) {
+				float px = x + .5f;
+				bool inside = (((a0 * px) + e0y) >= 0.)
+						& (((a1 * px) + e1y) >= 0.)
+						& (((a2 * px) + e2y) >= 0.);
+				float z = std::min((dzdx * px) + zy, maxZ);
+				row[x] = (inside & (z < row[x])) ? z : row[x];
+			}
+		}
+	}
+}
+
+void OcclusionCuller::BuildPyramid() {
+	for (unsigned int l = 1; l < this->levels.size(); l++) {
+		const std::vector<float>& previous = this->levels[l - 1];
+		std::vector<float>& current = this->levels[l];
+		unsigned int previousWidth = this->levelsWidth[l - 1];
+		unsigned int previousHeight = this->levelsHeight[l - 1];
+		unsigned int currentWidth = this->levelsWidth[l];
+		unsigned int currentHeight = this->levelsHeight[l];
+
+		// Keep the farthest depth of each 2x2 pixels
+		// (On odd sizes, the last pixels only have 1 or 2 children.)
+		for (unsigned int y = 0; y < currentHeight; y++) {
+			unsigned int y0 = 2 * y;
+			unsigned int y1 = std::min(y0 + 1, previousHeight - 1);
+			for (unsigned int x = 0; x < currentWidth; x++) {
+				unsigned int x0 = 2 * x;
+				unsigned int x1 = std::min(x0 + 1, previousWidth - 1);
+				current[(y * currentWidth) + x] = std::max(
+						std::max(previous[(y0 * previousWidth) + x0],
+								previous[(y0 * previousWidth) + x1]),
+						std::max(previous[(y1 * previousWidth) + x0],
+								previous[(y1 * previousWidth) + x1]));
+			}
+		}
+	}
+}
@@ -0,0 +1,151 @@
+#include "parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Pool of worker threads used by `ParallelFor()`.
+ *
+ * Worker threads are created once and wait for tasks in a shared queue.
+ * Threads waiting for their own tasks to end also run queued tasks, so nested
+ * parallel loops can't lock the pool.
+ */
+class ThreadPool
+{
+public:
+	ThreadPool() {
+		unsigned int nbThreads = std::thread::hardware_concurrency();
+		this->nbThreads = (nbThreads ? nbThreads : 1);
+
+		// The calling thread always works, so one less worker is needed
+		for (unsigned int i = 1; i < this->nbThreads; i++)
+			this->workers.push_back(std::thread(&ThreadPool::Work, this));
+	}
+
+	~ThreadPool() {
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->stopping = true;
+		}
+		this->condition.notify_all();
+		for (auto& worker: this->workers)
+			worker.join();
+	}
+
+	unsigned int GetNbThreads() {
+		return this->nbThreads;
+	}
+
+	void Push(const std::function<void()>& task) {
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->tasks.push_back(task);
+		}
+		this->condition.notify_one();
+	}
+
+	void WaitFor(std::atomic<unsigned int>& remaining) {
+		std::function<void()> task;
+		while (remaining.load() > 0) {
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				if (this->tasks.empty()) {
+					// Nothing to help with: wait for a task to end
+					this->condition.wait(lock, [&] {
+						return (remaining.load() == 0)
+								|| !this->tasks.empty();
+					});
+					continue;
+				}
+				task = this->tasks.front();
+				this->tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	void NotifyTaskEnded() {
+		// Lock to avoid notifying between a check and a wait in `WaitFor()`
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->condition.notify_all();
+	}
+
+private:
+	void Work() {
+		std::function<void()> task;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->condition.wait(lock, [this] {
+					return this->stopping || !this->tasks.empty();
+				});
+				if (this->stopping && this->tasks.empty())
+					return;
+				task = this->tasks.front();
+				this->tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	unsigned int nbThreads = 1;
+	bool stopping = false;
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+};
+
+static ThreadPool& GetThreadPool() {
+	static ThreadPool pool;
+	return pool;
+}
+
+unsigned int GetNbWorkerThreads() {
+	return GetThreadPool().GetNbThreads();
+}
+
+void ParallelFor(unsigned int begin, unsigned int end,
+		const std::function<void(unsigned int, unsigned int)>& function,
+		unsigned int grainSize) {
+	if (end <= begin)
+		return;
+
+	// Choose the number of blocks
+	unsigned int size = end - begin;
+	if (grainSize == 0)
+		grainSize = 1;
+	ThreadPool& pool = GetThreadPool();
+	unsigned int nbBlocks = (size + grainSize - 1) / grainSize;
+	if (nbBlocks > pool.GetNbThreads())
+		nbBlocks = pool.GetNbThreads();
+
+	// Don’t bother the pool for a single block
+	if (nbBlocks < 2) {
+		function(begin, end);
+		return;
+	}
+
+	// Send all blocks but the first one to the pool
+	std::atomic<unsigned int> remaining(nbBlocks - 1);
+	for (unsigned int b = 1; b < nbBlocks; b++) {
+		unsigned int first = begin + (unsigned int)
+				((unsigned long long) size * b / nbBlocks);
+		unsigned int last = begin + (unsigned int)
+				((unsigned long long) size * (b + 1) / nbBlocks);
+		pool.Push([&function, &remaining, &pool, first, last] {
+			function(first, last);
+			remaining--;
+			pool.NotifyTaskEnded();
+		});
+	}
+
+	// Work on the first block, then help with the others
+	function(begin, begin + (size / nbBlocks));
+	pool.WaitFor(remaining);
+}
@@ -0,0 +1,400 @@
+#include "programcache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <sstream>
+
+#include "utils.h"
+
+static size_t HashSources(const std::string& vertexSource,
+		const std::string& fragmentSource) {
+	std::hash<std::string> hash;
+	size_t vertexHash = hash(vertexSource);
+	return vertexHash ^ (hash(fragmentSource) + 0x9e3779b9 + (vertexHash << 6)
+			+ (vertexHash >> 2));
+}
+
+static void WriteBlock(std::ofstream& file, const void* data, uint32_t size) {
+	file.write((const char*) &size, sizeof(size));
+	file.write((const char*) data, size);
+}
+
+static bool ReadBlock(std::ifstream& file, std::vector<char>& data) {
+	uint32_t size = 0;
+	if (!file.read((char*) &size, sizeof(size)))
+		return false;
+	data.resize(size);
+	return (size == 0) || file.read(data.data(), size);
+}
+
+static bool MatchBlock(std::ifstream& file, const std::string& expected) {
+	// (Only compared, so a mismatch stops reading as soon as possible.)
+	uint32_t size = 0;
+	if (!file.read((char*) &size, sizeof(size)) || (size != expected.size()))
+		return false;
+	std::vector<char> data(size);
+	return ((size == 0) || file.read(data.data(), size))
+			&& !memcmp(data.data(), expected.data(), size);
+}
+
+ProgramCache::ProgramCache(unsigned int capacity)
+		: capacity(capacity) {}
+
+ProgramCache::~ProgramCache() {
+	for (ProgramCacheEntry& entry: this->entries)
+		glDeleteProgram(entry.programID);
+	for (auto& shader: this->shaders)
+		glDeleteShader(shader.first);
+}
+
+GLuint ProgramCache::Acquire(const std::string& vertexSource,
+		const std::string& fragmentSource) {
+	size_t hash = HashSources(vertexSource, fragmentSource);
+	auto range = this->entriesByHash.equal_range(hash);
+	for (auto i = range.first; i != range.second; i++) {
+		// (Sources are compared too, in case of a collision.)
+		std::list<ProgramCacheEntry>::iterator entry = i->second;
+		if ((entry->vertexSource != vertexSource)
+				|| (entry->fragmentSource != fragmentSource))
+			continue;
+
+		this->entries.splice(this->entries.begin(), this->entries, entry);
+		entry->nbUsers++;
+		this->nbHits++;
+		return entry->programID;
+	}
+
+	this->nbMisses++;
+	return 0;
+}
+
+void ProgramCache::Add(const std::string& vertexSource,
+		const std::string& fragmentSource, GLuint programID) {
+	ProgramCacheEntry entry;
+	entry.vertexSource = vertexSource;
+	entry.fragmentSource = fragmentSource;
+	entry.hash = HashSources(vertexSource, fragmentSource);
+	entry.programID = programID;
+	entry.nbUsers = 1;
+
+	this->entries.push_front(entry);
+	this->entriesByHash.insert(std::make_pair(entry.hash,
+			this->entries.begin()));
+	this->entriesByProgram[programID] = this->entries.begin();
+
+	this->Evict();
+}
+
+void ProgramCache::Release(GLuint programID) {
+	auto i = this->entriesByProgram.find(programID);
+	if ((i == this->entriesByProgram.end()) || (i->second->nbUsers == 0))
+		return;
+
+	i->second->nbUsers--;
+	this->Evict();
+}
+
+GLuint ProgramCache::AcquireShader(GLenum type, const std::string& source) {
+	size_t hash = std::hash<std::string>()(source) ^ (size_t) type;
+	auto range = this->shadersByHash.equal_range(hash);
+	for (auto i = range.first; i != range.second; i++) {
+		ShaderCacheEntry& entry = this->shaders[i->second];
+		if ((entry.type != type) || (entry.source != source))
+			continue;
+
+		entry.nbUsers++;
+		this->nbReusedShaders++;
+		return i->second;
+	}
+
+	GLuint shaderID = glCreateShader(type);
+	const GLchar* content = source.c_str();
+	glShaderSource(shaderID, 1, (const GLchar**) &content, 0);
+	glCompileShader(shaderID);
+
+	ShaderCacheEntry& entry = this->shaders[shaderID];
+	entry.type = type;
+	entry.source = source;
+	entry.hash = hash;
+	entry.nbUsers = 1;
+	this->shadersByHash.insert(std::make_pair(hash, shaderID));
+	this->nbCompiledShaders++;
+
+	return shaderID;
+}
+
+void ProgramCache::ReleaseShader(GLuint shaderID) {
+	auto entry = this->shaders.find(shaderID);
+	if (entry == this->shaders.end())
+		return;
+	if (--entry->second.nbUsers)
+		return;
+
+	// (Shaders still attached to programs are only flagged for deletion.)
+	auto range = this->shadersByHash.equal_range(entry->second.hash);
+	for (auto i = range.first; i != range.second; i++) {
+		if (i->second == shaderID) {
+			this->shadersByHash.erase(i);
+			break;
+		}
+	}
+	this->shaders.erase(entry);
+	glDeleteShader(shaderID);
+}
+
+void ProgramCache::Clear() {
+	for (auto entry = this->entries.begin(); entry != this->entries.end();) {
+		auto next = std::next(entry);
+		if (entry->nbUsers == 0)
+			this->Erase(entry);
+		entry = next;
+	}
+}
+
+void ProgramCache::ResetStatistics() {
+	this->nbHits = 0;
+	this->nbMisses = 0;
+	this->nbCompiledShaders = 0;
+	this->nbReusedShaders = 0;
+	this->nbCompiledPrograms = 0;
+	this->nbLoadedBinaries = 0;
+	this->compilationTime = 0.;
+	this->binariesLoadingTime = 0.;
+}
+
+void ProgramCache::PrepareBinary(GLuint programID) {
+	if (this->UseBinaries()) {
+		gl::glProgramParameteri(programID,
+				gl::GL_PROGRAM_BINARY_RETRIEVABLE_HINT, (GLint) GL_TRUE);
+	}
+}
+
+GLuint ProgramCache::LoadBinary(const std::string& vertexSource,
+		const std::string& fragmentSource) {
+	if (!this->UseBinaries())
+		return 0;
+
+	std::ifstream file(this->GetBinaryPath(vertexSource, fragmentSource)
+			.c_str(), std::ios::in | std::ios::binary);
+	if (!file)
+		return 0;
+
+	// Check that the binary was saved from the same sources, by the same
+	// driver and in a format it still accepts
+	char magic[sizeof(PROGRAM_BINARY_MAGIC) - 1];
+	uint32_t format = 0;
+	if (!file.read(magic, sizeof(magic))
+			|| memcmp(magic, PROGRAM_BINARY_MAGIC, sizeof(magic))
+			|| !file.read((char*) &format, sizeof(format))
+			|| !MatchBlock(file, this->driver)
+			|| !MatchBlock(file, vertexSource)
+			|| !MatchBlock(file, fragmentSource))
+		return 0;
+	bool formatSupported = false;
+	for (GLint supportedFormat: this->binariesFormats)
+		formatSupported |= ((uint32_t) supportedFormat == format);
+	std::vector<char> binary;
+	if (!formatSupported || !ReadBlock(file, binary) || binary.empty())
+		return 0;
+	file.close();
+
+	// The driver may still reject it (after an update for instance), then the
+	// program is compiled again and its binary replaced
+	GLuint programID = glCreateProgram();
+	gl::glProgramBinary(programID, (GLenum) format, binary.data(),
+			(GLsizei) binary.size());
+	int linked;
+	glGetProgramiv(programID, GL_LINK_STATUS, &linked);
+	if (linked != ((int) GL_TRUE)) {
+		glDeleteProgram(programID);
+		return 0;
+	}
+
+	return programID;
+}
+
+bool ProgramCache::SaveBinary(const std::string& vertexSource,
+		const std::string& fragmentSource, GLuint programID) {
+	if (!this->UseBinaries())
+		return false;
+
+	GLint size = 0;
+	glGetProgramiv(programID, gl::GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0)
+		return false;
+	std::vector<char> binary(size);
+	GLsizei length = 0;
+	GLenum format;
+	gl::glGetProgramBinary(programID, size, &length, &format, binary.data());
+	if (length <= 0)
+		return false;
+
+	if (!MakeDirectory(this->binariesDirectory))
+		return false;
+	std::ofstream file(this->GetBinaryPath(vertexSource, fragmentSource)
+			.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	uint32_t fileFormat = (uint32_t) format;
+	file.write(PROGRAM_BINARY_MAGIC, sizeof(PROGRAM_BINARY_MAGIC) - 1);
+	file.write((const char*) &fileFormat, sizeof(fileFormat));
+	WriteBlock(file, this->driver.data(), this->driver.size());
+	WriteBlock(file, vertexSource.data(), vertexSource.size());
+	WriteBlock(file, fragmentSource.data(), fragmentSource.size());
+	WriteBlock(file, binary.data(), length);
+	file.close();
+
+	return !file.fail();
+}
+
+void ProgramCache::AddLoadingTime(float time, bool fromBinary) {
+	if (fromBinary) {
+		this->nbLoadedBinaries++;
+		this->binariesLoadingTime += time;
+	} else {
+		this->nbCompiledPrograms++;
+		this->compilationTime += time;
+	}
+}
+
+unsigned int ProgramCache::GetCapacity() const {
+	return this->capacity;
+}
+
+unsigned int ProgramCache::GetSize() const {
+	return this->entries.size();
+}
+
+unsigned int ProgramCache::GetNbUsedPrograms() const {
+	unsigned int nbUsedPrograms = 0;
+	for (const ProgramCacheEntry& entry: this->entries) {
+		if (entry.nbUsers)
+			nbUsedPrograms++;
+	}
+	return nbUsedPrograms;
+}
+
+unsigned int ProgramCache::GetNbHits() const {
+	return this->nbHits;
+}
+
+unsigned int ProgramCache::GetNbMisses() const {
+	return this->nbMisses;
+}
+
+unsigned int ProgramCache::GetNbShaders() const {
+	return this->shaders.size();
+}
+
+unsigned int ProgramCache::GetNbCompiledShaders() const {
+	return this->nbCompiledShaders;
+}
+
+unsigned int ProgramCache::GetNbReusedShaders() const {
+	return this->nbReusedShaders;
+}
+
+unsigned int ProgramCache::GetNbCompiledPrograms() const {
+	return this->nbCompiledPrograms;
+}
+
+unsigned int ProgramCache::GetNbLoadedBinaries() const {
+	return this->nbLoadedBinaries;
+}
+
+float ProgramCache::GetCompilationTime() const {
+	return this->compilationTime;
+}
+
+float ProgramCache::GetBinariesLoadingTime() const {
+	return this->binariesLoadingTime;
+}
+
+const std::string& ProgramCache::GetBinariesDirectory() const {
+	return this->binariesDirectory;
+}
+
+bool ProgramCache::UseBinaries() {
+	if (this->binariesDirectory.empty())
+		return false;
+
+	if (!this->binariesChecked) {
+		this->binariesChecked = true;
+
+		// Binaries need OpenGL 4.1 or ARB_get_program_binary, and at least one
+		// format (drivers may support none)
+		GLint nbFormats = 0;
+		glGetIntegerv(gl::GL_NUM_PROGRAM_BINARY_FORMATS, &nbFormats);
+		if (nbFormats > 0) {
+			this->binariesFormats.resize(nbFormats);
+			glGetIntegerv(gl::GL_PROGRAM_BINARY_FORMATS,
+					this->binariesFormats.data());
+		}
+		// (An unknown enumeration only raises an error, which is cleared.)
+		while (glGetError() != GL_NO_ERROR) {}
+
+		// Binaries are only valid for the driver which created them
+		for (GLenum name: { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+			const GLubyte* value = glGetString(name);
+			if (value != nullptr)
+				this->driver += std::string((const char*) value) + '\n';
+		}
+	}
+
+	return !this->binariesFormats.empty();
+}
+
+void ProgramCache::SetCapacity(unsigned int capacity) {
+	this->capacity = capacity;
+	this->Evict();
+}
+
+void ProgramCache::SetBinariesDirectory(const std::string& directory) {
+	this->binariesDirectory = directory;
+}
+
+void ProgramCache::Evict() {
+	// Start from the least recently used program, skipping used ones
+	// (Erasing from a list keeps the following positions valid.)
+	auto entry = this->entries.end();
+	while ((this->entries.size() > this->capacity)
+			&& (entry != this->entries.begin())) {
+		auto previous = std::prev(entry);
+		if (previous->nbUsers)
+			entry = previous;
+		else
+			this->Erase(previous);
+	}
+}
+
+void ProgramCache::Erase(std::list<ProgramCacheEntry>::iterator entry) {
+	auto range = this->entriesByHash.equal_range(entry->hash);
+	for (auto i = range.first; i != range.second; i++) {
+		if (i->second == entry) {
+			this->entriesByHash.erase(i);
+			break;
+		}
+	}
+	this->entriesByProgram.erase(entry->programID);
+	glDeleteProgram(entry->programID);
+	this->entries.erase(entry);
+}
+
+std::string ProgramCache::GetBinaryPath(const std::string& vertexSource,
+		const std::string& fragmentSource) const {
+	// Files are named after the hash of the sources and of the driver
+	// (Collisions only make the binary be compiled again.)
+	size_t hash = HashSources(vertexSource, fragmentSource)
+			^ std::hash<std::string>()(this->driver);
+	std::ostringstream path;
+	path << this->binariesDirectory;
+	char last = this->binariesDirectory.back();
+	if ((last != '/') && (last != PATH_DELIMITER))
+		path << PATH_DELIMITER;
+	path << std::hex << hash << ".bin";
+	return path.str();
+}
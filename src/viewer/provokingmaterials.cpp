@@ -0,0 +1,96 @@
+#include "provokingmaterials.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+// Order in which the vertices of a face are tried (the last one first, so
+// that most faces are kept as they are)
+static const unsigned int provokingOrder[3] = { 2, 0, 1 };
+
+ProvokingMaterials::ProvokingMaterials(Mesh* mesh) {
+	if ((mesh == nullptr) || (mesh->facesVertices == nullptr))
+		return;
+	auto start = std::chrono::steady_clock::now();
+
+	unsigned int nbVertices = mesh->nbVertices;
+	this->facesVertices.assign(mesh->facesVertices,
+			mesh->facesVertices + (3 * (size_t) mesh->nbFaces));
+	this->verticesMaterials.assign(nbVertices, 0);
+	std::vector<bool> assigned(nbVertices, false);
+	// Copies of the vertices, by vertex and material
+	std::unordered_map<unsigned long long, unsigned int> copies;
+
+	for (unsigned int f = 0; f < mesh->nbFaces; f++) {
+		unsigned int* face = this->facesVertices.data() + (3 * (size_t) f);
+		unsigned char material = mesh->facesMaterials[f];
+
+		// Find a vertex which is free or already has the material
+		int provoking = -1;
+		for (unsigned int k: provokingOrder) {
+			unsigned int vertex = face[k];
+			if (!assigned[vertex]
+					|| (this->verticesMaterials[vertex] == material)) {
+				assigned[vertex] = true;
+				this->verticesMaterials[vertex] = material;
+				provoking = k;
+				break;
+			}
+		}
+
+		// Otherwise use a copy of one of them with the material, or make one
+		for (unsigned int k: provokingOrder) {
+			if (provoking >= 0)
+				break;
+			auto copy = copies.find(
+					((unsigned long long) face[k] << 8) | material);
+			if (copy != copies.end()) {
+				face[k] = copy->second;
+				provoking = k;
+			}
+		}
+		if (provoking < 0) {
+			unsigned int copy = nbVertices
+					+ (unsigned int) this->duplicatedVertices.size();
+			copies[((unsigned long long) face[2] << 8) | material] = copy;
+			this->duplicatedVertices.push_back(face[2]);
+			this->verticesMaterials.push_back(material);
+			assigned.push_back(true);
+			face[2] = copy;
+			provoking = 2;
+		}
+
+		// Rotate the face so that the vertex is the last one
+		if (provoking == 0)
+			std::rotate(face, face + 1, face + 3);
+		else if (provoking == 1)
+			std::rotate(face, face + 2, face + 3);
+	}
+
+	this->computingTime = std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+}
+
+ProvokingMaterials::~ProvokingMaterials() {}
+
+const unsigned int* ProvokingMaterials::GetFacesVertices() const {
+	return this->facesVertices.empty() ? nullptr : this->facesVertices.data();
+}
+
+const std::vector<unsigned int>&
+		ProvokingMaterials::GetDuplicatedVertices() const {
+	return this->duplicatedVertices;
+}
+
+const std::vector<unsigned char>&
+		ProvokingMaterials::GetVerticesMaterials() const {
+	return this->verticesMaterials;
+}
+
+unsigned int ProvokingMaterials::GetNbVertices() const {
+	return (unsigned int) this->verticesMaterials.size();
+}
+
+float ProvokingMaterials::GetComputingTime() const {
+	return this->computingTime;
+}
@@ -2,6 +2,7 @@
 
 #include <string>
 
+#include "context.h"
 #include "light.h"
 #include "material.h"
 #include "shadersreader.h"
@@ -22,148 +23,147 @@ ForwardRenderer::ForwardRenderer(Renderer* renderer)
 
 ForwardRenderer::~ForwardRenderer() {
 	this->CleanShaders();
+	if (this->fallbackShaders != nullptr)
+		delete this->fallbackShaders;
 
-	if (this->directionalLightsDirection != nullptr)
-		delete this->directionalLightsDirection;
-	if (this->directionalLightsIntensity != nullptr)
-		delete this->directionalLightsIntensity;
-	if (this->pointLightsPosition != nullptr)
-		delete this->pointLightsPosition;
-	if (this->pointLightsIntensity != nullptr)
-		delete this->pointLightsIntensity;
+	for (unsigned char i = 0; i < LB_COUNT; i++) {
+		if (this->lightsBuffersIDs[i] == 0)
+			continue;
+		glDeleteBuffers(1, &this->lightsBuffersIDs[i]);
+		glDeleteTextures(1, &this->lightsTexturesIDs[i]);
+	}
+	if (this->materialsTableBufferID != 0) {
+		glDeleteBuffers(1, &this->materialsTableBufferID);
+		glDeleteTextures(1, &this->materialsTableTextureID);
+	}
 }
 
 void ForwardRenderer::Render(ImVec2 size) {
-	this->ActivateContext();
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size.x, size.y, 0,
-			GL_RGB, GL_UNSIGNED_BYTE, 0);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, size.x, size.y);
+	// (Attachments are only reallocated when the size changes.)
+	this->ActivateContext(size);
 
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_PROGRAM_POINT_SIZE);
 
 	glViewport(0, 0, size.x, size.y);
 	this->scene->UpdateCameraViewport(size);
+	this->scene->UpdateFrameConstants();
+	this->scene->CullMesh();
 
 	glClearColor(this->clearColor[0], this->clearColor[1], this->clearColor[2],
 			this->clearColor[3]);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	// Lights are read by all shaders from the same texture units
+	for (unsigned char i = 0; i < LB_COUNT; i++) {
+		glActiveTexture(GL_TEXTURE0 + STU_LIGHTS_DIR_DIRECTION + i);
+		glBindTexture(GL_TEXTURE_BUFFER, this->lightsTexturesIDs[i]);
+	}
+	glActiveTexture(GL_TEXTURE0 + STU_MATERIALS_TABLE);
+	glBindTexture(GL_TEXTURE_BUFFER, this->materialsTableTextureID);
+	glActiveTexture(GL_TEXTURE0);
+
+	// Programs not linked yet are replaced by the fallback one
+	this->FinishShaders();
 	for (unsigned char i = 0; i < this->nbShaders; i++) {
-		if (this->shaders[i] == nullptr)
+		ShadersReader* shaders = this->shaders[i];
+		if (shaders == nullptr)
 			continue;
-		this->shaders[i]->Activate();
-
-		glUniformMatrix4fv(
-				this->shaders[i]->GetUniformLocation("projection_matrix"), 1, false,
-				this->scene->GetCamera()->ComputeProjectionMatrix().data());
-		glUniformMatrix4fv(this->shaders[i]->GetUniformLocation("model_matrix"), 1,
-				false, this->scene->GetMeshTransformationMatrix().data());
-		glUniformMatrix3fv(this->shaders[i]->GetUniformLocation("normal_matrix"), 1,
-				false, this->scene->GetNormalMatrix().data());
-		if (this->scene->navigate3D){
-			glUniformMatrix4fv(this->shaders[i]->GetUniformLocation("view_matrix"),
-					1, false,
-					this->scene->GetCamera()->Compute3DViewMatrix().data());
-		} else {
-			glUniformMatrix4fv(this->shaders[i]->GetUniformLocation("view_matrix"),
-					1, false, this->scene->GetCamera()->ComputeViewMatrix().data());
+		if (!shaders->AreLoaded()) {
+			shaders = this->fallbackShaders;
+			if ((shaders == nullptr) || !shaders->AreLoaded())
+				continue;
 		}
-		glUniform3fv(this->shaders[i]->GetUniformLocation("lights_dir_direction"),
-				this->nbDirectionalLights, this->directionalLightsDirection);
-		glUniform3fv(this->shaders[i]->GetUniformLocation("lights_dir_intensity"),
-				this->nbDirectionalLights, this->directionalLightsIntensity);
-		glUniform3fv(this->shaders[i]->GetUniformLocation("lights_pt_position"),
-				this->nbPointLights, this->pointLightsPosition);
-		glUniform3fv(this->shaders[i]->GetUniformLocation("lights_pt_intensity"),
-				this->nbPointLights, this->pointLightsIntensity);
-		glUniform3fv(this->shaders[i]->GetUniformLocation("ambient_color"), 1,
+		shaders->Activate();
+
+		glUniform1i(shaders->GetUniformLocation(SU_LIGHTS_DIR_DIRECTION),
+				STU_LIGHTS_DIR_DIRECTION);
+		glUniform1i(shaders->GetUniformLocation(SU_LIGHTS_DIR_INTENSITY),
+				STU_LIGHTS_DIR_INTENSITY);
+		glUniform1i(shaders->GetUniformLocation(SU_NB_DIR_LIGHTS),
+				this->nbDirectionalLights);
+		glUniform1i(shaders->GetUniformLocation(SU_LIGHTS_PT_POSITION),
+				STU_LIGHTS_PT_POSITION);
+		glUniform1i(shaders->GetUniformLocation(SU_LIGHTS_PT_INTENSITY),
+				STU_LIGHTS_PT_INTENSITY);
+		glUniform1i(shaders->GetUniformLocation(SU_NB_PT_LIGHTS),
+				this->nbPointLights);
+		glUniform3fv(shaders->GetUniformLocation(SU_AMBIENT_COLOR), 1,
 				this->scene->GetAmbientColor().data());
+		glUniform1i(shaders->GetUniformLocation(SU_MATERIALS_TABLE),
+				STU_MATERIALS_TABLE);
 
-		this->scene->RenderMesh(this->shaders[i], i);
+		this->scene->RenderMesh(shaders, i);
 
-		this->shaders[i]->Deactivate();
+		shaders->Deactivate();
 	}
 
 	this->DeactivateContext();
 }
 
-void ForwardRenderer::UpdateDirectionalLightList(bool reload) {
+void ForwardRenderer::UpdateDirectionalLightList() {
 	if (this->scene == nullptr)
 		return;
-	if (this->directionalLightsDirection != nullptr)
-		delete this->directionalLightsDirection;
-	if (this->directionalLightsDirection != nullptr)
-		delete this->directionalLightsIntensity;
 
+	// Lights are padded to 4 floats, the smallest format of all OpenGL versions
+	// (Counts are uniforms, so shaders never need to be reloaded.)
 	std::vector<DirectionalLight*>* lights =
 			this->scene->GetDirectionalLights();
 	this->nbDirectionalLights = lights->size();
-	this->directionalLightsDirection =
-			(float*) malloc(sizeof(float) * 3 * nbDirectionalLights);
-	this->directionalLightsIntensity =
-			(float*) malloc(sizeof(float) * 3 * nbDirectionalLights);
-
-	DirectionalLight* light;
+	std::vector<float> directions(4 * this->nbDirectionalLights, 0.);
+	std::vector<float> intensities(4 * this->nbDirectionalLights, 0.);
 	for (unsigned int i = 0; i < this->nbDirectionalLights; i++) {
-		light = lights->at(i);
-		this->directionalLightsDirection[3 * i] = light->GetDirection()[0];
-		this->directionalLightsDirection[3 * i + 1] = light->GetDirection()[1];
-		this->directionalLightsDirection[3 * i + 2] = light->GetDirection()[2];
-		this->directionalLightsIntensity[3 * i] = light->GetIntensity()[0];
-		this->directionalLightsIntensity[3 * i + 1] = light->GetIntensity()[1];
-		this->directionalLightsIntensity[3 * i + 2] = light->GetIntensity()[2];
-	}
-
-	if (this->shaders != nullptr) {
-		for (unsigned int i = 0; i < this->nbShaders; i++) {
-			if (this->shaders[i] != nullptr) {
-				this->shaders[i]->SetPreProcessorMacro(SPPM_NB_DIR_LIGHTS,
-						std::to_string(this->nbDirectionalLights));
-			}
+		DirectionalLight* light = lights->at(i);
+		for (unsigned int c = 0; c < 3; c++) {
+			directions[(4 * i) + c] = light->GetDirection()[c];
+			intensities[(4 * i) + c] = light->GetIntensity()[c];
 		}
-		if (reload)
-			this->ReloadShaders();
 	}
+	this->UploadTextureBuffer(this->lightsBuffersIDs[LB_DIR_DIRECTION],
+			this->lightsTexturesIDs[LB_DIR_DIRECTION],
+			STU_LIGHTS_DIR_DIRECTION, directions);
+	this->UploadTextureBuffer(this->lightsBuffersIDs[LB_DIR_INTENSITY],
+			this->lightsTexturesIDs[LB_DIR_INTENSITY],
+			STU_LIGHTS_DIR_INTENSITY, intensities);
 }
 
-void ForwardRenderer::UpdatePointLightList(bool reload) {
+void ForwardRenderer::UpdatePointLightList() {
 	if (this->scene == nullptr)
 		return;
-	if (this->pointLightsPosition != nullptr)
-		delete this->pointLightsPosition;
-	if (this->pointLightsIntensity != nullptr)
-		delete this->pointLightsIntensity;
 
 	std::vector<PointLight*>* lights = this->scene->GetPointLights();
 	this->nbPointLights = lights->size();
-	this->pointLightsPosition =
-			(float*) malloc(sizeof(float) * 3 * nbPointLights);
-	this->pointLightsIntensity =
-			(float*) malloc(sizeof(float) * 3 * nbPointLights);
-
-	PointLight* light;
-	for (unsigned int i = 0; i < this->nbPointLights; i++){
-		light = lights->at(i);
-		this->pointLightsPosition[3 * i] = light->GetPosition()[0];
-		this->pointLightsPosition[3 * i + 1] = light->GetPosition()[1];
-		this->pointLightsPosition[3 * i + 2] = light->GetPosition()[2];
-		this->pointLightsIntensity[3 * i] = light->GetIntensity()[0];
-		this->pointLightsIntensity[3 * i + 1]  = light->GetIntensity()[1];
-		this->pointLightsIntensity[3 * i + 2]  = light->GetIntensity()[2];
+	std::vector<float> positions(4 * this->nbPointLights, 0.);
+	std::vector<float> intensities(4 * this->nbPointLights, 0.);
+	for (unsigned int i = 0; i < this->nbPointLights; i++) {
+		PointLight* light = lights->at(i);
+		for (unsigned int c = 0; c < 3; c++) {
+			positions[(4 * i) + c] = light->GetPosition()[c];
+			intensities[(4 * i) + c] = light->GetIntensity()[c];
+		}
 	}
+	this->UploadTextureBuffer(this->lightsBuffersIDs[LB_PT_POSITION],
+			this->lightsTexturesIDs[LB_PT_POSITION],
+			STU_LIGHTS_PT_POSITION, positions);
+	this->UploadTextureBuffer(this->lightsBuffersIDs[LB_PT_INTENSITY],
+			this->lightsTexturesIDs[LB_PT_INTENSITY],
+			STU_LIGHTS_PT_INTENSITY, intensities);
+}
 
-	if (this->shaders != nullptr) {
-		for (unsigned int i = 0; i < this->nbShaders; i++) {
-			if (this->shaders[i] != nullptr) {
-				this->shaders[i]->SetPreProcessorMacro(SPPM_NB_PT_LIGHTS,
-						std::to_string(this->nbPointLights));
-			}
-		}
-		if (reload)
-			this->ReloadShaders();
+void ForwardRenderer::UpdateMaterialList() {
+	if (this->scene == nullptr)
+		return;
+
+	// Parameters are indexed from the first material, like the branches
+	std::vector<float> parameters;
+	MaterialList* materialsPaths = this->scene->GetMaterialsPaths();
+	if ((materialsPaths != nullptr) && (this->context != nullptr)) {
+		parameters = ((Context*) this->context)->GetShaderPreprocessor()
+				->GetMaterialsTable(materialsPaths->GetMaterialsPaths(),
+						materialsPaths->GetNbMaterials());
 	}
+	this->UploadTextureBuffer(this->materialsTableBufferID,
+			this->materialsTableTextureID, STU_MATERIALS_TABLE, parameters);
 }
 
 void ForwardRenderer::InitFullPassShaders() {
@@ -176,20 +176,31 @@ void ForwardRenderer::InitFullPassShaders() {
 	this->nbShaders = 1;
 
 	this->shaders[0] = new ShadersReader(this->context);
-	this->UpdateDirectionalLightList(false);
-	this->UpdatePointLightList(false);
+	// (Batched per-material draws give their material to this program.)
+	if (this->usingMaterialsTable || this->renderingPerMaterial)
+		this->shaders[0]->SetPreProcessorMacro(ST_MATERIALS_TABLE, "1");
+	if (this->renderingPerMaterial)
+		this->shaders[0]->SetPreProcessorMacro(ST_MATERIAL_PER_DRAW, "1");
+	else if (this->usingProvokingMaterials)
+		this->shaders[0]->SetPreProcessorMacro(ST_MATERIAL_PER_VERTEX, "1");
+	this->UpdateDirectionalLightList();
+	this->UpdatePointLightList();
+	this->UpdateMaterialList();
 
 	MaterialList* materialsPaths = this->scene->GetMaterialsPaths();
 	if (materialsPaths == nullptr) {
-		this->shaders[0]->LoadFiles(
+		this->shaders[0]->SetFiles(
 				DATA_DIR "shaders/forward.vert",
 				DATA_DIR "shaders/forward.frag");
 	} else {
-		this->shaders[0]->LoadFiles(
+		this->shaders[0]->SetFiles(
 				DATA_DIR "shaders/forward.vert",
 				DATA_DIR "shaders/forward.frag",
 				materialsPaths);
 	}
+	this->InitFallbackShaders();
+	this->CompileShaders(std::vector<ShadersReader*>(this->shaders,
+			this->shaders + this->nbShaders));
 }
 
 void ForwardRenderer::InitPerMaterialShaders() {
@@ -199,6 +210,12 @@ void ForwardRenderer::InitPerMaterialShaders() {
 	if (mesh == nullptr)
 		return;
 
+	// Batched materials are all drawn by the one-pass program
+	if (this->batchingMaterials) {
+		this->InitFullPassShaders();
+		return;
+	}
+
 	this->CleanShaders();
 
 	this->nbShaders = this->scene->GetMesh()->nbMaterials;
@@ -207,13 +224,13 @@ void ForwardRenderer::InitPerMaterialShaders() {
 	for (unsigned char i = 0; i < this->nbShaders; i++)
 		this->shaders[i] = new ShadersReader(this->context);
 
-	this->UpdateDirectionalLightList(false);
-	this->UpdatePointLightList(false);
+	this->UpdateDirectionalLightList();
+	this->UpdatePointLightList();
 
 	MaterialList* materialsPaths = this->scene->GetMaterialsPaths();
 	if (materialsPaths == nullptr) {
 		for (unsigned char i = 0; i < this->nbShaders; i++) {
-			this->shaders[i]->LoadFiles(
+			this->shaders[i]->SetFiles(
 					DATA_DIR "shaders/forward.vert",
 					DATA_DIR "shaders/forward.frag");
 		}
@@ -221,19 +238,58 @@ void ForwardRenderer::InitPerMaterialShaders() {
 		unsigned char firstMaterial = (unsigned char)
 				this->scene->GetMesh()->GetMaterialsRange().min()[0];
 		for (unsigned char i = 0; i < this->nbShaders; i++) {
-			this->shaders[i]->LoadFiles(
+			this->shaders[i]->SetFiles(
 					DATA_DIR "shaders/forward.vert",
 					DATA_DIR "shaders/forward.frag",
 					materialsPaths->GetMaterialPath(firstMaterial + i));
 		}
 	}
+	this->InitFallbackShaders();
+	this->CompileShaders(std::vector<ShadersReader*>(this->shaders,
+			this->shaders + this->nbShaders));
+}
+
+void ForwardRenderer::InitFallbackShaders() {
+	// The fallback program is small, so it is loaded right away
+	if (this->fallbackShaders == nullptr) {
+		this->fallbackShaders = new ShadersReader(this->context);
+		this->fallbackShaders->LoadFiles(
+				DATA_DIR "shaders/simple.vert",
+				DATA_DIR "shaders/simple.frag");
+	}
+}
+
+void ForwardRenderer::UploadTextureBuffer(GLuint& bufferID, GLuint& textureID,
+		unsigned char textureUnit, const std::vector<float>& data) {
+	if (bufferID == 0) {
+		glGenBuffers(1, &bufferID);
+		glGenTextures(1, &textureID);
+	}
+
+	// (Empty buffers get a single texel, so that they are still valid.)
+	glBindBuffer(GL_TEXTURE_BUFFER, bufferID);
+	if (data.empty()) {
+		float empty[4] = { 0., 0., 0., 0. };
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(empty), empty, GL_STATIC_DRAW);
+	} else {
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(float) * data.size(),
+				data.data(), GL_STATIC_DRAW);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	// (The materials buffer stays bound on its unit.)
+	glActiveTexture(GL_TEXTURE0 + textureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, textureID);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, bufferID);
+	glActiveTexture(GL_TEXTURE0);
 }
 
 void ForwardRenderer::SetScene(Scene* scene) {
 	this->scene = scene;
 	this->InitScene();
 	if (this->scene != nullptr) {
-		this->UpdateDirectionalLightList(false);
-		this->UpdatePointLightList(false);
+		this->UpdateDirectionalLightList();
+		this->UpdatePointLightList();
+		this->UpdateMaterialList();
 	}
 }
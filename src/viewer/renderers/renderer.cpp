@@ -1,7 +1,11 @@
 #include "renderers/renderer.h"
 
+#include <algorithm>
 #include <iostream>
 
+#include "context.h"
+#include "parallel.h"
+
 Renderer::Renderer(void* context, bool renderingPerMaterial)
 		: context(context)
 		, renderingPerMaterial(renderingPerMaterial) {
@@ -19,26 +23,67 @@ Renderer::Renderer(Renderer* renderer)
 		: context(renderer->GetContext())
 		, scene(renderer->GetScene())
 		, clearColor(renderer->GetClearColor())
-		, renderingPerMaterial(renderer->IsRenderingPerMaterial()) {
+		, renderingPerMaterial(renderer->IsRenderingPerMaterial())
+		, usingMaterialsTable(renderer->IsUsingMaterialsTable())
+		, batchingMaterials(renderer->IsBatchingMaterials())
+		, usingProvokingMaterials(renderer->IsUsingProvokingMaterials())
+		, pullingVertices(renderer->IsPullingVertices()) {
 	this->Init();
 }
 
+bool Renderer::NeedsRender(ImVec2 size) {
+	if ((this->scene == nullptr) || (this->renderTarget == nullptr))
+		return true;
+	for (unsigned char i = 0; i < this->nbShaders; i++) {
+		if ((this->shaders[i] != nullptr) && this->shaders[i]->IsCompiling())
+			return true;
+	}
+	// (The viewport changes the projection matrix, so it is updated first.)
+	this->scene->UpdateCameraViewport(size);
+	return (this->renderTarget->width != std::max((int) size.x, 1))
+			|| (this->renderTarget->height != std::max((int) size.y, 1))
+			|| this->scene->NeedsRender();
+}
+
 void Renderer::InitShaders(bool updateVbos) {
 	if (this->renderingPerMaterial)
 		this->InitPerMaterialShaders();
 	else
 		this->InitFullPassShaders();
-	if ((this->scene != nullptr) && updateVbos)
-		this->scene->UpdateVbos();
+	this->WatchShaders();
+	if (this->scene != nullptr) {
+		this->scene->AskForRender();
+		if (updateVbos)
+			this->scene->UpdateVbos();
+	}
 }
 
 void Renderer::ReloadShaders() {
+	this->UpdateMaterialList();
 	if (this->shaders != nullptr) {
 		for (unsigned char i = 0; i < this->nbShaders; i++) {
 			if (this->shaders[i] != nullptr)
 				this->shaders[i]->Load();
 		}
 	}
+	this->WatchShaders();
+	if (this->scene != nullptr)
+		this->scene->AskForRender();
+}
+
+void Renderer::ReloadShaders(const std::vector<std::string>& paths) {
+	// (Parameters of the materials may have changed too.)
+	this->UpdateMaterialList();
+	std::vector<ShadersReader*> readers;
+	for (unsigned char i = 0; i < this->nbShaders; i++) {
+		if ((this->shaders[i] != nullptr) && this->shaders[i]->DependsOn(paths))
+			readers.push_back(this->shaders[i]);
+	}
+	this->CompileShaders(readers);
+	// (Reloaded shaders may include other files.)
+	this->WatchShaders();
+	if (this->scene != nullptr)
+		this->scene->AskForRender();
 }
 
 Renderer::~Renderer() {
@@ -53,8 +98,11 @@ const Eigen::Vector4f& Renderer::GetClearColor() {
 	return this->clearColor;
 }
 
-const GLuint& Renderer::GetRenderTexture() const {
-	return this->renderTextureID;
+GLuint Renderer::GetRenderTexture() const {
+	if ((this->renderTarget == nullptr)
+			|| this->renderTarget->colorTextures.empty())
+		return 0;
+	return this->renderTarget->colorTextures[0];
 }
 
 Scene* Renderer::GetScene() {
@@ -73,8 +121,26 @@ bool Renderer::IsRenderingPerMaterial() {
 	return this->renderingPerMaterial;
 }
 
+bool Renderer::IsUsingMaterialsTable() {
+	return this->usingMaterialsTable;
+}
+
+bool Renderer::IsBatchingMaterials() {
+	return this->batchingMaterials;
+}
+
+bool Renderer::IsUsingProvokingMaterials() {
+	return this->usingProvokingMaterials;
+}
+
+bool Renderer::IsPullingVertices() {
+	return this->pullingVertices;
+}
+
 void Renderer::SetClearColor(Eigen::Vector4f color) {
 	this->clearColor = color;
+	if (this->scene != nullptr)
+		this->scene->AskForRender();
 }
 
 void Renderer::SetRenderingPerMaterial(bool value) {
@@ -84,15 +150,52 @@ void Renderer::SetRenderingPerMaterial(bool value) {
 	this->InitShaders();
 }
 
+void Renderer::SetUsingMaterialsTable(bool value) {
+	if (this->usingMaterialsTable == value)
+		return;
+	this->usingMaterialsTable = value;
+	if (!this->renderingPerMaterial)
+		this->InitShaders(false);
+}
+
+void Renderer::SetBatchingMaterials(bool value) {
+	if (this->batchingMaterials == value)
+		return;
+	this->batchingMaterials = value;
+	// (Faces VBOs change too.)
+	if (this->renderingPerMaterial)
+		this->InitShaders();
+}
+
+void Renderer::SetUsingProvokingMaterials(bool value) {
+	if (this->usingProvokingMaterials == value)
+		return;
+	this->usingProvokingMaterials = value;
+	// (Vertices and faces VBOs change too.)
+	if (!this->renderingPerMaterial)
+		this->InitShaders();
+}
+
+void Renderer::SetPullingVertices(bool value) {
+	if (this->pullingVertices == value)
+		return;
+	this->pullingVertices = value;
+	// (Shaders read attributes or pull vertices depending on a uniform.)
+	if (this->scene != nullptr)
+		this->scene->UpdateVbos();
+}
+
 void Renderer::SetScene(Scene* scene) {
 	this->scene = scene;
 	this->InitScene();
 }
 
-void Renderer::ActivateContext() {
-	glBindFramebuffer(GL_FRAMEBUFFER, this->renderFboID);
-	glBindRenderbuffer(GL_RENDERBUFFER, this->renderRboID);
-	glBindTexture(GL_TEXTURE_2D, this->renderTextureID);
+void Renderer::ActivateContext(ImVec2 size) {
+	RenderTargetManager* renderTargets = this->GetRenderTargets();
+	if ((renderTargets == nullptr) || (this->renderTarget == nullptr))
+		return;
+	renderTargets->Resize(this->renderTarget, (int) size.x, (int) size.y);
+	glBindFramebuffer(GL_FRAMEBUFFER, this->renderTarget->fboID);
 }
 
 const void Renderer::DeactivateContext() {
@@ -107,6 +210,8 @@ void Renderer::InitScene() {
 	}
 }
 
+void Renderer::UpdateMaterialList() {}
+
 void Renderer::InitFullPassShaders() {}
 void Renderer::InitPerMaterialShaders() {}
 
@@ -122,44 +227,49 @@ void Renderer::CleanShaders() {
 	this->nbShaders = 0;
 }
 
+void Renderer::CompileShaders(const std::vector<ShadersReader*>& readers) {
+	// (Preprocessing only reads files, so it runs on worker threads.)
+	ParallelFor(0, readers.size(),
+			[&readers](unsigned int first, unsigned int last) {
+		for (unsigned int i = first; i < last; i++)
+			readers[i]->Preprocess();
+	});
+	for (ShadersReader* reader: readers)
+		reader->Compile();
+}
+
+void Renderer::FinishShaders() {
+	bool canWait = !IsParallelCompileSupported();
+	for (unsigned char i = 0; i < this->nbShaders; i++) {
+		if ((this->shaders[i] != nullptr) && this->shaders[i]->IsCompiling()) {
+			this->shaders[i]->Finish(canWait);
+			canWait = false;
+		}
+	}
+}
+
+void Renderer::WatchShaders() {
+	if (this->context != nullptr)
+		((Context*) this->context)->WatchShaders(this);
+}
+
 void Renderer::Init() {
-	/* Create render FBO */
-
-	// Create a frame buffer
-	glGenFramebuffers(1, &this->renderFboID);
-	glBindFramebuffer(GL_FRAMEBUFFER, this->renderFboID);
-
-	// Create a texture
-	glGenTextures(1, &this->renderTextureID);
-	glBindTexture(GL_TEXTURE_2D, this->renderTextureID);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 128, 128, 0,
-			GL_RGB, GL_UNSIGNED_BYTE, 0);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-			this->renderTextureID, 0);
-
-	// Set pool filtering to nearest (should be pixel perfect on screen)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-
-	// Create a depth buffer
-	glGenRenderbuffers(1, &this->renderRboID);
-	glBindRenderbuffer(GL_RENDERBUFFER, this->renderRboID);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, 128, 128);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-			GL_RENDERBUFFER, this->renderRboID);
-
-	GLenum drawBuffers[1] = { GL_COLOR_ATTACHMENT0 };
-	glDrawBuffers(1, drawBuffers);
-
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "Framebuffer initialization failed!" << std::endl;
-
-	// Switch back to default frame buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	// Render FBO with a color texture and a depth buffer
+	RenderTargetManager* renderTargets = this->GetRenderTargets();
+	if (renderTargets != nullptr) {
+		this->renderTarget = renderTargets->CreateTarget({ GL_RGB },
+				GL_DEPTH_COMPONENT);
+	}
 }
 
 void Renderer::Clean() {
-	glDeleteTextures(1, &this->renderTextureID);
-	glDeleteRenderbuffers(1, &this->renderRboID);
-	glDeleteFramebuffers(1, &this->renderFboID);
+	RenderTargetManager* renderTargets = this->GetRenderTargets();
+	if (renderTargets != nullptr)
+		renderTargets->DeleteTarget(this->renderTarget);
+	this->renderTarget = nullptr;
+}
+
+RenderTargetManager* Renderer::GetRenderTargets() {
+	return (this->context != nullptr)
+			? ((Context*) this->context)->GetRenderTargets() : nullptr;
 }
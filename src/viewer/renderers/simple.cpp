@@ -21,43 +21,28 @@ SimpleRenderer::~SimpleRenderer() {
 }
 
 void SimpleRenderer::Render(ImVec2 size) {
-	this->ActivateContext();
-
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, size.x, size.y, 0,
-			GL_RGB, GL_UNSIGNED_BYTE, 0);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, size.x, size.y);
+	// (Attachments are only reallocated when the size changes.)
+	this->ActivateContext(size);
 
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_PROGRAM_POINT_SIZE);
 
 	glViewport(0, 0, size.x, size.y);
 	this->scene->UpdateCameraViewport(size);
+	this->scene->UpdateFrameConstants();
+	this->scene->CullMesh();
 
 	glClearColor(this->clearColor[0], this->clearColor[1], this->clearColor[2],
 			this->clearColor[3]);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	// (Shaders being reloaded are replaced once linked.)
+	this->FinishShaders();
 	for (unsigned char i = 0; i < this->nbShaders; i++) {
-		if (this->shaders[i] == nullptr)
+		if ((this->shaders[i] == nullptr) || !this->shaders[i]->AreLoaded())
 			continue;
 		this->shaders[i]->Activate();
 
-		glUniformMatrix4fv(
-				this->shaders[i]->GetUniformLocation("projection_matrix"), 1, false,
-				this->scene->GetCamera()->ComputeProjectionMatrix().data());
-		glUniformMatrix4fv(this->shaders[i]->GetUniformLocation("model_matrix"), 1,
-				false, this->scene->GetMeshTransformationMatrix().data());
-		glUniformMatrix3fv(this->shaders[i]->GetUniformLocation("normal_matrix"), 1,
-				false, this->scene->GetNormalMatrix().data());
-		if (this->scene->navigate3D) {
-			glUniformMatrix4fv(this->shaders[i]->GetUniformLocation("view_matrix"),
-					1, false,
-					this->scene->GetCamera()->Compute3DViewMatrix().data());
-		} else {
-			glUniformMatrix4fv(this->shaders[i]->GetUniformLocation("view_matrix"),
-					1, false, this->scene->GetCamera()->ComputeViewMatrix().data());
-		}
-
 		this->scene->RenderMesh(this->shaders[i], i);
 
 		this->shaders[i]->Deactivate();
@@ -66,8 +51,8 @@ void SimpleRenderer::Render(ImVec2 size) {
 	this->DeactivateContext();
 }
 
-void SimpleRenderer::UpdateDirectionalLightList(bool reload) {}
-void SimpleRenderer::UpdatePointLightList(bool reload) {}
+void SimpleRenderer::UpdateDirectionalLightList() {}
+void SimpleRenderer::UpdatePointLightList() {}
 
 void SimpleRenderer::InitFullPassShaders() {
 	this->CleanShaders();
@@ -88,6 +73,12 @@ void SimpleRenderer::InitPerMaterialShaders() {
 	if (mesh == nullptr)
 		return;
 
+	// Batched materials are all drawn by the one-pass program
+	if (this->batchingMaterials) {
+		this->InitFullPassShaders();
+		return;
+	}
+
 	this->CleanShaders();
 
 	this->nbShaders = this->scene->GetMesh()->nbMaterials;
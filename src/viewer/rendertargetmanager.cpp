@@ -0,0 +1,233 @@
+#include "rendertargetmanager.h"
+
+#include <algorithm>
+#include <iostream>
+
+static bool IsDepthFormat(GLenum format) {
+	return (format == GL_DEPTH_COMPONENT) || (format == GL_DEPTH_COMPONENT16)
+			|| (format == GL_DEPTH_COMPONENT24)
+			|| (format == GL_DEPTH_COMPONENT32F);
+}
+
+static size_t GetBytesPerPixel(GLenum format) {
+	switch (format) {
+		case GL_DEPTH_COMPONENT16:
+			return 2;
+		case GL_RGBA16F:
+			return 8;
+		case GL_RGBA32F:
+			return 16;
+		default:
+			// (Drivers pad RGB and 24 bits depth formats to 4 bytes.)
+			return 4;
+	}
+}
+
+RenderTargetManager::RenderTargetManager() {}
+
+RenderTargetManager::~RenderTargetManager() {
+	for (RenderTarget& target: this->targets)
+		glDeleteFramebuffers(1, &target.fboID);
+	for (RenderAttachment& attachment: this->attachments) {
+		if (attachment.isTexture)
+			glDeleteTextures(1, &attachment.id);
+		else
+			glDeleteRenderbuffers(1, &attachment.id);
+	}
+}
+
+RenderTarget* RenderTargetManager::CreateTarget(
+		const std::vector<GLenum>& colorFormats, GLenum depthFormat) {
+	this->targets.emplace_back();
+	RenderTarget* target = &this->targets.back();
+	target->colorFormats = colorFormats;
+	target->depthFormat = depthFormat;
+
+	glGenFramebuffers(1, &target->fboID);
+	glBindFramebuffer(GL_FRAMEBUFFER, target->fboID);
+	std::vector<GLenum> drawBuffers;
+	for (size_t i = 0; i < colorFormats.size(); i++)
+		drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + (unsigned int) i);
+	glDrawBuffers((GLsizei) drawBuffers.size(), drawBuffers.data());
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return target;
+}
+
+void RenderTargetManager::DeleteTarget(RenderTarget* target) {
+	if (target == nullptr)
+		return;
+	this->ReleaseAttachments(target);
+	glDeleteFramebuffers(1, &target->fboID);
+	this->targets.remove_if([target](const RenderTarget& other) {
+		return &other == target;
+	});
+}
+
+bool RenderTargetManager::Resize(RenderTarget* target, int width,
+		int height) {
+	// (An empty viewport keeps a complete framebuffer.)
+	width = std::max(width, 1);
+	height = std::max(height, 1);
+	if ((target == nullptr)
+			|| ((target->width == width) && (target->height == height)))
+		return false;
+	this->ReleaseAttachments(target);
+	target->width = width;
+	target->height = height;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, target->fboID);
+	for (size_t i = 0; i < target->colorFormats.size(); i++) {
+		GLuint textureID = this->Acquire(true, target->colorFormats[i], width,
+				height);
+		target->colorTextures.push_back(textureID);
+		glFramebufferTexture(GL_FRAMEBUFFER,
+				GL_COLOR_ATTACHMENT0 + (unsigned int) i, textureID, 0);
+	}
+	if (target->depthFormat != GL_NONE) {
+		target->depthRboID = this->Acquire(false, target->depthFormat, width,
+				height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+				GL_RENDERBUFFER, target->depthRboID);
+	}
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Framebuffer initialization failed!" << std::endl;
+
+	// Switch back to default frame buffer
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	this->nbResizes++;
+	return true;
+}
+
+GLuint RenderTargetManager::Acquire(bool isTexture, GLenum format, int width,
+		int height) {
+	for (RenderAttachment& attachment: this->attachments) {
+		if (!attachment.used && (attachment.isTexture == isTexture)
+				&& (attachment.format == format)
+				&& (attachment.width == width)
+				&& (attachment.height == height)) {
+			attachment.used = true;
+			this->nbReuses++;
+			return attachment.id;
+		}
+	}
+
+	// Free attachments of another size won't be used anymore
+	auto end = std::remove_if(this->attachments.begin(),
+			this->attachments.end(),
+			[width, height](const RenderAttachment& attachment) {
+		if (attachment.used || ((attachment.width == width)
+				&& (attachment.height == height)))
+			return false;
+		if (attachment.isTexture)
+			glDeleteTextures(1, &attachment.id);
+		else
+			glDeleteRenderbuffers(1, &attachment.id);
+		return true;
+	});
+	this->attachments.erase(end, this->attachments.end());
+
+	RenderAttachment attachment;
+	attachment.isTexture = isTexture;
+	attachment.format = format;
+	attachment.width = width;
+	attachment.height = height;
+	attachment.used = true;
+	if (isTexture) {
+		glGenTextures(1, &attachment.id);
+		glBindTexture(GL_TEXTURE_2D, attachment.id);
+		// (No data is given, but the format must still match depth formats.)
+		bool depth = IsDepthFormat(format);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0,
+				depth ? GL_DEPTH_COMPONENT : GL_RGBA,
+				depth ? GL_FLOAT : GL_UNSIGNED_BYTE, 0);
+
+		// Set pool filtering to nearest (should be pixel perfect on screen)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	} else {
+		glGenRenderbuffers(1, &attachment.id);
+		glBindRenderbuffer(GL_RENDERBUFFER, attachment.id);
+		glRenderbufferStorage(GL_RENDERBUFFER, format, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	}
+	this->attachments.push_back(attachment);
+	this->nbAllocations++;
+	return attachment.id;
+}
+
+void RenderTargetManager::Release(bool isTexture, GLuint id) {
+	for (RenderAttachment& attachment: this->attachments) {
+		if ((attachment.isTexture == isTexture) && (attachment.id == id)) {
+			attachment.used = false;
+			return;
+		}
+	}
+}
+
+void RenderTargetManager::Clear() {
+	auto end = std::remove_if(this->attachments.begin(),
+			this->attachments.end(),
+			[](const RenderAttachment& attachment) {
+		if (attachment.used)
+			return false;
+		if (attachment.isTexture)
+			glDeleteTextures(1, &attachment.id);
+		else
+			glDeleteRenderbuffers(1, &attachment.id);
+		return true;
+	});
+	this->attachments.erase(end, this->attachments.end());
+}
+
+void RenderTargetManager::ResetStatistics() {
+	this->nbAllocations = 0;
+	this->nbReuses = 0;
+	this->nbResizes = 0;
+}
+
+unsigned int RenderTargetManager::GetNbTargets() const {
+	return (unsigned int) this->targets.size();
+}
+
+unsigned int RenderTargetManager::GetNbAttachments() const {
+	return (unsigned int) this->attachments.size();
+}
+
+unsigned int RenderTargetManager::GetNbUsedAttachments() const {
+	return (unsigned int) std::count_if(this->attachments.begin(),
+			this->attachments.end(), [](const RenderAttachment& attachment) {
+		return attachment.used;
+	});
+}
+
+size_t RenderTargetManager::GetMemorySize() const {
+	size_t size = 0;
+	for (const RenderAttachment& attachment: this->attachments) {
+		size += GetBytesPerPixel(attachment.format) * (size_t) attachment.width
+				* (size_t) attachment.height;
+	}
+	return size;
+}
+
+unsigned int RenderTargetManager::GetNbAllocations() const {
+	return this->nbAllocations;
+}
+
+unsigned int RenderTargetManager::GetNbReuses() const {
+	return this->nbReuses;
+}
+
+unsigned int RenderTargetManager::GetNbResizes() const {
+	return this->nbResizes;
+}
+
+void RenderTargetManager::ReleaseAttachments(RenderTarget* target) {
+	for (GLuint textureID: target->colorTextures)
+		this->Release(true, textureID);
+	target->colorTextures.clear();
+	if (target->depthRboID != 0)
+		this->Release(false, target->depthRboID);
+	target->depthRboID = 0;
+}
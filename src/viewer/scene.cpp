@@ -1,7 +1,52 @@
 #include "scene.h"
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+
 #include "renderers/renderer.h"
 
+// Indirect draw command of `glMultiDrawElementsIndirect()`
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+static bool IsMultiDrawIndirectSupported() {
+	static bool checked = false;
+	static bool supported = false;
+	if (checked)
+		return supported;
+	checked = true;
+
+	// (Core since OpenGL 4.3, with base instances since 4.2.)
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	supported = (major > 4) || ((major == 4) && (minor >= 3));
+
+	return supported;
+}
+
+static void UploadDuplicatedVertices(size_t offset, const void* data,
+		size_t stride, const std::vector<unsigned int>& duplicatedVertices) {
+	if (duplicatedVertices.empty())
+		return;
+
+	// Gather the copies, then upload them after the other vertices
+	std::vector<unsigned char> copies(stride * duplicatedVertices.size());
+	for (size_t i = 0; i < duplicatedVertices.size(); i++) {
+		memcpy(copies.data() + (stride * i), ((const unsigned char*) data)
+				+ (stride * duplicatedVertices[i]), stride);
+	}
+	glBufferSubData(GL_ARRAY_BUFFER, offset, copies.size(), copies.data());
+}
+
 Scene::Scene()
 		: camera(new Camera()) {
 	this->AddDirectionalLight(
@@ -30,6 +75,64 @@ Scene::~Scene() {
 	this->Clean();
 }
 
+void Scene::CullMesh() {
+	// (A new frame starts with culling.)
+	this->drawTime = 0.;
+	this->nbDrawCalls = 0;
+	this->clusterCullingIsValid = false;
+	if (!this->clusterCulling)
+		return;
+	// (Batched materials are drawn as a whole.)
+	if (!this->materialsDrawsIDs.empty())
+		return;
+	if ((this->clusterCuller == nullptr) || (this->camera == nullptr)
+			|| (this->renderer == nullptr))
+		return;
+
+	// Only skip the faces OpenGL would cull
+	GLenum culledFaces = GL_NONE;
+	if (glIsEnabled(GL_CULL_FACE) == GL_TRUE) {
+		GLint mode;
+		glGetIntegerv(GL_CULL_FACE_MODE, &mode);
+		culledFaces = (GLenum) mode;
+	}
+
+	// (Matrices were already computed for this frame.)
+	this->clusterCullingIsValid = this->clusterCuller->Cull(
+			this->meshTransformationMatrix,
+			Eigen::Map<const Eigen::Matrix4f>(this->frameConstants + FC_VIEW),
+			Eigen::Map<const Eigen::Matrix4f>(
+					this->frameConstants + FC_PROJECTION),
+			this->camera->IsOrthographic(),
+			((Renderer*) this->renderer)->IsRenderingPerMaterial(),
+			culledFaces);
+}
+
+bool Scene::PickMesh(const Eigen::Vector2f& position, RayHit& hit) {
+	if ((this->mesh == nullptr) || (this->camera == nullptr))
+		return false;
+
+	// Unproject the position on the near and far planes, in the mesh’s space
+	Eigen::Matrix4f inverseTransformation = (
+			this->camera->ComputeProjectionMatrix()
+			* (this->navigate3D
+					? this->camera->Compute3DViewMatrix()
+					: this->camera->ComputeViewMatrix())
+			* this->meshTransformationMatrix).inverse();
+	Eigen::Vector4f nearPoint = inverseTransformation
+			* Eigen::Vector4f(position.x(), position.y(), -1., 1.);
+	Eigen::Vector4f farPoint = inverseTransformation
+			* Eigen::Vector4f(position.x(), position.y(), 1., 1.);
+	Eigen::Vector3f origin = nearPoint.head<3>() / nearPoint.w();
+	Eigen::Vector3f direction = (farPoint.head<3>() / farPoint.w()) - origin;
+
+	float length = direction.norm();
+	if (length <= 0.)
+		return false;
+	return this->mesh->GetBVH()->Intersect(origin, direction / length, hit,
+			length);
+}
+
 bool Scene::RenderMesh(ShadersReader* shaders, unsigned char material) {
 	if (this->mesh == nullptr)
 		return false;
@@ -40,52 +143,189 @@ bool Scene::RenderMesh(ShadersReader* shaders, unsigned char material) {
 	if (this->vboFacesNbElements[material] == 0)
 		return false;
 
+	auto start = std::chrono::steady_clock::now();
+
+	if (this->pullingVertices) {
+		this->SetMeshUniforms(shaders);
+		this->DrawPulledVertices(material);
+		this->drawTime += std::chrono::duration<float, std::milli>(
+				std::chrono::steady_clock::now() - start).count();
+		return true;
+	}
+
+	// Attributes and the materials buffer are already set, only the faces
+	// change between VBOs
 	glBindVertexArray(this->vaoID);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vboFacesID[material]);
-	glBindBuffer(GL_ARRAY_BUFFER, this->vboVerticesID);
+	this->SetMeshUniforms(shaders);
+
+	// 16-bit indices are relative to the base vertex of the VBO or of each
+	// chunk
+	GLenum indicesType = this->vboFacesTypes[material];
+	if (!this->materialsDrawsIDs.empty()) {
+		// Draw all materials at once, each draw giving its material to the
+		// vertex shader
+		if (this->indirectMaterialsDrawsID != 0) {
+			glBindBuffer(gl::GL_DRAW_INDIRECT_BUFFER,
+					this->indirectMaterialsDrawsID);
+			gl::glMultiDrawElementsIndirect(GL_TRIANGLES, indicesType,
+					nullptr, (GLsizei) this->materialsDrawsIDs.size(), 0);
+			glBindBuffer(gl::GL_DRAW_INDIRECT_BUFFER, 0);
+			this->nbDrawCalls++;
+		} else {
+			// (Without indirect draws, the material is a constant attribute
+			// set before each draw, still without changing program.)
+			ClusterDrawList& draws = this->materialsDraws;
+			for (size_t d = 0; d < this->materialsDrawsIDs.size(); d++) {
+				glVertexAttribI1ui(SAL_VTX_MATERIAL,
+						this->materialsDrawsIDs[d]);
+				glDrawElementsBaseVertex(GL_TRIANGLES, draws.counts[d],
+						indicesType, draws.offsets[d],
+						draws.baseVertices[d]);
+			}
+			this->nbDrawCalls += this->materialsDrawsIDs.size();
+		}
 
-	int vertexLocation = shaders->GetAttribLocation("vtx_position");
-	if (vertexLocation >= 0) {
-		glVertexAttribPointer(vertexLocation, 3, GL_FLOAT, GL_FALSE,
-				sizeof(Vertex), ((void*) 0));
-		glEnableVertexAttribArray(vertexLocation);
+		glBindVertexArray(0);
+		this->drawTime += std::chrono::duration<float, std::milli>(
+				std::chrono::steady_clock::now() - start).count();
+		return true;
 	}
 
-	int colorLocation = shaders->GetAttribLocation("vtx_color");
-	if (colorLocation >= 0) {
-		glVertexAttribPointer(colorLocation, 3, GL_FLOAT, GL_FALSE,
-				sizeof(Vertex), ((void*) sizeof(Eigen::Vector3f)));
-		glEnableVertexAttribArray(colorLocation);
+	ClusterDrawList* drawList = nullptr;
+	if (this->clusterCullingIsValid)
+		drawList = this->clusterCuller->GetDrawList(material);
+	if ((drawList == nullptr)
+			&& !this->vboFacesChunks[material].counts.empty())
+		drawList = &this->vboFacesChunks[material];
+	if (drawList != nullptr) {
+		// Only draw visible clusters (or all chunks)
+		if (!drawList->counts.empty()) {
+			glMultiDrawElementsBaseVertex(GL_TRIANGLES,
+					drawList->counts.data(), indicesType,
+					drawList->offsets.data(),
+					(GLsizei) drawList->counts.size(),
+					drawList->baseVertices.data());
+			this->nbDrawCalls++;
+		}
+	} else {
+		glDrawElementsBaseVertex(GL_TRIANGLES,
+				(3 * this->vboFacesNbElements[material]), indicesType, 0,
+				this->vboFacesBaseVertices[material]);
+		this->nbDrawCalls++;
 	}
 
-	int normalLocation = shaders->GetAttribLocation("vtx_normal");
-	if (normalLocation >= 0) {
-		glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE,
-				sizeof(Vertex), ((void*) (2 * sizeof(Eigen::Vector3f))));
-		glEnableVertexAttribArray(normalLocation);
-	}
+	glBindVertexArray(0);
 
-	int materialTexLocation = shaders->GetUniformLocation("face_material");
-	if (materialTexLocation >= 0) {
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_BUFFER, this->tboMaterialsTex);
-		glTexBuffer(GL_TEXTURE_BUFFER, GL_R8UI, this->tboMaterialsID);
-		glUniform1i(materialTexLocation, 0);
+	this->drawTime += std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+
+	return true;
+}
+
+void Scene::SetMeshUniforms(ShadersReader* shaders) {
+	// Compact vertices are decoded by the vertex shader
+	CompactVertices* compact = this->compactVertices;
+	int positionOffsetLocation =
+			shaders->GetUniformLocation(SU_VTX_POSITION_OFFSET);
+	if (positionOffsetLocation >= 0) {
+		glUniform3fv(positionOffsetLocation, 1, (compact != nullptr)
+				? compact->GetPositionOffset().data()
+				: Eigen::Vector3f::Zero().eval().data());
 	}
+	int positionScaleLocation =
+			shaders->GetUniformLocation(SU_VTX_POSITION_SCALE);
+	if (positionScaleLocation >= 0) {
+		glUniform3fv(positionScaleLocation, 1, (compact != nullptr)
+				? compact->GetPositionScale().data()
+				: Eigen::Vector3f::Ones().eval().data());
+	}
+	int octahedralLocation = shaders->GetUniformLocation(SU_VTX_OCTAHEDRAL);
+	if (octahedralLocation >= 0)
+		glUniform1i(octahedralLocation, (compact != nullptr));
+
+	int materialTexLocation = shaders->GetUniformLocation(SU_FACE_MATERIAL);
+	if (materialTexLocation >= 0)
+		glUniform1i(materialTexLocation, STU_FACE_MATERIAL);
+
+	// Pulled vertices are decoded from their words, whatever their layout
+	// (Samplers are always set, so that unused ones don't share the unit of
+	// another type.)
+	glUniform1i(shaders->GetUniformLocation(SU_VTX_PULLING),
+			this->pullingVertices);
+	glUniform1i(shaders->GetUniformLocation(SU_VTX_INDICES), STU_VTX_INDICES);
+	glUniform1i(shaders->GetUniformLocation(SU_VTX_VERTICES),
+			STU_VTX_VERTICES);
+	glUniform1i(shaders->GetUniformLocation(SU_VTX_MATERIALS),
+			STU_VTX_MATERIALS);
+	if (!this->pullingVertices)
+		return;
 
-	glDrawElements(GL_TRIANGLES, (3 * this->vboFacesNbElements[material]),
-			GL_UNSIGNED_INT, 0);
+	GLint vectorWords = sizeof(Eigen::Vector3f) / sizeof(GLuint);
+	GLint stride, offsets[3];
+	if (compact != nullptr) {
+		stride = compact->GetStride() / sizeof(GLuint);
+		offsets[0] = 0;
+		offsets[1] = compact->GetNormalOffset() / sizeof(GLuint);
+		offsets[2] = compact->HaveColors()
+				? (GLint) (compact->GetColorOffset() / sizeof(GLuint)) : -1;
+	} else if (this->mesh->IsSoA()) {
+		GLint streamWords = vectorWords * this->GetNbVboVertices();
+		stride = vectorWords;
+		offsets[0] = 0;
+		offsets[1] = streamWords;
+		offsets[2] = (this->mesh->GetColors() != nullptr)
+				? (2 * streamWords) : -1;
+	} else {
+		stride = sizeof(Vertex) / sizeof(GLuint);
+		offsets[0] = 0;
+		offsets[1] = 2 * vectorWords;
+		offsets[2] = vectorWords;
+	}
+	glUniform1i(shaders->GetUniformLocation(SU_VTX_STRIDE), stride);
+	glUniform3iv(shaders->GetUniformLocation(SU_VTX_OFFSETS), 1, offsets);
+	glUniform3fv(shaders->GetUniformLocation(SU_VTX_DEFAULT_COLOR), 1,
+			this->mesh->GetColor(0).data());
+}
 
-	if (vertexLocation >= 0)
-		glDisableVertexAttribArray(vertexLocation);
-	if (colorLocation >= 0)
-		glDisableVertexAttribArray(colorLocation);
-	if (normalLocation >= 0)
-		glDisableVertexAttribArray(normalLocation);
+void Scene::DrawPulledVertices(unsigned char material) {
+	// No attribute is read, each vertex of the draws is an index
+	glBindVertexArray(this->vaoPullingID);
+	glActiveTexture(GL_TEXTURE0 + STU_VTX_INDICES);
+	glBindTexture(GL_TEXTURE_BUFFER, this->tboPulledIndicesTex);
+	glActiveTexture(GL_TEXTURE0 + STU_VTX_VERTICES);
+	glBindTexture(GL_TEXTURE_BUFFER, this->tboPulledVerticesTex);
+	glActiveTexture(GL_TEXTURE0 + STU_VTX_MATERIALS);
+	glBindTexture(GL_TEXTURE_BUFFER, this->tboPulledMaterialsTex);
+	glActiveTexture(GL_TEXTURE0);
+
+	GLint first = 3 * (GLint) this->vboFacesFirstFace[material];
+	ClusterDrawList* drawList = nullptr;
+	if (this->clusterCullingIsValid)
+		drawList = this->clusterCuller->GetDrawList(material);
+	if (drawList != nullptr) {
+		// Visible clusters are ranges of the face VBO, whose faces are in
+		// the same order in the indices buffer
+		size_t indexSize = (this->vboFacesTypes[material] == GL_UNSIGNED_SHORT)
+				? sizeof(GLushort) : sizeof(GLuint);
+		this->pulledDrawsFirsts.resize(drawList->counts.size());
+		for (size_t k = 0; k < drawList->counts.size(); k++) {
+			this->pulledDrawsFirsts[k] = first
+					+ (GLint) ((size_t) drawList->offsets[k] / indexSize);
+		}
+		if (!drawList->counts.empty()) {
+			glMultiDrawArrays(GL_TRIANGLES, this->pulledDrawsFirsts.data(),
+					drawList->counts.data(),
+					(GLsizei) drawList->counts.size());
+			this->nbDrawCalls++;
+		}
+	} else {
+		glDrawArrays(GL_TRIANGLES, first,
+				(3 * this->vboFacesNbElements[material]));
+		this->nbDrawCalls++;
+	}
 
 	glBindVertexArray(0);
-
-	return true;
 }
 
 void Scene::UpdateCameraViewport(ImVec2 size) {
@@ -96,18 +336,111 @@ void Scene::UpdateCameraViewport(ImVec2 size) {
 	}
 }
 
+void Scene::UpdateFrameConstants() {
+	// (The frame about to be rendered takes all changes into account.)
+	this->needsRender = false;
+	if ((this->camera == nullptr) || (this->uboFrameID == 0))
+		return;
+
+	// Camera matrices are cheap, but only uploaded if they changed
+	bool changed = false;
+	Eigen::Matrix4f projection = this->camera->ComputeProjectionMatrix();
+	Eigen::Matrix4f view = (this->navigate3D
+			? this->camera->Compute3DViewMatrix()
+			: this->camera->ComputeViewMatrix());
+	if (memcmp(this->frameConstants + FC_PROJECTION, projection.data(),
+			sizeof(Eigen::Matrix4f))) {
+		memcpy(this->frameConstants + FC_PROJECTION, projection.data(),
+				sizeof(Eigen::Matrix4f));
+		changed = true;
+	}
+	if (memcmp(this->frameConstants + FC_VIEW, view.data(),
+			sizeof(Eigen::Matrix4f))) {
+		memcpy(this->frameConstants + FC_VIEW, view.data(),
+				sizeof(Eigen::Matrix4f));
+		changed = true;
+	}
+
+	// The normal matrix needs an inverse, so only compute it when the mesh
+	// moves
+	// (In std140, each column of a 3x3 matrix takes 4 floats.)
+	if (this->modelIsDirty) {
+		memcpy(this->frameConstants + FC_MODEL,
+				this->meshTransformationMatrix.data(),
+				sizeof(Eigen::Matrix4f));
+		Eigen::Matrix3f normalMatrix = this->GetNormalMatrix();
+		for (unsigned int c = 0; c < 3; c++) {
+			memcpy(this->frameConstants + FC_NORMAL + (4 * c),
+					normalMatrix.col(c).data(), 3 * sizeof(float));
+			this->frameConstants[FC_NORMAL + (4 * c) + 3] = 0.;
+		}
+		this->modelIsDirty = false;
+		changed = true;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, this->uboFrameID);
+	if (changed) {
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(this->frameConstants),
+				this->frameConstants);
+	}
+	glBindBufferBase(GL_UNIFORM_BUFFER, SUB_FRAME_CONSTANTS,
+			this->uboFrameID);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
 void Scene::UpdateVbos() {
 	this->InitVbos();
 }
 
+void Scene::AskForRender() {
+	this->needsRender = true;
+}
+
+bool Scene::NeedsRender() {
+	if (this->needsRender || this->modelIsDirty)
+		return true;
+	if ((this->camera == nullptr) || (this->uboFrameID == 0))
+		return false;
+
+	// (The camera is moved from many places, so its matrices are compared to
+	// the ones of the last render.)
+	Eigen::Matrix4f projection = this->camera->ComputeProjectionMatrix();
+	Eigen::Matrix4f view = (this->navigate3D
+			? this->camera->Compute3DViewMatrix()
+			: this->camera->ComputeViewMatrix());
+	return memcmp(this->frameConstants + FC_PROJECTION, projection.data(),
+			sizeof(Eigen::Matrix4f))
+			|| memcmp(this->frameConstants + FC_VIEW, view.data(),
+					sizeof(Eigen::Matrix4f));
+}
+
+void Scene::BeginUpdate() {
+	this->updateDepth++;
+}
+
+void Scene::EndUpdate() {
+	if (this->updateDepth == 0)
+		return;
+	if (--this->updateDepth)
+		return;
+
+	// Apply all changes made since the first call to `BeginUpdate()` at once
+	bool directionalLights = this->directionalLightsChanged;
+	bool pointLights = this->pointLightsChanged;
+	bool materials = this->materialsChanged;
+	this->directionalLightsChanged = false;
+	this->pointLightsChanged = false;
+	this->materialsChanged = false;
+	this->UpdateRenderer(directionalLights, pointLights, materials);
+}
+
 void Scene::AddDirectionalLight(DirectionalLight* light) {
 	if (light == nullptr)
 		return;
 
 	this->directionalLights.push_back(light);
 
-	if (this->renderer != nullptr)
-		((Renderer*) this->renderer)->UpdateDirectionalLightList();
+	this->UpdateRenderer(true, false, false);
 }
 
 void Scene::AddPointLight(PointLight *light){
@@ -116,8 +449,7 @@ void Scene::AddPointLight(PointLight *light){
 
 	this->pointLights.push_back(light);
 
-	if (this->renderer != nullptr)
-		((Renderer *)this->renderer)->UpdatePointLightList();
+	this->UpdateRenderer(false, true, false);
  }
 
 
@@ -136,8 +468,33 @@ void Scene::AddRandomPointLight(PointLight *light) {
 	position[2] = 20 * sin(latitude);
 	light->SetPosition(position);
 	this->pointLights.push_back(light);
-	if (this->renderer != nullptr)
-		((Renderer *)this->renderer)->UpdatePointLightList();
+	this->UpdateRenderer(false, true, false);
+}
+
+bool Scene::RemoveDirectionalLight(DirectionalLight* light) {
+	auto position = std::find(this->directionalLights.begin(),
+			this->directionalLights.end(), light);
+	if (position == this->directionalLights.end())
+		return false;
+
+	this->directionalLights.erase(position);
+	delete light;
+
+	this->UpdateRenderer(true, false, false);
+	return true;
+}
+
+bool Scene::RemovePointLight(PointLight* light) {
+	auto position = std::find(this->pointLights.begin(),
+			this->pointLights.end(), light);
+	if (position == this->pointLights.end())
+		return false;
+
+	this->pointLights.erase(position);
+	delete light;
+
+	this->UpdateRenderer(false, true, false);
+	return true;
 }
 
 
@@ -157,10 +514,43 @@ std::vector<PointLight*>* Scene::GetPointLights() {
 	return &this->pointLights;
 }
 
+ProvokingMaterials* Scene::GetProvokingMaterials() {
+	return this->provokingMaterials;
+}
+
 MaterialList* Scene::GetMaterialsPaths() {
 	return this->materialsPaths;
 }
 
+ClusterCuller* Scene::GetClusterCuller() {
+	return this->clusterCuller;
+}
+
+CompactVertices* Scene::GetCompactVertices() {
+	return this->compactVertices;
+}
+
+size_t Scene::GetFacesVbosMemorySize() {
+	return this->vboFacesMemorySize;
+}
+
+unsigned char Scene::GetNbShortFacesVbos() {
+	return (unsigned char) std::count(this->vboFacesTypes.begin(),
+			this->vboFacesTypes.end(), GL_UNSIGNED_SHORT);
+}
+
+unsigned char Scene::GetNbVboFaces() {
+	return this->nbVboFaces;
+}
+
+float Scene::GetDrawTime() {
+	return this->drawTime;
+}
+
+unsigned int Scene::GetNbDrawCalls() {
+	return this->nbDrawCalls;
+}
+
 Mesh* Scene::GetMesh() {
 	return this->mesh;
 }
@@ -178,12 +568,40 @@ void Scene::SetCamera(Camera* camera) {
 	if (this->camera != nullptr)
 		delete this->camera;
 	this->camera = camera;
+	this->needsRender = true;
+}
+
+bool Scene::IsClusterCullingEnabled() {
+	return this->clusterCulling;
+}
+
+bool Scene::IsCompactVerticesEnabled() {
+	return this->compactVerticesEnabled;
+}
+
+bool Scene::IsPullingVertices() {
+	return this->pullingVertices;
+}
+
+void Scene::SetClusterCulling(bool enabled) {
+	this->clusterCulling = enabled;
+	this->needsRender = true;
+	if (!enabled)
+		this->clusterCullingIsValid = false;
+}
+
+void Scene::SetCompactVertices(bool enabled) {
+	if (this->compactVerticesEnabled == enabled)
+		return;
+	this->compactVerticesEnabled = enabled;
+	this->needsRender = true;
+	if (this->mesh != nullptr)
+		this->InitVerticesVbo();
 }
 
 void Scene::SetMaterialsPaths(MaterialList* materialsPaths) {
 	this->materialsPaths = materialsPaths;
-	if (this->renderer != nullptr)
-		((Renderer*) this->renderer)->InitShaders(false);
+	this->UpdateRenderer(false, false, true);
 }
 
 void Scene::SetMesh(Mesh* mesh) {
@@ -196,6 +614,7 @@ void Scene::SetMesh(Mesh* mesh) {
 
 void Scene::SetMeshTransformationMatrix(Eigen::Matrix4f transformationMatrix) {
 	this->meshTransformationMatrix = transformationMatrix;
+	this->modelIsDirty = true;
 }
 
 void Scene::SetRenderer(void* renderer) {
@@ -207,14 +626,10 @@ void Scene::Init() {
 	glGenVertexArrays(1, &this->vaoID);
 	glGenBuffers(1, &this->vboVerticesID);
 
-	glBindVertexArray(this->vaoID);
-
-	glBindBuffer(GL_ARRAY_BUFFER, this->vboVerticesID);
-	glBufferData(GL_ARRAY_BUFFER,
-			(sizeof(struct Vertex) * this->mesh->nbVertices),
-			this->mesh->verticesData[0].position.data(), GL_STATIC_DRAW);
+	this->InitVerticesVbo();
 
-	glBindVertexArray(0);
+	this->clusterCuller = new ClusterCuller(this->mesh);
+	this->clusterCullingIsValid = false;
 
 	this->camera = new Camera();
 	this->camera->SetSceneCenter(this->mesh->GetBoundingBox().center());
@@ -231,25 +646,194 @@ void Scene::Init() {
 			this->mesh->facesMaterials, GL_STATIC_DRAW);
 	glGenTextures(1, &this->tboMaterialsTex);
 
+	glGenBuffers(1, &this->uboFrameID);
+	glBindBuffer(GL_UNIFORM_BUFFER, this->uboFrameID);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(this->frameConstants), nullptr,
+			GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	memset(this->frameConstants, 0, sizeof(this->frameConstants));
+	this->modelIsDirty = true;
+
+	// Bind the materials once (no other buffer texture is used)
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_BUFFER, this->tboMaterialsTex);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R8UI, this->tboMaterialsID);
+
 	glBindBuffer(GL_TEXTURE_BUFFER, 0);
 }
 
 void Scene::InitVbos(bool force) {
+	this->needsRender = true;
 	if (this->mesh == nullptr)
 		return;
 	if (this->renderer == nullptr)
 		return;
 
-	bool renderingPerMaterial =
-			((Renderer*) this->renderer)->IsRenderingPerMaterial();
+	// (Batched materials are ranges of the single face VBO.)
+	Renderer* renderer = (Renderer*) this->renderer;
+	bool batchingMaterials = renderer->IsRenderingPerMaterial()
+			&& renderer->IsBatchingMaterials();
+	bool renderingPerMaterial = renderer->IsRenderingPerMaterial()
+			&& !batchingMaterials;
 	int expectedNbVbos = (renderingPerMaterial ? this->mesh->nbMaterials : 1);
-	if ((this->nbVboFaces == expectedNbVbos) && (!force))
-		return;
+	bool pullingVertices = renderer->IsPullingVertices() && !batchingMaterials;
+
+	// (Only the one-pass approach reads the materials from the vertices, and
+	// their faces are rotated.)
+	bool provokingMaterials = !renderer->IsRenderingPerMaterial()
+			&& renderer->IsUsingProvokingMaterials();
+	if (provokingMaterials != (this->provokingMaterials != nullptr)) {
+		this->InitProvokingMaterials(provokingMaterials);
+		force = true;
+	}
+	bool initFacesVbos = (this->nbVboFaces != expectedNbVbos) || force;
+	if (initFacesVbos) {
+		if (expectedNbVbos == 1)
+			this->InitAllFaceVbo();
+		else
+			this->InitPerMaterialVbos();
+	}
+	this->InitMaterialsDraws(batchingMaterials);
 
-	if (expectedNbVbos == 1)
-		this->InitAllFaceVbo();
-	else
-		this->InitPerMaterialVbos();
+	// (Batched draws need the attributes and the faces VBOs.)
+	if ((pullingVertices != this->pullingVertices)
+			|| (pullingVertices && initFacesVbos))
+		this->InitPulledVertices(pullingVertices);
+}
+
+void Scene::InitVerticesVbo() {
+	if (this->compactVertices != nullptr) {
+		delete this->compactVertices;
+		this->compactVertices = nullptr;
+	}
+
+	glBindVertexArray(this->vaoID);
+	glBindBuffer(GL_ARRAY_BUFFER, this->vboVerticesID);
+
+	// Vertices copied for the materials of the faces follow the others (in
+	// each attribute array)
+	std::vector<unsigned int> noDuplicatedVertices;
+	const std::vector<unsigned int>& duplicatedVertices =
+			(this->provokingMaterials != nullptr)
+			? this->provokingMaterials->GetDuplicatedVertices()
+			: noDuplicatedVertices;
+	size_t nbVboVertices = this->GetNbVboVertices();
+
+	if (this->compactVerticesEnabled) {
+		// Upload the packed vertices, then only keep their layout
+		this->compactVertices = new CompactVertices(this->mesh);
+		size_t stride = this->compactVertices->GetStride();
+		glBufferData(GL_ARRAY_BUFFER, (stride * nbVboVertices), nullptr,
+				GL_STATIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, this->compactVertices->GetSize(),
+				this->compactVertices->GetData());
+		UploadDuplicatedVertices(this->compactVertices->GetSize(),
+				this->compactVertices->GetData(), stride, duplicatedVertices);
+		this->compactVertices->ReleaseData();
+	} else if (this->mesh->IsSoA()) {
+		// Upload each attribute after the other, colors only if stored
+		const Eigen::Vector3f* streams[3] = { this->mesh->GetPositions(),
+				this->mesh->GetNormals(), this->mesh->GetColors() };
+		unsigned int nbStreams = (streams[2] != nullptr) ? 3 : 2;
+		size_t meshStreamSize =
+				sizeof(Eigen::Vector3f) * this->mesh->nbVertices;
+		size_t streamSize = sizeof(Eigen::Vector3f) * nbVboVertices;
+		glBufferData(GL_ARRAY_BUFFER, (nbStreams * streamSize), nullptr,
+				GL_STATIC_DRAW);
+		for (unsigned int i = 0; i < nbStreams; i++) {
+			glBufferSubData(GL_ARRAY_BUFFER, (i * streamSize),
+					meshStreamSize, streams[i]);
+			UploadDuplicatedVertices((i * streamSize) + meshStreamSize,
+					streams[i], sizeof(Eigen::Vector3f), duplicatedVertices);
+		}
+	} else {
+		glBufferData(GL_ARRAY_BUFFER, (sizeof(struct Vertex) * nbVboVertices),
+				nullptr, GL_STATIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0,
+				(sizeof(struct Vertex) * this->mesh->nbVertices),
+				this->mesh->verticesData);
+		UploadDuplicatedVertices(
+				(sizeof(struct Vertex) * this->mesh->nbVertices),
+				this->mesh->verticesData, sizeof(struct Vertex),
+				duplicatedVertices);
+	}
+
+	this->InitVertexAttributes();
+
+	glBindVertexArray(0);
+}
+
+void Scene::InitVertexAttributes() {
+	// Attributes have the same locations in all programs, so the VAO is only
+	// set when the layout changes
+	// (Otherwise, attributes are either interleaved or one after the other.)
+	CompactVertices* compact = this->compactVertices;
+	bool soa = this->mesh->IsSoA();
+	size_t streamSize = sizeof(Eigen::Vector3f) * this->GetNbVboVertices();
+	GLsizei stride = soa ? sizeof(Eigen::Vector3f) : sizeof(Vertex);
+
+	if (compact != nullptr) {
+		glVertexAttribPointer(SAL_VTX_POSITION, 3, GL_UNSIGNED_SHORT, GL_TRUE,
+				compact->GetStride(), ((void*) 0));
+	} else {
+		glVertexAttribPointer(SAL_VTX_POSITION, 3, GL_FLOAT, GL_FALSE,
+				stride, ((void*) 0));
+	}
+	glEnableVertexAttribArray(SAL_VTX_POSITION);
+
+	if ((compact == nullptr) && (this->mesh->GetColors() != nullptr)) {
+		glVertexAttribPointer(SAL_VTX_COLOR, 3, GL_FLOAT, GL_FALSE,
+				stride, ((void*) (soa
+						? 2 * streamSize : sizeof(Eigen::Vector3f))));
+		glEnableVertexAttribArray(SAL_VTX_COLOR);
+	} else if ((compact != nullptr) && compact->HaveColors()) {
+		glVertexAttribPointer(SAL_VTX_COLOR, 3, GL_UNSIGNED_BYTE, GL_TRUE,
+				compact->GetStride(),
+				((void*) (size_t) compact->GetColorOffset()));
+		glEnableVertexAttribArray(SAL_VTX_COLOR);
+	} else {
+		// Colors are not stored, all vertices have the default one
+		glDisableVertexAttribArray(SAL_VTX_COLOR);
+		glVertexAttrib3fv(SAL_VTX_COLOR, this->mesh->GetColor(0).data());
+	}
+
+	if (compact != nullptr) {
+		glVertexAttribPointer(SAL_VTX_NORMAL, 2, GL_SHORT, GL_TRUE,
+				compact->GetStride(),
+				((void*) (size_t) compact->GetNormalOffset()));
+	} else {
+		glVertexAttribPointer(SAL_VTX_NORMAL, 3, GL_FLOAT, GL_FALSE,
+				stride, ((void*) (soa
+						? streamSize : 2 * sizeof(Eigen::Vector3f))));
+	}
+	glEnableVertexAttribArray(SAL_VTX_NORMAL);
+}
+
+void Scene::InitProvokingMaterials(bool enabled) {
+	if (this->provokingMaterials != nullptr) {
+		delete this->provokingMaterials;
+		this->provokingMaterials = nullptr;
+	}
+
+	if (enabled) {
+		// Computed once per mesh, the material of each vertex is then an
+		// attribute of its own
+		this->provokingMaterials = new ProvokingMaterials(this->mesh);
+		if (this->vboVerticesMaterialsID == 0)
+			glGenBuffers(1, &this->vboVerticesMaterialsID);
+		const std::vector<unsigned char>& materials =
+				this->provokingMaterials->GetVerticesMaterials();
+		glBindBuffer(GL_ARRAY_BUFFER, this->vboVerticesMaterialsID);
+		glBufferData(GL_ARRAY_BUFFER, materials.size(), materials.data(),
+				GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	} else if (this->vboVerticesMaterialsID != 0) {
+		glDeleteBuffers(1, &this->vboVerticesMaterialsID);
+		this->vboVerticesMaterialsID = 0;
+	}
+
+	// (Copies of vertices are added to the vertices VBO.)
+	this->InitVerticesVbo();
 }
 
 void Scene::InitAllFaceVbo() {
@@ -260,6 +844,7 @@ void Scene::InitAllFaceVbo() {
 	CleanVboFacesNbElements();
 	this->vboFacesNbElements = new unsigned int[1];
 	this->vboFacesNbElements[0] = this->mesh->nbFaces;
+	this->ResetFacesVbosFormats();
 
 	// Allocate the list of VBO IDs (only 1 element)
 	this->vboFacesID = (GLuint*) malloc(sizeof(GLuint));
@@ -272,12 +857,12 @@ void Scene::InitAllFaceVbo() {
 
 	// Copy the entire list of faces’ vertices in the new VBO
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vboFacesID[0]);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-			(sizeof(int) * 3 * this->mesh->nbFaces),
-			this->mesh->facesVertices, GL_STATIC_DRAW);
+	this->InitFacesVbo(0, 0, this->mesh->nbFaces);
 
 	// Return to the default VAO
 	glBindVertexArray(0);
+
+	this->UpdateClusterCullerIndexFormats();
 }
 
 void Scene::InitPerMaterialVbos() {
@@ -287,6 +872,7 @@ void Scene::InitPerMaterialVbos() {
 	// Reset the number of elements per face VBOs
 	CleanVboFacesNbElements();
 	this->vboFacesNbElements = new unsigned int[this->mesh->nbMaterials];
+	this->ResetFacesVbosFormats();
 
 	// Allocate the list of VBO IDs (one per material)
 	this->vboFacesID = (GLuint*) malloc(sizeof(GLuint) * this->nbVboFaces);
@@ -297,13 +883,13 @@ void Scene::InitPerMaterialVbos() {
 	// Generate a buffer per VBO, a VBO per material
 	glGenBuffers(this->nbVboFaces, this->vboFacesID);
 
-	// Use a dynamic pointer to navigate in faces’ vertices
-	unsigned int* pointer = this->mesh->facesVertices;
+	// Use a dynamic index to navigate in faces
+	unsigned int firstFace = 0;
 
 	// For each material
-	unsigned int nbElements;
 	for (unsigned char i = 0; i < this->nbVboFaces; i++) {
 		this->vboFacesNbElements[i] = this->mesh->nbFacesPerMaterial[i];
+		this->vboFacesFirstFace[i] = firstFace;
 
 		if (this->mesh->nbFacesPerMaterial[i] == 0) {
 			glDeleteBuffers(1, (this->vboFacesID + i));
@@ -313,24 +899,348 @@ void Scene::InitPerMaterialVbos() {
 
 		// Copy the list of its faces’ vertices in its new VBO
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->vboFacesID[i]);
-		nbElements = 3 * this->mesh->nbFacesPerMaterial[i];
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (sizeof(int) * nbElements),
-				pointer, GL_STATIC_DRAW);
+		this->InitFacesVbo(i, firstFace, this->mesh->nbFacesPerMaterial[i]);
 
-		// Update the pointer
-		pointer += nbElements;
+		// Update the index
+		firstFace += this->mesh->nbFacesPerMaterial[i];
 	}
 
 	// Return to the default VAO
 	glBindVertexArray(0);
+
+	this->UpdateClusterCullerIndexFormats();
+}
+
+void Scene::InitMaterialsDraws(bool enabled) {
+	this->materialsDraws = ClusterDrawList();
+	this->materialsDrawsIDs.clear();
+	glBindVertexArray(this->vaoID);
+	// (The divisor was only changed if indirect draws are supported.)
+	if (this->vboMaterialsDrawsID != 0)
+		gl::glVertexAttribDivisor(SAL_VTX_MATERIAL, 0);
+	if (!enabled && (this->provokingMaterials != nullptr)) {
+		// Without batches, materials may be read from the vertices instead
+		glBindBuffer(GL_ARRAY_BUFFER, this->vboVerticesMaterialsID);
+		glVertexAttribIPointer(SAL_VTX_MATERIAL, 1, GL_UNSIGNED_BYTE, 0,
+				((void*) 0));
+		glEnableVertexAttribArray(SAL_VTX_MATERIAL);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	} else {
+		glDisableVertexAttribArray(SAL_VTX_MATERIAL);
+	}
+	glBindVertexArray(0);
+	if (!enabled || (this->nbVboFaces != 1))
+		return;
+
+	// Ranges of the face VBO sharing a base vertex: its chunks, or itself
+	size_t indexSize = (this->vboFacesTypes[0] == GL_UNSIGNED_SHORT)
+			? sizeof(GLushort) : sizeof(GLuint);
+	std::vector<unsigned int> rangesFirstFace, rangesNbFaces;
+	std::vector<GLint> rangesBaseVertex;
+	const ClusterDrawList& chunks = this->vboFacesChunks[0];
+	if (chunks.counts.empty()) {
+		rangesFirstFace.push_back(0);
+		rangesNbFaces.push_back(this->mesh->nbFaces);
+		rangesBaseVertex.push_back(this->vboFacesBaseVertices[0]);
+	}
+	for (size_t k = 0; k < chunks.counts.size(); k++) {
+		rangesFirstFace.push_back((unsigned int)
+				((size_t) chunks.offsets[k] / (3 * indexSize)));
+		rangesNbFaces.push_back(chunks.counts[k] / 3);
+		rangesBaseVertex.push_back(chunks.baseVertices[k]);
+	}
+
+	// Split the faces of each material along them (faces are sorted by
+	// material), the index of each draw giving its material
+	std::vector<DrawElementsIndirectCommand> commands;
+	unsigned int firstMaterial = this->mesh->GetMaterialsRange().min()[0];
+	unsigned int materialFirstFace = 0;
+	for (unsigned char m = 0; m < this->mesh->nbMaterials; m++) {
+		unsigned int materialLastFace =
+				materialFirstFace + this->mesh->nbFacesPerMaterial[m];
+		for (size_t r = 0; r < rangesFirstFace.size(); r++) {
+			unsigned int first = std::max(materialFirstFace,
+					rangesFirstFace[r]);
+			unsigned int last = std::min(materialLastFace,
+					rangesFirstFace[r] + rangesNbFaces[r]);
+			if (first >= last)
+				continue;
+
+			DrawElementsIndirectCommand command;
+			command.count = 3 * (last - first);
+			command.instanceCount = 1;
+			command.firstIndex = 3 * first;
+			command.baseVertex = rangesBaseVertex[r];
+			command.baseInstance = (GLuint) commands.size();
+			commands.push_back(command);
+
+			this->materialsDraws.counts.push_back(command.count);
+			this->materialsDraws.offsets.push_back((const void*)
+					(indexSize * command.firstIndex));
+			this->materialsDraws.baseVertices.push_back(command.baseVertex);
+			this->materialsDrawsIDs.push_back(firstMaterial + m);
+		}
+		materialFirstFace = materialLastFace;
+	}
+	if (commands.empty() || !IsMultiDrawIndirectSupported())
+		return;
+
+	// The material of each draw is an attribute advancing once per instance,
+	// and each draw only has one instance, starting at its index
+	if (this->vboMaterialsDrawsID == 0) {
+		glGenBuffers(1, &this->vboMaterialsDrawsID);
+		glGenBuffers(1, &this->indirectMaterialsDrawsID);
+	}
+	glBindVertexArray(this->vaoID);
+	glBindBuffer(GL_ARRAY_BUFFER, this->vboMaterialsDrawsID);
+	glBufferData(GL_ARRAY_BUFFER,
+			sizeof(GLuint) * this->materialsDrawsIDs.size(),
+			this->materialsDrawsIDs.data(), GL_STATIC_DRAW);
+	glVertexAttribIPointer(SAL_VTX_MATERIAL, 1, GL_UNSIGNED_INT, 0,
+			((void*) 0));
+	gl::glVertexAttribDivisor(SAL_VTX_MATERIAL, 1);
+	glEnableVertexAttribArray(SAL_VTX_MATERIAL);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(gl::GL_DRAW_INDIRECT_BUFFER, this->indirectMaterialsDrawsID);
+	glBufferData(gl::GL_DRAW_INDIRECT_BUFFER,
+			sizeof(DrawElementsIndirectCommand) * commands.size(),
+			commands.data(), GL_STATIC_DRAW);
+	glBindBuffer(gl::GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void Scene::InitPulledVertices(bool enabled) {
+	this->pullingVertices = false;
+	if (!enabled) {
+		this->CleanPulledVertices();
+		return;
+	}
+
+	// Buffer textures have a limited number of texels (much more than the
+	// 65536 required in practice), otherwise attributes are kept
+	GLint maxTexels = 0, verticesSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	glBindBuffer(GL_ARRAY_BUFFER, this->vboVerticesID);
+	glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &verticesSize);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	size_t nbIndices = 3 * (size_t) this->mesh->nbFaces;
+	if ((nbIndices > (size_t) maxTexels)
+			|| (verticesSize / sizeof(GLuint) > (size_t) maxTexels)) {
+		this->CleanPulledVertices();
+		return;
+	}
+
+	if (this->vaoPullingID == 0) {
+		glGenVertexArrays(1, &this->vaoPullingID);
+		glGenBuffers(1, &this->tboPulledIndicesID);
+		glGenTextures(1, &this->tboPulledIndicesTex);
+		glGenTextures(1, &this->tboPulledVerticesTex);
+		glGenTextures(1, &this->tboPulledMaterialsTex);
+	}
+
+	// Faces in the same order as in the face VBOs, without relative indices
+	glBindBuffer(GL_TEXTURE_BUFFER, this->tboPulledIndicesID);
+	glBufferData(GL_TEXTURE_BUFFER, (sizeof(GLuint) * nbIndices),
+			this->GetVboFacesVertices(), GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	// Vertices are read as words from the vertices VBO (even when its data
+	// changes), as are the materials of the provoking vertices if any
+	glBindTexture(GL_TEXTURE_BUFFER, this->tboPulledIndicesTex);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, this->tboPulledIndicesID);
+	glBindTexture(GL_TEXTURE_BUFFER, this->tboPulledVerticesTex);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, this->vboVerticesID);
+	if (this->vboVerticesMaterialsID != 0) {
+		glBindTexture(GL_TEXTURE_BUFFER, this->tboPulledMaterialsTex);
+		glTexBuffer(GL_TEXTURE_BUFFER, GL_R8UI, this->vboVerticesMaterialsID);
+	}
+	// (The unit of the faces materials is restored.)
+	glBindTexture(GL_TEXTURE_BUFFER, this->tboMaterialsTex);
+
+	this->pullingVertices = true;
+}
+
+void Scene::InitFacesVbo(unsigned char vbo, unsigned int firstFace,
+		unsigned int nbFaces) {
+	const unsigned int* facesVertices = this->GetVboFacesVertices();
+	const unsigned int* indices = facesVertices + (3 * (size_t) firstFace);
+	size_t nbIndices = 3 * (size_t) nbFaces;
+	unsigned int lastFace = firstFace + nbFaces;
+
+	// Find the range of vertices used by the VBO
+	unsigned int minVertex = UINT_MAX, maxVertex = 0;
+	for (size_t i = 0; i < nbIndices; i++) {
+		minVertex = std::min(minVertex, indices[i]);
+		maxVertex = std::max(maxVertex, indices[i]);
+	}
+	bool wholeVbo = (nbIndices == 0) || (maxVertex - minVertex <= USHRT_MAX);
+
+	// Otherwise, group clusters following each other into chunks whose
+	// vertices fit in 16 bits
+	// (Clusters cover faces in order, so culled draws never straddle chunks.)
+	std::vector<unsigned int> chunksFirstFace;
+	std::vector<GLint> chunksBaseVertex;
+	unsigned int nbChunkedFaces = 0;
+	bool chunked = !wholeVbo;
+	unsigned int chunkMin = 0, chunkMax = 0;
+	for (unsigned int c = 0; chunked && (c < this->mesh->nbClusters); c++) {
+		MeshCluster& cluster = this->mesh->clusters[c];
+		if ((cluster.firstFace < firstFace) || (cluster.firstFace >= lastFace))
+			continue;
+		if (cluster.firstFace != firstFace + nbChunkedFaces) {
+			chunked = false;
+			break;
+		}
+
+		unsigned int clusterMin = UINT_MAX, clusterMax = 0;
+		for (size_t i = 3 * (size_t) cluster.firstFace;
+				i < 3 * ((size_t) cluster.firstFace + cluster.nbFaces); i++) {
+			clusterMin = std::min(clusterMin, facesVertices[i]);
+			clusterMax = std::max(clusterMax, facesVertices[i]);
+		}
+		if (clusterMax - clusterMin > USHRT_MAX) {
+			chunked = false;
+			break;
+		}
+
+		if (chunksFirstFace.empty()
+				|| (std::max(chunkMax, clusterMax)
+						- std::min(chunkMin, clusterMin) > USHRT_MAX)) {
+			chunksFirstFace.push_back(nbChunkedFaces);
+			chunksBaseVertex.push_back(0);
+			chunkMin = clusterMin;
+			chunkMax = clusterMax;
+		} else {
+			chunkMin = std::min(chunkMin, clusterMin);
+			chunkMax = std::max(chunkMax, clusterMax);
+		}
+		chunksBaseVertex.back() = chunkMin;
+		nbChunkedFaces += cluster.nbFaces;
+	}
+	chunked = chunked && (nbChunkedFaces == nbFaces);
+
+	if (!wholeVbo && !chunked) {
+		// Keep 32-bit indices
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (sizeof(GLuint) * nbIndices),
+				indices, GL_STATIC_DRAW);
+		this->vboFacesMemorySize += sizeof(GLuint) * nbIndices;
+		return;
+	}
+
+	if (wholeVbo) {
+		chunksFirstFace.assign(1, 0);
+		chunksBaseVertex.assign(1, (nbIndices == 0) ? 0 : minVertex);
+	}
+	chunksFirstFace.push_back(nbFaces);
+
+	// Store each index relatively to the base vertex of its chunk
+	std::vector<GLushort> shortIndices(nbIndices);
+	ClusterDrawList& chunks = this->vboFacesChunks[vbo];
+	for (size_t k = 0; k + 1 < chunksFirstFace.size(); k++) {
+		for (size_t i = 3 * (size_t) chunksFirstFace[k];
+				i < 3 * (size_t) chunksFirstFace[k + 1]; i++) {
+			shortIndices[i] = (GLushort) (indices[i] - chunksBaseVertex[k]);
+		}
+		if (chunked) {
+			chunks.counts.push_back(
+					3 * (chunksFirstFace[k + 1] - chunksFirstFace[k]));
+			chunks.offsets.push_back((const void*)
+					(sizeof(GLushort) * 3 * (size_t) chunksFirstFace[k]));
+			chunks.baseVertices.push_back(chunksBaseVertex[k]);
+		}
+	}
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (sizeof(GLushort) * nbIndices),
+			shortIndices.data(), GL_STATIC_DRAW);
+	this->vboFacesMemorySize += sizeof(GLushort) * nbIndices;
+	this->vboFacesTypes[vbo] = GL_UNSIGNED_SHORT;
+	this->vboFacesBaseVertices[vbo] = chunksBaseVertex[0];
+
+	// Give the base vertex of its chunk to each cluster, for culled draws
+	for (unsigned int c = 0; c < this->mesh->nbClusters; c++) {
+		MeshCluster& cluster = this->mesh->clusters[c];
+		if ((cluster.firstFace < firstFace) || (cluster.firstFace >= lastFace))
+			continue;
+		size_t k = std::upper_bound(chunksFirstFace.begin(),
+				chunksFirstFace.end(), cluster.firstFace - firstFace)
+				- chunksFirstFace.begin() - 1;
+		this->clustersBaseVertex[c] = chunksBaseVertex[k];
+	}
+}
+
+const unsigned int* Scene::GetVboFacesVertices() {
+	// (Faces are rotated if their materials are read from the vertices.)
+	if (this->provokingMaterials != nullptr)
+		return this->provokingMaterials->GetFacesVertices();
+	return this->mesh->facesVertices;
+}
+
+unsigned int Scene::GetNbVboVertices() {
+	if (this->provokingMaterials != nullptr)
+		return this->provokingMaterials->GetNbVertices();
+	return this->mesh->nbVertices;
+}
+
+void Scene::ResetFacesVbosFormats() {
+	this->vboFacesTypes.assign(this->nbVboFaces, GL_UNSIGNED_INT);
+	this->vboFacesBaseVertices.assign(this->nbVboFaces, 0);
+	this->vboFacesChunks.assign(this->nbVboFaces, ClusterDrawList());
+	this->vboFacesFirstFace.assign(this->nbVboFaces, 0);
+	this->clustersBaseVertex.assign(this->mesh->nbClusters, 0);
+	this->vboFacesMemorySize = 0;
+}
+
+void Scene::UpdateClusterCullerIndexFormats() {
+	if (this->clusterCuller == nullptr)
+		return;
+
+	std::vector<unsigned char> indexSizes;
+	for (GLenum type : this->vboFacesTypes) {
+		indexSizes.push_back((type == GL_UNSIGNED_SHORT)
+				? sizeof(GLushort) : sizeof(GLuint));
+	}
+	this->clusterCuller->SetIndexFormats(indexSizes,
+			this->clustersBaseVertex);
+	this->clusterCullingIsValid = false;
 }
 
 void Scene::Clean() {
 	glDeleteBuffers(1, &this->vboVerticesID);
+	glDeleteBuffers(1, &this->uboFrameID);
+	this->uboFrameID = 0;
 	glDeleteVertexArrays(1, &this->vaoID);
 	CleanFacesVbos();
+	if (this->vboMaterialsDrawsID != 0) {
+		glDeleteBuffers(1, &this->vboMaterialsDrawsID);
+		glDeleteBuffers(1, &this->indirectMaterialsDrawsID);
+		this->vboMaterialsDrawsID = 0;
+		this->indirectMaterialsDrawsID = 0;
+	}
+	this->materialsDraws = ClusterDrawList();
+	this->materialsDrawsIDs.clear();
+	if (this->provokingMaterials != nullptr) {
+		delete this->provokingMaterials;
+		this->provokingMaterials = nullptr;
+	}
+	if (this->vboVerticesMaterialsID != 0) {
+		glDeleteBuffers(1, &this->vboVerticesMaterialsID);
+		this->vboVerticesMaterialsID = 0;
+	}
+	this->CleanPulledVertices();
+	this->pullingVertices = false;
 	CleanVboFacesNbElements();
 
+	if (this->clusterCuller != nullptr) {
+		delete this->clusterCuller;
+		this->clusterCuller = nullptr;
+	}
+	this->clusterCullingIsValid = false;
+
+	if (this->compactVertices != nullptr) {
+		delete this->compactVertices;
+		this->compactVertices = nullptr;
+	}
+
 	if (this->camera != nullptr) {
 		delete this->camera;
 		this->camera = nullptr;
@@ -342,6 +1252,47 @@ void Scene::CleanFacesVbos() {
 		glDeleteBuffers(this->nbVboFaces, this->vboFacesID);
 }
 
+void Scene::CleanPulledVertices() {
+	if (this->vaoPullingID == 0)
+		return;
+	glDeleteVertexArrays(1, &this->vaoPullingID);
+	glDeleteBuffers(1, &this->tboPulledIndicesID);
+	glDeleteTextures(1, &this->tboPulledIndicesTex);
+	glDeleteTextures(1, &this->tboPulledVerticesTex);
+	glDeleteTextures(1, &this->tboPulledMaterialsTex);
+	this->vaoPullingID = 0;
+	this->tboPulledIndicesID = 0;
+	this->tboPulledIndicesTex = 0;
+	this->tboPulledVerticesTex = 0;
+	this->tboPulledMaterialsTex = 0;
+}
+
+void Scene::UpdateRenderer(bool directionalLights, bool pointLights,
+		bool materials) {
+	this->needsRender = true;
+	// Wait for the end of the update
+	if (this->updateDepth) {
+		this->directionalLightsChanged |= directionalLights;
+		this->pointLightsChanged |= pointLights;
+		this->materialsChanged |= materials;
+		return;
+	}
+	if (this->renderer == nullptr)
+		return;
+
+	// Initializing shaders already updates the lists of lights
+	// (Otherwise, lights don’t change the shaders, only their buffers.)
+	Renderer* renderer = (Renderer*) this->renderer;
+	if (materials) {
+		renderer->InitShaders(false);
+		return;
+	}
+	if (directionalLights)
+		renderer->UpdateDirectionalLightList();
+	if (pointLights)
+		renderer->UpdatePointLightList();
+}
+
 void Scene::CleanVboFacesNbElements() {
 	if (this->vboFacesNbElements == nullptr)
 		return;
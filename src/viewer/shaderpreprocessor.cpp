@@ -0,0 +1,385 @@
+#include "shaderpreprocessor.h"
+
+#include <cstring>
+#include <locale>
+#include <sstream>
+
+#include "utils.h"
+
+/**
+ * \brief Output of the expansion of a template.
+ *
+ * Only counts the size of the text if there is no buffer, so that the same
+ * function computes the final size, then writes the text.
+ */
+class ShaderOutput
+{
+public:
+	ShaderOutput(std::string* text = nullptr)
+			: text(text) {}
+
+	void Append(const char* data, size_t size) {
+		if (this->text != nullptr)
+			this->text->append(data, size);
+		else
+			this->size += size;
+	}
+
+	void Append(const std::string& data) {
+		this->Append(data.data(), data.size());
+	}
+
+	void Append(const char* data) {
+		this->Append(data, strlen(data));
+	}
+
+	void AppendArgument(const ShaderTemplateTag& tag,
+			const std::string& call) {
+		for (size_t i = 0; i < tag.argumentParts.size(); i++) {
+			if (i)
+				this->Append(call);
+			this->Append(tag.argumentParts[i]);
+		}
+	}
+
+	size_t GetSize() const {
+		return this->size;
+	}
+
+private:
+	std::string* text = nullptr;
+	size_t size = 0;
+};
+
+static void ExpandTemplate(const ShaderTemplate& shaderTemplate,
+		const std::unordered_map<std::string, std::string>& macros,
+		const std::vector<std::shared_ptr<const ShaderMaterial>>& materials,
+		unsigned int firstMaterial, ShaderOutput& output) {
+	// (Materials can only be called once they are defined.)
+	bool materialsDefined = false;
+	bool materialIDDefined = false;
+	bool materialsTable = (macros.count(ST_MATERIALS_TABLE) > 0);
+	// (Both give the material to the fragment shader in `vert_material`.)
+	bool materialFromVertex = (macros.count(ST_MATERIAL_PER_DRAW) > 0)
+			|| (macros.count(ST_MATERIAL_PER_VERTEX) > 0);
+
+	for (size_t t = 0; t < shaderTemplate.tags.size(); t++) {
+		output.Append(shaderTemplate.texts[t]);
+
+		const ShaderTemplateTag& tag = shaderTemplate.tags[t];
+		switch (tag.type) {
+			case STT_DEFINE_MACROS:
+				// Add preprocessor macros (#define)
+				for (const std::pair<const std::string, std::string>& item:
+						macros) {
+					output.Append("#define ");
+					output.Append(item.first);
+					output.Append("\t");
+					output.Append(item.second);
+					output.Append("\n");
+				}
+				break;
+			case STT_DEFINE_MATERIALS:
+				// Add materials functions definitions
+				for (const auto& material: materials)
+					output.Append(material->content);
+				materialsDefined = true;
+				break;
+			case STT_CALL_MATERIALS:
+				// Add calls to materials functions added
+				if (!materialsDefined || materials.empty())
+					break;
+				if (materials.size() == 1) {
+					output.AppendArgument(tag, materials[0]->call);
+					break;
+				}
+				if (!materialIDDefined) {
+					if (materialFromVertex) {
+						output.Append("uint material = vert_material;\n");
+					} else {
+						output.Append("uint material = uint(texelFetch("
+								"face_material, gl_PrimitiveID).r);\n");
+					}
+					if (materialsTable)
+						output.Append("vec3 material_color;\n");
+					materialIDDefined = true;
+				}
+				if (materialsTable) {
+					// Only materials with a function get a branch, the
+					// others read their parameters, then the code is added
+					// once
+					output.Append("switch (material) {\n");
+					for (size_t i = 0; i < materials.size(); i++) {
+						if (!materials[i]->hasFunction)
+							continue;
+						output.Append("case ");
+						output.Append(std::to_string(
+								(unsigned int) (i + firstMaterial)));
+						output.Append("u: material_color = ");
+						output.Append(materials[i]->call);
+						output.Append("; break;\n");
+					}
+					std::string index = "(material - "
+							+ std::to_string(firstMaterial) + "u)";
+					output.Append("default: if (");
+					output.Append(index);
+					output.Append(" < ");
+					output.Append(std::to_string(
+							(unsigned int) materials.size()));
+					output.Append("u) { vec4 material_parameters = "
+							"texelFetch(materials_table, int(");
+					output.Append(index);
+					output.Append(")); material_color = "
+							"material_parameters.rgb * material_parameters.a; "
+							"} else { material_color = "
+							ST_DEFAULT_MATERIAL_CALL "; }\n}\n");
+					output.AppendArgument(tag, "material_color");
+					output.Append("\n");
+					break;
+				}
+				for (size_t i = 0; i < materials.size(); i++) {
+					output.Append("if (material == ");
+					output.Append(std::to_string(
+							(unsigned int) (i + firstMaterial)));
+					output.Append(") { ");
+					output.AppendArgument(tag, materials[i]->call);
+					output.Append(" }\nelse ");
+				}
+				output.Append("{ ");
+				output.AppendArgument(tag, ST_DEFAULT_MATERIAL_CALL);
+				output.Append(" }\n");
+				break;
+			default:
+				break;
+		}
+	}
+	output.Append(shaderTemplate.texts.back());
+}
+
+ShaderPreprocessor::ShaderPreprocessor() {}
+
+ShaderPreprocessor::~ShaderPreprocessor() {}
+
+std::string ShaderPreprocessor::Expand(const std::string& path,
+		const std::unordered_map<std::string, std::string>& macros,
+		const std::string* materialsPaths, unsigned int nbMaterials,
+		unsigned int firstMaterial,
+		std::vector<std::string>* dependencies) {
+	std::shared_ptr<const ShaderTemplate> shaderTemplate =
+			this->GetTemplate(path);
+	if (dependencies != nullptr)
+		dependencies->push_back(path);
+
+	// Only read the materials if the template defines them
+	std::vector<std::shared_ptr<const ShaderMaterial>> materials;
+	for (const ShaderTemplateTag& tag: shaderTemplate->tags) {
+		if (tag.type != STT_DEFINE_MATERIALS)
+			continue;
+		materials.reserve(nbMaterials);
+		for (unsigned int i = 0; i < nbMaterials; i++) {
+			materials.push_back(this->GetMaterial(materialsPaths[i]));
+			if (dependencies != nullptr)
+				dependencies->push_back(materialsPaths[i]);
+		}
+		break;
+	}
+
+	// Compute the size of the source, then write it
+	ShaderOutput counter;
+	ExpandTemplate(*shaderTemplate, macros, materials, firstMaterial, counter);
+	std::string source;
+	source.reserve(counter.GetSize());
+	ShaderOutput writer(&source);
+	ExpandTemplate(*shaderTemplate, macros, materials, firstMaterial, writer);
+
+	return source;
+}
+
+void ShaderPreprocessor::Invalidate(const std::string& path) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->templates.erase(path);
+	this->materials.erase(path);
+}
+
+void ShaderPreprocessor::Clear() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->templates.clear();
+	this->materials.clear();
+}
+
+unsigned int ShaderPreprocessor::GetNbCachedFiles() const {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->templates.size() + this->materials.size();
+}
+
+unsigned int ShaderPreprocessor::GetNbFileReads() const {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->nbFileReads;
+}
+
+std::vector<float> ShaderPreprocessor::GetMaterialsTable(
+		const std::string* materialsPaths, unsigned int nbMaterials) {
+	std::vector<float> table(SMP_SIZE * nbMaterials);
+	for (unsigned int i = 0; i < nbMaterials; i++) {
+		std::shared_ptr<const ShaderMaterial> material =
+				this->GetMaterial(materialsPaths[i]);
+		memcpy(&table[SMP_SIZE * i], material->parameters,
+				SMP_SIZE * sizeof(float));
+	}
+	return table;
+}
+
+ShaderTemplate ShaderPreprocessor::ParseTemplate(const std::string& content) {
+	ShaderTemplate result;
+
+	// Tags are lines starting with `@` (except the first one, which should
+	// always be `#version`)
+	size_t textStart = 0;
+	size_t lineEnd = content.find('\n');
+	while (lineEnd != std::string::npos) {
+		size_t lineStart = lineEnd + 1;
+		if ((lineStart >= content.size()) || (content[lineStart] != '@')) {
+			lineEnd = content.find('\n', lineStart);
+			continue;
+		}
+		lineEnd = content.find('\n', lineStart);
+		size_t end = (lineEnd == std::string::npos) ? content.size() : lineEnd;
+
+		// The name of the tag ends with the line or a space, followed by its
+		// argument
+		size_t space = content.find(' ', lineStart);
+		std::string name, argument;
+		if (space < end) {
+			name = content.substr(lineStart + 1, space - lineStart - 1);
+			argument = content.substr(space + 1, end - space - 1);
+		} else {
+			name = content.substr(lineStart + 1, end - lineStart - 1);
+		}
+
+		ShaderTemplateTag tag;
+		if (name == ST_DEFINE_MACROS)
+			tag.type = STT_DEFINE_MACROS;
+		else if (name == ST_DEFINE_MATERIALS)
+			tag.type = STT_DEFINE_MATERIALS;
+		else if (name == ST_CALL_MATERIALS)
+			tag.type = STT_CALL_MATERIALS;
+
+		// Split the argument around the materials calls
+		size_t partStart = 0;
+		size_t call = argument.find(STCM_TAG);
+		while (call != std::string::npos) {
+			tag.argumentParts.push_back(
+					argument.substr(partStart, call - partStart));
+			partStart = call + strlen(STCM_TAG);
+			call = argument.find(STCM_TAG, partStart);
+		}
+		tag.argumentParts.push_back(argument.substr(partStart));
+
+		// The whole line is replaced, with its new line
+		result.texts.push_back(content.substr(textStart,
+				lineStart - textStart));
+		result.tags.push_back(tag);
+		textStart = (lineEnd == std::string::npos)
+				? content.size() : (lineEnd + 1);
+	}
+	result.texts.push_back(content.substr(textStart));
+
+	return result;
+}
+
+ShaderMaterial ShaderPreprocessor::ParseMaterial(const std::string& content) {
+	ShaderMaterial material;
+
+	// Parameters are lines starting with `@`, removed from the content
+	// (Values are read with the classic locale, like GLSL ones.)
+	size_t lineStart = 0;
+	while (lineStart < content.size()) {
+		size_t lineEnd = content.find('\n', lineStart);
+		size_t end = (lineEnd == std::string::npos)
+				? content.size() : (lineEnd + 1);
+		if (content[lineStart] != '@') {
+			material.content.append(content, lineStart, end - lineStart);
+			lineStart = end;
+			continue;
+		}
+
+		std::istringstream line(content.substr(lineStart + 1,
+				end - lineStart - 1));
+		line.imbue(std::locale::classic());
+		std::string name;
+		line >> name;
+		if (name == SMP_ALBEDO) {
+			for (unsigned int c = 0; c < 3; c++)
+				line >> material.parameters[c];
+		} else if (name == SMP_DIFFUSE) {
+			line >> material.parameters[3];
+		}
+		lineStart = end;
+	}
+
+	if (material.content.find('{') != std::string::npos)
+		material.call = GetFunctionCallFromDeclaration(material.content);
+	material.hasFunction = !material.call.empty();
+
+	// Otherwise the call is the color given by the parameters (black by
+	// default, which avoids compilation errors if the file is empty or the
+	// function declaration wasn’t found)
+	if (!material.hasFunction) {
+		std::ostringstream call;
+		call.imbue(std::locale::classic());
+		call << "vec3(";
+		for (unsigned int c = 0; c < 3; c++) {
+			call << ((c > 0) ? ", " : "")
+					<< (material.parameters[c] * material.parameters[3]);
+		}
+		call << ")";
+		material.call = call.str();
+	}
+
+	return material;
+}
+
+std::shared_ptr<const ShaderTemplate> ShaderPreprocessor::GetTemplate(
+		const std::string& path) {
+	FileVersion version = GetFileVersion(path);
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		auto i = this->templates.find(path);
+		if ((i != this->templates.end())
+				&& (i->second->version == version))
+			return i->second;
+	}
+
+	// (Read without locking, other threads keep expanding meanwhile.)
+	std::shared_ptr<ShaderTemplate> shaderTemplate =
+			std::make_shared<ShaderTemplate>(
+					ParseTemplate(LoadTextFile(path)));
+	shaderTemplate->version = version;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->templates[path] = shaderTemplate;
+	this->nbFileReads++;
+	return shaderTemplate;
+}
+
+std::shared_ptr<const ShaderMaterial> ShaderPreprocessor::GetMaterial(
+		const std::string& path) {
+	FileVersion version = GetFileVersion(path);
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		auto i = this->materials.find(path);
+		if ((i != this->materials.end())
+				&& (i->second->version == version))
+			return i->second;
+	}
+
+	std::shared_ptr<ShaderMaterial> material =
+			std::make_shared<ShaderMaterial>(
+					ParseMaterial(LoadTextFile(path)));
+	material->version = version;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->materials[path] = material;
+	this->nbFileReads++;
+	return material;
+}
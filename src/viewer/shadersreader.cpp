@@ -1,5 +1,8 @@
 #include "shadersreader.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -7,6 +10,29 @@
 #include "modules/message.h"
 #include "utils.h"
 
+// Names of the uniforms, in the order of `ShaderUniform`
+static const char* uniformsNames[SU_COUNT] = {
+	"ambient_color",
+	"lights_dir_direction",
+	"lights_dir_intensity",
+	"lights_pt_position",
+	"lights_pt_intensity",
+	"nb_dir_lights",
+	"nb_pt_lights",
+	"vtx_position_offset",
+	"vtx_position_scale",
+	"vtx_octahedral",
+	"vtx_pulling",
+	"vtx_indices",
+	"vtx_vertices",
+	"vtx_stride",
+	"vtx_offsets",
+	"vtx_default_color",
+	"vtx_materials",
+	"face_material",
+	"materials_table"
+};
+
 std::string GetShaderLog(GLuint shader) {
 	GLint size = 0;
 	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &size);
@@ -19,26 +45,95 @@ std::string GetShaderLog(GLuint shader) {
 	return text;
 }
 
+bool IsParallelCompileSupported() {
+	static bool checked = false;
+	static bool supported = false;
+	if (checked)
+		return supported;
+	checked = true;
+
+	GLint nbExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &nbExtensions);
+	for (GLint i = 0; i < nbExtensions; i++) {
+		const char* name = (const char*) glGetStringi(GL_EXTENSIONS, i);
+		if (name == nullptr)
+			continue;
+
+		// Let the driver choose the number of compiler threads
+		if (!strcmp(name, "GL_KHR_parallel_shader_compile")) {
+			gl::glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+			supported = true;
+		} else if (!strcmp(name, "GL_ARB_parallel_shader_compile")) {
+			gl::glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+			supported = true;
+		}
+		if (supported)
+			break;
+	}
+
+	return supported;
+}
+
 ShadersReader::ShadersReader(void* context)
 		: context(context) {
-	this->SetDefaultMacrosValues();
+	for (unsigned int i = 0; i < SU_COUNT; i++)
+		this->uniformsLocations[i] = -1;
 }
 
 ShadersReader::~ShadersReader() {
+	this->CancelCompilation();
 	this->Clean();
 }
 
 bool ShadersReader::Load() {
+	// Same steps as an asynchronous load, but waiting for the program
+	this->Preprocess();
+	return this->Compile() && this->Finish(true);
+}
+
+bool ShadersReader::Preprocess() {
+	// (Only files and the reader’s own fields are read, so that readers can
+	// be preprocessed on worker threads.)
+	auto start = std::chrono::steady_clock::now();
+	this->preprocessedVertexSource.clear();
+	this->preprocessedFragmentSource.clear();
+	this->dependencies.clear();
+	this->isPreprocessed = false;
+	this->preprocessingTime = 0.;
+
 	// Check if filepaths were given
 	if (this->vertexShaderPath.empty()
 			|| this->fragmentShaderPath.empty())
 		return false;
 
 	// Load files’ content
-	std::string vertexShaderContent =
+	this->preprocessedVertexSource =
 			this->GetFileContent(this->vertexShaderPath);
-	std::string fragmentShaderContent =
+	this->preprocessedFragmentSource =
 			this->GetFileContent(this->fragmentShaderPath);
+	this->isPreprocessed = true;
+	this->preprocessingTime = std::chrono::duration<float, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+
+	return !this->preprocessedVertexSource.empty()
+			&& !this->preprocessedFragmentSource.empty();
+}
+
+bool ShadersReader::Compile() {
+	// Check if filepaths were given
+	if (this->vertexShaderPath.empty()
+			|| this->fragmentShaderPath.empty())
+		return false;
+
+	if (!this->isPreprocessed)
+		this->Preprocess();
+	std::string vertexShaderContent, fragmentShaderContent;
+	vertexShaderContent.swap(this->preprocessedVertexSource);
+	fragmentShaderContent.swap(this->preprocessedFragmentSource);
+	this->isPreprocessed = false;
+
+	// A previous compilation still running is replaced
+	this->CancelCompilation();
 
 	// Check if both files have content
 	if (vertexShaderContent.empty()) {
@@ -61,87 +156,132 @@ bool ShadersReader::Load() {
 		}
 		return false;
 	}
-	// Create program
-	GLuint tmpProgramID = glCreateProgram();
-	GLuint tmpVertexShaderID, tmpFragmentShaderID;
-
-	// Load vertex shader
-	{
-		// Create shader
-		tmpVertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-
-		// Load shader source code
-		const GLchar* content = vertexShaderContent.c_str();
-		glShaderSource(tmpVertexShaderID, 1, (const GLchar**) &content, 0);
-
-		// Compile
-		glCompileShader(tmpVertexShaderID);
-		// Check compilation status
-		int compiled;
-		glGetShaderiv(tmpVertexShaderID, GL_COMPILE_STATUS, &compiled);
-		if (!compiled) {
-			// If errors, send alert to user
-			if (this->context != nullptr) {
-				((Context*) this->context)->AddModule(new AlertMessageModule(
-						this->context, "Failed to compile file '"
-								+ this->vertexShaderPath + "':\n"
-								+ GetShaderLog(tmpVertexShaderID)));
-			}
-
-			// Delete new shader and program
-			glDeleteShader(tmpVertexShaderID);
-			glDeleteProgram(tmpProgramID);
-			return false;
+
+	// Reuse the program if the same sources were already linked
+	ProgramCache* cache = (this->context != nullptr)
+			? ((Context*) this->context)->GetProgramCache() : nullptr;
+	if (cache != nullptr) {
+		GLuint cachedProgramID = cache->Acquire(vertexShaderContent,
+				fragmentShaderContent);
+		if (cachedProgramID) {
+			this->ReplaceProgram(cachedProgramID, 0, 0, cache,
+					vertexShaderContent, fragmentShaderContent);
+			return true;
+		}
+
+		// Otherwise load it from the binary saved by a previous run, if any
+		auto start = std::chrono::steady_clock::now();
+		GLuint binaryProgramID = cache->LoadBinary(vertexShaderContent,
+				fragmentShaderContent);
+		if (binaryProgramID) {
+			cache->Add(vertexShaderContent, fragmentShaderContent,
+					binaryProgramID);
+			cache->AddLoadingTime(std::chrono::duration<float, std::milli>(
+					std::chrono::steady_clock::now() - start).count(), true);
+			this->ReplaceProgram(binaryProgramID, 0, 0, cache,
+					vertexShaderContent, fragmentShaderContent);
+			return true;
 		}
-		// Attach the shader to the program
-		glAttachShader(tmpProgramID, tmpVertexShaderID);
 	}
 
-	// Load fragment shader
-	{
-		// Create shader
-		tmpFragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-		// Load shader source code
-		const GLchar* content = fragmentShaderContent.c_str();
-		glShaderSource(tmpFragmentShaderID, 1, (const GLchar**) &content, 0);
-
-		// Compile
-		glCompileShader(tmpFragmentShaderID);
-
-		// Check compilation status
-		int compiled;
-		glGetShaderiv(tmpFragmentShaderID, GL_COMPILE_STATUS, &compiled);
-		if (!compiled) {
-			// If errors, send alert to user
-			if (this->context != nullptr) {
-				((Context*) this->context)->AddModule(new AlertMessageModule(
-						this->context, "Failed to compile file '"
-								+ this->fragmentShaderPath + "':\n"
-								+ GetShaderLog(tmpFragmentShaderID)));
-			}
-
-			// Delete new shaders and program
-			glDeleteShader(tmpVertexShaderID);
-			glDeleteShader(tmpFragmentShaderID);
-			glDeleteProgram(tmpProgramID);
+	auto start = std::chrono::steady_clock::now();
+
+	// Create program and compile shaders
+	// (Statuses are only checked by `Finish()`, so that the driver can
+	// compile several programs at once.)
+	this->pendingProgramID = glCreateProgram();
+	this->pendingVertexShaderID = this->CreateShader(GL_VERTEX_SHADER,
+			vertexShaderContent);
+	this->pendingFragmentShaderID = this->CreateShader(GL_FRAGMENT_SHADER,
+			fragmentShaderContent);
+
+	// Attach the shaders to the program
+	glAttachShader(this->pendingProgramID, this->pendingVertexShaderID);
+	glAttachShader(this->pendingProgramID, this->pendingFragmentShaderID);
+
+	// Bind attributes to fixed locations, so that a single VAO fits all
+	// programs
+	glBindAttribLocation(this->pendingProgramID, SAL_VTX_POSITION,
+			"vtx_position");
+	glBindAttribLocation(this->pendingProgramID, SAL_VTX_COLOR, "vtx_color");
+	glBindAttribLocation(this->pendingProgramID, SAL_VTX_NORMAL,
+			"vtx_normal");
+	glBindAttribLocation(this->pendingProgramID, SAL_VTX_MATERIAL,
+			"vtx_material");
+
+	if (cache != nullptr)
+		cache->PrepareBinary(this->pendingProgramID);
+
+	// Link the program
+	glLinkProgram(this->pendingProgramID);
+
+	// (Sources are needed once linked, to add the program to the cache.)
+	this->pendingVertexSource.swap(vertexShaderContent);
+	this->pendingFragmentSource.swap(fragmentShaderContent);
+	this->isCompiling = true;
+
+	// (Frames rendered until the program is checked aren't counted.)
+	this->compilationTime = this->preprocessingTime
+			+ std::chrono::duration<float, std::milli>(
+					std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+bool ShadersReader::Finish(bool wait) {
+	if (!this->isCompiling)
+		return this->areLoaded;
+	auto start = std::chrono::steady_clock::now();
+
+	// Without waiting, the program is only checked once the driver tells it
+	// is done (which needs KHR_parallel_shader_compile)
+	if (!wait) {
+		if (!IsParallelCompileSupported())
 			return false;
+		GLint completed = 0;
+		glGetProgramiv(this->pendingProgramID, gl::GL_COMPLETION_STATUS_KHR,
+				&completed);
+		if (!completed)
+			return false;
+	}
+
+	// Check compilation statuses
+	int compiled;
+	glGetShaderiv(this->pendingVertexShaderID, GL_COMPILE_STATUS, &compiled);
+	if (!compiled) {
+		// If errors, send alert to user
+		if (this->context != nullptr) {
+			((Context*) this->context)->AddModule(new AlertMessageModule(
+					this->context, "Failed to compile file '"
+							+ this->vertexShaderPath + "':\n"
+							+ GetShaderLog(this->pendingVertexShaderID)));
 		}
-		// Attach the shader to the program
-		glAttachShader(tmpProgramID, tmpFragmentShaderID);
+
+		// Delete new shaders and program
+		this->CancelCompilation();
+		return false;
 	}
+	glGetShaderiv(this->pendingFragmentShaderID, GL_COMPILE_STATUS,
+			&compiled);
+	if (!compiled) {
+		// If errors, send alert to user
+		if (this->context != nullptr) {
+			((Context*) this->context)->AddModule(new AlertMessageModule(
+					this->context, "Failed to compile file '"
+							+ this->fragmentShaderPath + "':\n"
+							+ GetShaderLog(this->pendingFragmentShaderID)));
+		}
 
-	// Link the program
-	glLinkProgram(tmpProgramID);
+		// Delete new shaders and program
+		this->CancelCompilation();
+		return false;
+	}
 
 	// Check linkage status
 	int linked;
-	glGetProgramiv(tmpProgramID, GL_LINK_STATUS, &linked);
+	glGetProgramiv(this->pendingProgramID, GL_LINK_STATUS, &linked);
 	if (linked != ((int) GL_TRUE)) {
 		// If errors, delete new shaders and program
-		glDeleteShader(tmpVertexShaderID);
-		glDeleteShader(tmpFragmentShaderID);
-		glDeleteProgram(tmpProgramID);
+		this->CancelCompilation();
 
 		if (this->context != nullptr) {
 			((Context*) this->context)->AddModule(new AlertMessageModule(
@@ -151,40 +291,74 @@ bool ShadersReader::Load() {
 		return false;
 	}
 
+	// The cache, if any, takes the ownership of the program, and saves it
+	// for the next runs
+	ProgramCache* cache = (this->context != nullptr)
+			? ((Context*) this->context)->GetProgramCache() : nullptr;
+	if (cache != nullptr) {
+		cache->Add(this->pendingVertexSource, this->pendingFragmentSource,
+				this->pendingProgramID);
+		this->compilationTime += std::chrono::duration<float, std::milli>(
+				std::chrono::steady_clock::now() - start).count();
+		cache->AddLoadingTime(this->compilationTime, false);
+		cache->SaveBinary(this->pendingVertexSource,
+				this->pendingFragmentSource, this->pendingProgramID);
+	}
+
 	// Replace current program and shaders by new ones
-	this->Clean();
-	this->programID = tmpProgramID;
-	this->vertexShaderID = tmpVertexShaderID;
-	this->fragmentShaderID = tmpFragmentShaderID;
-	this->vertexShaderSource = vertexShaderContent;
-	this->fragmentShaderSource = fragmentShaderContent;
-	this->areLoaded = true;
+	this->isCompiling = false;
+	this->ReplaceProgram(this->pendingProgramID, this->pendingVertexShaderID,
+			this->pendingFragmentShaderID, cache, this->pendingVertexSource,
+			this->pendingFragmentSource);
+	this->pendingProgramID = 0;
+	this->pendingVertexShaderID = 0;
+	this->pendingFragmentShaderID = 0;
+	this->CancelCompilation();
 
 	return true;
 }
 
 bool ShadersReader::LoadFiles(const std::string& vertexShaderPath,
 		const std::string& fragmentShaderPath) {
-	this->vertexShaderPath = vertexShaderPath;
-	this->fragmentShaderPath = fragmentShaderPath;
+	this->SetFiles(vertexShaderPath, fragmentShaderPath);
+	return this->Load();
+}
 
+bool ShadersReader::LoadFiles(const std::string& vertexShaderPath,
+		const std::string& fragmentShaderPath,
+		MaterialList* materialsPaths) {
+	this->SetFiles(vertexShaderPath, fragmentShaderPath, materialsPaths);
 	return this->Load();
 }
 
 bool ShadersReader::LoadFiles(const std::string& vertexShaderPath,
+		const std::string& fragmentShaderPath,
+		std::string* specificMaterialPath) {
+	this->SetFiles(vertexShaderPath, fragmentShaderPath, specificMaterialPath);
+	return this->Load();
+}
+
+void ShadersReader::SetFiles(const std::string& vertexShaderPath,
+		const std::string& fragmentShaderPath) {
+	this->vertexShaderPath = vertexShaderPath;
+	this->fragmentShaderPath = fragmentShaderPath;
+	this->isPreprocessed = false;
+}
+
+void ShadersReader::SetFiles(const std::string& vertexShaderPath,
 		const std::string& fragmentShaderPath,
 		MaterialList* materialsPaths) {
 	this->materialsPaths = materialsPaths;
 	this->specificMaterialPath = nullptr;
-	return this->LoadFiles(vertexShaderPath, fragmentShaderPath);
+	this->SetFiles(vertexShaderPath, fragmentShaderPath);
 }
 
-bool ShadersReader::LoadFiles(const std::string& vertexShaderPath,
+void ShadersReader::SetFiles(const std::string& vertexShaderPath,
 		const std::string& fragmentShaderPath,
 		std::string* specificMaterialPath) {
 	this->specificMaterialPath = specificMaterialPath;
 	this->materialsPaths = nullptr;
-	return this->LoadFiles(vertexShaderPath, fragmentShaderPath);
+	this->SetFiles(vertexShaderPath, fragmentShaderPath);
 }
 
 void ShadersReader::Activate() const {
@@ -204,6 +378,13 @@ void ShadersReader::SetPreProcessorMacro(const std::string& name,
 	this->preprocessorMacros[name] = value;
 }
 
+int ShadersReader::GetUniformLocation(ShaderUniform uniform) const {
+	// (Locations are only valid for the current program, so they are
+	// resolved again each time it is replaced.)
+	assert(this->areLoaded);
+	return this->uniformsLocations[uniform];
+}
+
 int ShadersReader::GetUniformLocation(const std::string& name) const {
 	// Kill the program if it went here without shaders compiled
 	// to avoid possible problems with OpenGL (renderering on wrong shaders).
@@ -230,6 +411,23 @@ bool ShadersReader::AreLoaded() {
 	return this->areLoaded;
 }
 
+bool ShadersReader::IsCompiling() {
+	return this->isCompiling;
+}
+
+bool ShadersReader::DependsOn(const std::vector<std::string>& paths) {
+	for (const std::string& path: paths) {
+		if (std::find(this->dependencies.begin(), this->dependencies.end(),
+				path) != this->dependencies.end())
+			return true;
+	}
+	return false;
+}
+
+const std::vector<std::string>& ShadersReader::GetDependencies() {
+	return this->dependencies;
+}
+
 const std::string& ShadersReader::GetVertexShaderPath() {
 	return this->vertexShaderPath;
 }
@@ -246,142 +444,112 @@ const std::string& ShadersReader::GetFragmentShaderSource() {
 	return this->fragmentShaderSource;
 }
 
-void ShadersReader::SetDefaultMacrosValues() {
-	this->preprocessorMacros[SPPM_NB_DIR_LIGHTS] = "0";
-	this->preprocessorMacros[SPPM_NB_PT_LIGHTS] = "0";
+void ShadersReader::ResolveUniforms() {
+	for (unsigned int i = 0; i < SU_COUNT; i++) {
+		this->uniformsLocations[i] =
+				glGetUniformLocation(this->programID, uniformsNames[i]);
+	}
+
+	// Per-frame constants are read from the same buffer by all programs
+	GLuint frameConstantsIndex = glGetUniformBlockIndex(this->programID,
+			SUB_FRAME_CONSTANTS_NAME);
+	if (frameConstantsIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(this->programID, frameConstantsIndex,
+				SUB_FRAME_CONSTANTS);
+	}
+}
+
+void ShadersReader::ReplaceProgram(GLuint programID, GLuint vertexShaderID,
+		GLuint fragmentShaderID, ProgramCache* cache,
+		const std::string& vertexShaderSource,
+		const std::string& fragmentShaderSource) {
+	this->Clean();
+	this->programID = programID;
+	this->vertexShaderID = vertexShaderID;
+	this->fragmentShaderID = fragmentShaderID;
+	this->programCache = cache;
+	this->vertexShaderSource = vertexShaderSource;
+	this->fragmentShaderSource = fragmentShaderSource;
+	this->areLoaded = true;
+	this->ResolveUniforms();
+}
+
+GLuint ShadersReader::CreateShader(GLenum type, const std::string& source) {
+	// Programs with the same source share their shader (per-material ones
+	// only differ by their fragment shader)
+	ProgramCache* cache = (this->context != nullptr)
+			? ((Context*) this->context)->GetProgramCache() : nullptr;
+	if (cache != nullptr)
+		return cache->AcquireShader(type, source);
+
+	GLuint shaderID = glCreateShader(type);
+	const GLchar* content = source.c_str();
+	glShaderSource(shaderID, 1, (const GLchar**) &content, 0);
+	glCompileShader(shaderID);
+	return shaderID;
+}
+
+void ShadersReader::DeleteShader(GLuint shaderID) {
+	if (shaderID == 0)
+		return;
+	ProgramCache* cache = (this->context != nullptr)
+			? ((Context*) this->context)->GetProgramCache() : nullptr;
+	if (cache != nullptr)
+		cache->ReleaseShader(shaderID);
+	else
+		glDeleteShader(shaderID);
+}
+
+void ShadersReader::CancelCompilation() {
+	// (Deleting shaders and programs being compiled doesn’t wait for them.)
+	if (this->pendingProgramID) {
+		this->DeleteShader(this->pendingVertexShaderID);
+		this->DeleteShader(this->pendingFragmentShaderID);
+		glDeleteProgram(this->pendingProgramID);
+	}
+	this->pendingProgramID = 0;
+	this->pendingVertexShaderID = 0;
+	this->pendingFragmentShaderID = 0;
+	this->pendingVertexSource.clear();
+	this->pendingFragmentSource.clear();
+	this->isCompiling = false;
 }
 
 void ShadersReader::Clean() {
 	if (!this->areLoaded)
 		return;
-	glDeleteShader(this->vertexShaderID);
-	glDeleteShader(this->fragmentShaderID);
-	glDeleteProgram(this->programID);
+	this->DeleteShader(this->vertexShaderID);
+	this->DeleteShader(this->fragmentShaderID);
+	if (this->programCache != nullptr)
+		this->programCache->Release(this->programID);
+	else
+		glDeleteProgram(this->programID);
+	this->programCache = nullptr;
 	this->areLoaded = false;
+	for (unsigned int i = 0; i < SU_COUNT; i++)
+		this->uniformsLocations[i] = -1;
 }
 
 std::string ShadersReader::GetFileContent(const std::string& path) {
-	std::string content = LoadTextFile(path);
-
-	bool defineMaterialID = true;
-
 	// Prepare materials
-	std::vector<std::string> materialsCalls;
-	unsigned char nbMaterials = 0;
+	unsigned int nbMaterials = 0, firstMaterial = 0;
 	std::string* materialsPath = nullptr;
 	if (this->materialsPaths != nullptr) {
 		nbMaterials = this->materialsPaths->GetNbMaterials();
 		materialsPath = this->materialsPaths->GetMaterialsPaths();
+		firstMaterial = this->materialsPaths->GetFirstMaterial();
 	} else if (this->specificMaterialPath != nullptr) {
 		nbMaterials = 1;
 		materialsPath = this->specificMaterialPath;
 	}
 
-	// Search if there are tags in the source code
-	// (To avoid tags in comment, only search after a new line,
-	// the first one should always be ‘#version’)
-	std::size_t insertPoint = content.find("\n@");
-	std::size_t endTag, spaceTag;
-	std::string tag, argument, newContent;
-	while (insertPoint != std::string::npos) {
-		insertPoint += 2;
-
-		// Search for the end of the tag (either a new line or a space)
-		endTag = content.find('\n', insertPoint);
-		spaceTag = content.find(' ', insertPoint);
-		if (spaceTag < endTag) {
-			tag = content.substr(insertPoint, (spaceTag - insertPoint));
-			argument = content.substr(spaceTag + 1, (endTag - spaceTag - 1));
-		} else {
-			tag = content.substr(insertPoint, (endTag - insertPoint));
-			argument = "";
-		}
-
-		newContent = "";
-
-		// Check the tag and prepare the new content
-		if (!tag.compare(ST_DEFINE_MACROS)) {
-			// Add preprocessor macros (#define)
-			for (const std::pair<const std::string, std::string>& item:
-					this->preprocessorMacros) {
-				newContent += "#define " + item.first + '\t' + item.second
-						+ '\n';
-			}
-		} else if (!tag.compare(ST_DEFINE_MATERIALS)) {
-			// Add materials functions definitions
-			std::string materialContent, materialCall;
-			std::size_t beginCall, endCall;
-
-			for (unsigned char i = 0; i < nbMaterials; i++) {
-				materialContent = LoadTextFile(materialsPath[i]);
-				if (materialContent.size()) {
-					// Add the material content to the shader
-					newContent += materialContent;
-
-					// Create a function call from the material content
-					materialCall =
-							GetFunctionCallFromDeclaration(materialContent);
-
-					// If the call was created, add it
-					if (materialCall.size()) {
-						materialsCalls.push_back(materialCall);
-						continue;
-					}
-				}
-				// Add a basic call to avoid compilation error if the file was
-				// empty or the function declaration was not found
-				materialsCalls.push_back("vec3(0, 0, 0)");
-			}
-		} else if (!tag.compare(ST_CALL_MATERIALS)) {
-			// Add calls to materials functions added
-			// (We consider the definitions are already done)
-
-			// Check the number of calls prepared
-			if ((nbMaterials == materialsCalls.size())
-					&& (nbMaterials)) {
-				std::size_t nextCall;
-				if (nbMaterials == 1) {
-					newContent += this->PrepareMaterialCallArgument(
-							argument, materialsCalls[0]);
-				} else {
-					if (defineMaterialID) {
-						newContent += "uint material = uint(texelFetch("
-								"face_material, gl_PrimitiveID).r);\n";
-						defineMaterialID = false;
-					}
-					for (unsigned char i = 0; i < nbMaterials; i++) {
-						newContent += "if (material == "
-								+ std::to_string((unsigned int)
-										(i + this->materialsPaths
-												->GetFirstMaterial()))
-								+ ") { " + this->PrepareMaterialCallArgument(
-										argument, materialsCalls[i])
-								+ " }\nelse ";
-					}
-					newContent += "{ " + this->PrepareMaterialCallArgument(
-							argument, "vec3(0, 0, 0)") + " }\n";
-				}
-			}
-		}
-
-		// Replace the tag by the new content in the source code
-		content.replace(insertPoint - 1,
-				(endTag - insertPoint + 2), newContent);
-
-		// Search the next possible tag
-		insertPoint = content.find("\n@", endTag);
-	}
-
-	return content;
-}
-
-std::string ShadersReader::PrepareMaterialCallArgument(const std::string& text,
-		const std::string& materialCall) {
-	std::string newText = text;
-	std::size_t nextCall = newText.find(STCM_TAG);
-	while (nextCall != std::string::npos) {
-		newText.replace(nextCall, 4, materialCall);
-		nextCall = newText.find(STCM_TAG, (nextCall + materialCall.size()));
+	// Templates and materials are shared by all readers of the context
+	if (this->context != nullptr) {
+		return ((Context*) this->context)->GetShaderPreprocessor()->Expand(
+				path, this->preprocessorMacros, materialsPath, nbMaterials,
+				firstMaterial, &this->dependencies);
 	}
-	return newText;
+	ShaderPreprocessor preprocessor;
+	return preprocessor.Expand(path, this->preprocessorMacros, materialsPath,
+			nbMaterials, firstMaterial, &this->dependencies);
 }
@@ -1,7 +1,19 @@
 #include "utils.h"
 
+#include <cerrno>
 #include <fstream>
 
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <direct.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
 unsigned int Global::nextModuleID = 0;
 
 bool FileExists(std::string path) {
@@ -20,13 +32,21 @@ std::string LoadTextFile(const std::string& path) {
 	if (!file)
 		return content;
 
-	const int bufferSize = 2048;
-	char buffer[bufferSize];
-	while (file.getline(buffer, bufferSize))
-		content += std::string(buffer) + '\n';
-
+	// Read the whole file at once in a buffer of its size
+	file.seekg(0, std::ios::end);
+	std::streamoff size = file.tellg();
+	if (size > 0) {
+		content.resize((size_t) size);
+		file.seekg(0, std::ios::beg);
+		file.read(&content[0], size);
+		content.resize((size_t) file.gcount());
+	}
 	file.close();
 
+	// (The last line always ends with a new line.)
+	if (!content.empty() && (content.back() != '\n'))
+		content += '\n';
+
 	return content;
 }
 
@@ -41,6 +61,71 @@ bool SaveTextFile(const std::string& path, const std::string& content) {
 	return true;
 }
 
+time_t GetFileModificationTime(const std::string& path) {
+	struct stat status;
+	if (stat(path.c_str(), &status) != 0)
+		return 0;
+	return status.st_mtime;
+}
+
+bool FileVersion::operator==(const FileVersion& other) const {
+	return (this->modificationTime == other.modificationTime)
+			&& (this->size == other.size);
+}
+
+bool FileVersion::operator!=(const FileVersion& other) const {
+	return !(*this == other);
+}
+
+FileVersion GetFileVersion(const std::string& path) {
+	// (`stat()` only gives seconds on Windows.)
+	FileVersion version;
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard,
+			&attributes))
+		return version;
+	// File times are in units of 100 ns
+	version.modificationTime = 100 * (long long)
+			((((unsigned long long) attributes.ftLastWriteTime.dwHighDateTime)
+					<< 32) | attributes.ftLastWriteTime.dwLowDateTime);
+	version.size = (long long) ((((unsigned long long)
+			attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow);
+#else
+	struct stat status;
+	if (stat(path.c_str(), &status) != 0)
+		return version;
+#ifdef __APPLE__
+	const struct timespec& time = status.st_mtimespec;
+#else
+	const struct timespec& time = status.st_mtim;
+#endif
+	version.modificationTime = (1000000000ll * (long long) time.tv_sec)
+			+ time.tv_nsec;
+	version.size = (long long) status.st_size;
+#endif
+	return version;
+}
+
+bool MakeDirectory(const std::string& path) {
+#ifdef _WIN32
+	int result = _mkdir(path.c_str());
+#else
+	int result = mkdir(path.c_str(), 0755);
+#endif
+	// (An existing directory is fine.)
+	return (result == 0) || (errno == EEXIST);
+}
+
+bool DeleteDirectory(const std::string& path) {
+	// (Only empty directories are deleted.)
+#ifdef _WIN32
+	return _rmdir(path.c_str()) == 0;
+#else
+	return rmdir(path.c_str()) == 0;
+#endif
+}
+
 std::string GetFunctionCallFromDeclaration(const std::string& content) {
 	// Find the function declaration (expect return type) in the text if any
 	std::size_t begin = content.find(' ');
@@ -11,3 +11,10 @@ make tests
 [ -f tests/viewer/plyreader ] && ./tests/viewer/plyreader
 [ -f tests/viewer/cliloader ] && ./tests/viewer/cliloader
 [ -f tests/viewer/tomlloader ] && ./tests/viewer/tomlloader
+[ -f tests/viewer/occlusion ] && ./tests/viewer/occlusion
+[ -f tests/viewer/bvh ] && ./tests/viewer/bvh
+[ -f tests/viewer/compactvertices ] && ./tests/viewer/compactvertices
+[ -f tests/viewer/filewatcher ] && ./tests/viewer/filewatcher
+[ -f tests/viewer/shaderpreprocessor ] && ./tests/viewer/shaderpreprocessor
+[ -f tests/viewer/provokingmaterials ] && ./tests/viewer/provokingmaterials
+[ -f tests/viewer/culling ] && ./tests/viewer/culling
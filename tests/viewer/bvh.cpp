@@ -0,0 +1,158 @@
+#include <iostream>
+
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+
+#include "bvh.h"
+#include "mesh.h"
+#include "meshfactory.h"
+
+void* context = nullptr;
+
+// Number of faces of the generated meshes
+#define NB_FACES 3000
+// Number of rays cast at each mesh
+#define NB_RAYS 2000
+
+static Mesh* CreateRandomMesh(unsigned int seed) {
+	// Small triangles scattered in a unit cube, with some larger ones
+	std::vector<float> positions(9 * NB_FACES);
+	std::vector<unsigned int> faces(3 * NB_FACES);
+	for (unsigned int f = 0; f < NB_FACES; f++) {
+		float size = (f % 100) ? .05 : .5;
+		float center[3] = {
+				GetRandom(seed), GetRandom(seed), GetRandom(seed) };
+		for (unsigned int v = 0; v < 3; v++) {
+			for (unsigned int c = 0; c < 3; c++) {
+				positions[(9 * f) + (3 * v) + c] = center[c]
+						+ size * (GetRandom(seed) - .5f);
+			}
+			faces[(3 * f) + v] = (3 * f) + v;
+		}
+	}
+	return CreateMesh(positions, faces);
+}
+
+static bool IntersectAllFaces(Mesh* mesh, const Eigen::Vector3f& origin,
+		const Eigen::Vector3f& direction, RayHit& hit) {
+	// Test each face of the mesh, with the same algorithm as the hierarchy
+	bool found = false;
+	for (unsigned int f = 0; f < mesh->nbFaces; f++) {
+		unsigned int* face = mesh->facesVertices + (3 * f);
+		Eigen::Vector3f vertex = mesh->verticesData[face[0]].position;
+		Eigen::Vector3f edge1 = mesh->verticesData[face[1]].position - vertex;
+		Eigen::Vector3f edge2 = mesh->verticesData[face[2]].position - vertex;
+
+		Eigen::Vector3f p = direction.cross(edge2);
+		float determinant = edge1.dot(p);
+		if (determinant == 0.)
+			continue;
+		Eigen::Vector3f s = origin - vertex;
+		float u = s.dot(p) / determinant;
+		Eigen::Vector3f q = s.cross(edge1);
+		float v = direction.dot(q) / determinant;
+		float t = edge2.dot(q) / determinant;
+		if ((u < 0.) || (u > 1.) || (v < 0.) || ((u + v) > 1.) || (t < 0.))
+			continue;
+		if (t < hit.distance) {
+			found = true;
+			hit.face = f;
+			hit.distance = t;
+		}
+	}
+	return found;
+}
+
+static void TestEmpty() {
+	Mesh* mesh = CreateMesh({}, {});
+
+	BVH* bvh = new BVH(mesh);
+	REQUIRE(bvh->GetNbNodes() == 0);
+	RayHit hit;
+	REQUIRE(!bvh->Intersect(Eigen::Vector3f::Zero(),
+			Eigen::Vector3f(0., 0., 1.), hit));
+	REQUIRE(!bvh->IntersectAny(Eigen::Vector3f::Zero(),
+			Eigen::Vector3f(0., 0., 1.)));
+
+	delete bvh;
+	delete mesh;
+}
+
+static void TestStructure() {
+	Mesh* mesh = CreateRandomMesh(1);
+
+	BVH* bvh = mesh->GetBVH();
+	REQUIRE(bvh != nullptr);
+	REQUIRE(mesh->GetBVH() == bvh);
+	REQUIRE(bvh->GetNbNodes() > 1);
+	REQUIRE(bvh->GetNbNodes() < 2 * NB_FACES);
+	REQUIRE(bvh->GetDepth() > 1);
+	REQUIRE(bvh->GetDepth() < 64);
+
+	// The hierarchy is rebuilt after faces are reordered
+	mesh->ComputeClusters(64);
+	bvh = mesh->GetBVH();
+	REQUIRE(bvh != nullptr);
+	REQUIRE(bvh->GetNbNodes() > 1);
+
+	delete mesh;
+}
+
+static void TestRays() {
+	Mesh* mesh = CreateRandomMesh(2);
+	BVH* bvh = mesh->GetBVH();
+
+	unsigned int seed = 3;
+	unsigned int nbHits = 0;
+	for (unsigned int r = 0; r < NB_RAYS; r++) {
+		// Rays from around the cube towards random points in it
+		Eigen::Vector3f origin(GetRandom(seed) * 4.f - 1.5f,
+				GetRandom(seed) * 4.f - 1.5f, GetRandom(seed) * 4.f - 1.5f);
+		Eigen::Vector3f target(GetRandom(seed), GetRandom(seed),
+				GetRandom(seed));
+		Eigen::Vector3f direction = (target - origin).normalized();
+
+		RayHit expected;
+		bool expectedFound = IntersectAllFaces(mesh, origin, direction,
+				expected);
+		RayHit hit;
+		bool found = bvh->Intersect(origin, direction, hit);
+
+		REQUIRE(found == expectedFound);
+		REQUIRE(bvh->IntersectAny(origin, direction) == expectedFound);
+		if (!found)
+			continue;
+		nbHits++;
+
+		REQUIRE(hit.distance == Approx(expected.distance));
+		REQUIRE((hit.position - (origin + hit.distance * direction)).norm()
+				< 1e-5);
+		REQUIRE((hit.u >= 0.));
+		REQUIRE((hit.v >= 0.));
+		REQUIRE((hit.u + hit.v) <= 1.);
+
+		// Faces before the hit are ignored
+		REQUIRE(!bvh->Intersect(origin, direction, hit,
+				.999f * expected.distance));
+		REQUIRE(!bvh->IntersectAny(origin, direction,
+				.999f * expected.distance));
+	}
+
+	// Most rays go through the cube
+	REQUIRE(nbHits > NB_RAYS / 2);
+
+	delete mesh;
+}
+
+TEST_CASE("BVH") {
+	SECTION("Empty mesh") {
+		TestEmpty();
+	}
+	SECTION("Structure") {
+		TestStructure();
+	}
+	SECTION("Rays") {
+		TestRays();
+	}
+}
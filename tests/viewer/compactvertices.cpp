@@ -0,0 +1,118 @@
+#include <iostream>
+
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+
+#include "compactvertices.h"
+#include "mesh.h"
+#include "meshfactory.h"
+
+void* context = nullptr;
+
+// Number of faces of the generated meshes
+#define NB_FACES 3000
+// Number of random directions encoded
+#define NB_DIRECTIONS 20000
+
+static Mesh* CreateRandomMesh(unsigned int seed, bool withColors) {
+	// Triangles scattered in a flat box, with colors between 0 and 255
+	std::vector<float> positions(9 * NB_FACES);
+	for (unsigned int i = 0; i < 9 * NB_FACES; i++) {
+		float size = ((i % 3) == 2) ? 2. : 200.;
+		positions[i] = size * (GetRandom(seed) - .5f) + 10.;
+	}
+	std::vector<unsigned int> faces(3 * NB_FACES);
+	for (unsigned int i = 0; i < 3 * NB_FACES; i++)
+		faces[i] = i;
+	std::vector<float> colors;
+	if (withColors) {
+		colors.resize(9 * NB_FACES);
+		for (unsigned int i = 0; i < 9 * NB_FACES; i++)
+			colors[i] = (float) (int) (GetRandom(seed) * 255.f);
+	}
+	return CreateMesh(positions, faces, colors);
+}
+
+static void TestOctahedral() {
+	// Axes are encoded exactly
+	for (unsigned int c = 0; c < 3; c++) {
+		for (float sign = -1.; sign <= 1.; sign += 2.) {
+			Eigen::Vector3f axis = Eigen::Vector3f::Zero();
+			axis[c] = sign;
+			short encoded[2];
+			EncodeOctahedral(axis, encoded);
+			REQUIRE((DecodeOctahedral(encoded) - axis).norm() < 1e-6);
+		}
+	}
+
+	// Other directions are close enough for shading
+	unsigned int seed = 1;
+	float maxError = 0.;
+	for (unsigned int i = 0; i < NB_DIRECTIONS; i++) {
+		Eigen::Vector3f direction(GetRandom(seed) - .5f,
+				GetRandom(seed) - .5f, GetRandom(seed) - .5f);
+		if (direction.norm() < 1e-3)
+			continue;
+		direction.normalize();
+		short encoded[2];
+		EncodeOctahedral(direction, encoded);
+		Eigen::Vector3f decoded = DecodeOctahedral(encoded);
+		REQUIRE(decoded.norm() == Approx(1.));
+		maxError = std::max(maxError, (decoded - direction).norm());
+	}
+	REQUIRE(maxError < 1e-4);
+
+	// Null normals (of unused vertices) are still decoded as unit vectors
+	short encoded[2];
+	EncodeOctahedral(Eigen::Vector3f::Zero(), encoded);
+	REQUIRE(DecodeOctahedral(encoded).norm() == Approx(1.));
+}
+
+static void TestVertices(bool withColors) {
+	Mesh* mesh = CreateRandomMesh(2, withColors);
+	CompactVertices* vertices = new CompactVertices(mesh);
+
+	// Layout
+	REQUIRE(vertices->HaveColors() == withColors);
+	REQUIRE(vertices->GetStride() == (withColors ? 16 : 12));
+	REQUIRE(vertices->GetSize()
+			== (size_t) vertices->GetStride() * mesh->nbVertices);
+	REQUIRE(vertices->GetNormalOffset() % 4 == 0);
+	REQUIRE(vertices->GetColorOffset() % 4 == 0);
+	REQUIRE(sizeof(Vertex) >= 2 * vertices->GetStride());
+
+	// Positions are quantized relatively to each axis of the bounding box
+	Eigen::Vector3f sizes = mesh->GetBoundingBox().sizes();
+	for (unsigned int v = 0; v < mesh->nbVertices; v++) {
+		const Vertex& vertex = mesh->verticesData[v];
+		Eigen::Vector3f error = (vertices->DecodePosition(v)
+				- vertex.position).cwiseAbs();
+		for (unsigned int c = 0; c < 3; c++)
+			REQUIRE(error[c] <= sizes[c] / 65535.f);
+		REQUIRE((vertices->DecodeNormal(v) - vertex.normal).norm() < 1e-4);
+		REQUIRE((vertices->DecodeColor(v) - vertex.color).cwiseAbs()
+				.maxCoeff() <= .5f / 255.f + 1e-6);
+	}
+
+	// The layout is kept once the data is released
+	vertices->ReleaseData();
+	REQUIRE(vertices->GetData() == nullptr);
+	REQUIRE(vertices->GetSize()
+			== (size_t) vertices->GetStride() * mesh->nbVertices);
+
+	delete vertices;
+	delete mesh;
+}
+
+TEST_CASE("Compact vertices") {
+	SECTION("Octahedral normals") {
+		TestOctahedral();
+	}
+	SECTION("Without colors") {
+		TestVertices(false);
+	}
+	SECTION("With colors") {
+		TestVertices(true);
+	}
+}
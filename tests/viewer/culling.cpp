@@ -0,0 +1,103 @@
+#include <iostream>
+
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+
+#include "camera.h"
+#include "culling.h"
+#include "mesh.h"
+#include "meshfactory.h"
+
+void* context = nullptr;
+
+// Number of materials of the generated row (the most a mesh can have)
+#define NB_MATERIALS 255
+
+static Mesh* CreateRow() {
+	// One quad facing the camera per material, side by side
+	std::vector<float> positions;
+	std::vector<unsigned int> faces, materials;
+	for (unsigned int m = 0; m < NB_MATERIALS; m++) {
+		float x0 = -1. + (2. * m) / NB_MATERIALS;
+		float x1 = -1. + (2. * (m + 1)) / NB_MATERIALS;
+		positions.insert(positions.end(), {
+				x0, -.5f, 0., x1, -.5f, 0., x1, .5f, 0., x0, .5f, 0. });
+		unsigned int v = 4 * m;
+		faces.insert(faces.end(), { v, v + 1, v + 2, v, v + 2, v + 3 });
+		materials.insert(materials.end(), 2, m);
+	}
+	return CreateMesh(positions, faces, {}, materials);
+}
+
+static Eigen::Matrix4f GetView() {
+	// Camera at (0, 0, 5) looking towards -z
+	Eigen::Matrix4f view = Eigen::Matrix4f::Identity();
+	view(2, 3) = -5.;
+	return view;
+}
+
+static void TestPerMaterial() {
+	Mesh* mesh = CreateRow();
+	REQUIRE(mesh->nbMaterials == NB_MATERIALS);
+	REQUIRE(mesh->IsSorted());
+
+	ClusterCuller* culler = new ClusterCuller(mesh);
+	culler->SetOcclusionCulling(false);
+	REQUIRE(culler->Cull(Eigen::Matrix4f::Identity(), GetView(),
+			PerspectiveProjection(-.2, .2, -.2, .2, 1., 100.), false, true,
+			GL_NONE));
+	REQUIRE(culler->GetNbSubmittedFaces() == 2 * NB_MATERIALS);
+
+	// Each material gets the two faces of its quad
+	for (unsigned int m = 0; m < NB_MATERIALS; m++) {
+		ClusterDrawList* drawList = culler->GetDrawList(m);
+		REQUIRE(drawList != nullptr);
+		GLsizei nbIndices = 0;
+		for (GLsizei count: drawList->counts)
+			nbIndices += count;
+		REQUIRE(nbIndices == 6);
+		REQUIRE(drawList->offsets.front() == nullptr);
+	}
+	REQUIRE(culler->GetDrawList(NB_MATERIALS) == nullptr);
+
+	delete culler;
+	delete mesh;
+}
+
+static void TestOnePass() {
+	Mesh* mesh = CreateRow();
+	ClusterCuller* culler = new ClusterCuller(mesh);
+	culler->SetOcclusionCulling(false);
+
+	// Seen from behind, all faces are culled with back faces
+	Eigen::Matrix4f view = GetView();
+	view(0, 0) = -1.;
+	view(2, 2) = -1.;
+	REQUIRE(culler->Cull(Eigen::Matrix4f::Identity(), view,
+			PerspectiveProjection(-.2, .2, -.2, .2, 1., 100.), false, false,
+			GL_BACK));
+	REQUIRE(culler->GetDrawList(0) != nullptr);
+	REQUIRE(culler->GetDrawList(1) == nullptr);
+	REQUIRE(culler->GetNbSubmittedFaces() == 0);
+	REQUIRE(culler->GetNbBackfaceCulledFaces() == 2 * NB_MATERIALS);
+
+	// Without facet culling, they are all drawn
+	REQUIRE(culler->Cull(Eigen::Matrix4f::Identity(), view,
+			PerspectiveProjection(-.2, .2, -.2, .2, 1., 100.), false, false,
+			GL_NONE));
+	REQUIRE(culler->GetNbSubmittedFaces() == 2 * NB_MATERIALS);
+	REQUIRE(culler->GetDrawList(0)->counts.size() == 1);
+
+	delete culler;
+	delete mesh;
+}
+
+TEST_CASE("Testing viewer’s cluster culling") {
+	SECTION("Per-material draw lists") {
+		TestPerMaterial();
+	}
+	SECTION("One-pass draw list") {
+		TestOnePass();
+	}
+}
@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+
+#include "filewatcher.h"
+#include "utils.h"
+
+void* context = nullptr;
+
+// Files created in the working directory and in a subdirectory
+#define WATCHED_DIR			"filewatcher/"
+#define WATCHED_FILE		"filewatcher/watched.mat"
+#define UNWATCHED_FILE		"filewatcher/unwatched.mat"
+#define TEMPORARY_FILE		"filewatcher/watched.mat.tmp"
+#define LOCAL_FILE			"filewatcher_local.mat"
+
+static void WaitForModificationTime(const FileWatcher& watcher) {
+	// Modification times may only change each second, and are only compared
+	// every `FILE_WATCHER_POLL_INTERVAL` ms
+	if (!watcher.IsUsingNotifications())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+}
+
+static std::vector<std::string> Poll(FileWatcher& watcher) {
+	if (!watcher.IsUsingNotifications()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(
+				FILE_WATCHER_POLL_INTERVAL + 100));
+	}
+	return watcher.Poll();
+}
+
+TEST_CASE("File watcher") {
+	REQUIRE(MakeDirectory(WATCHED_DIR));
+	REQUIRE(SaveTextFile(WATCHED_FILE, "vec3 Material() {}\n"));
+	REQUIRE(SaveTextFile(UNWATCHED_FILE, "vec3 Material() {}\n"));
+	REQUIRE(SaveTextFile(LOCAL_FILE, "vec3 Material() {}\n"));
+
+	FileWatcher watcher;
+	watcher.Watch(WATCHED_FILE);
+	watcher.Watch(LOCAL_FILE);
+	watcher.Watch(WATCHED_FILE);
+	REQUIRE(watcher.GetNbWatchedFiles() == 2);
+
+	SECTION("Unmodified files") {
+		REQUIRE(Poll(watcher).empty());
+	}
+	SECTION("Modified file") {
+		WaitForModificationTime(watcher);
+		REQUIRE(SaveTextFile(WATCHED_FILE, "vec3 Material() { 1; }\n"));
+		std::vector<std::string> modifiedFiles = Poll(watcher);
+		REQUIRE(modifiedFiles.size() == 1);
+		REQUIRE(modifiedFiles[0] == WATCHED_FILE);
+		REQUIRE(Poll(watcher).empty());
+	}
+	SECTION("File without directory") {
+		WaitForModificationTime(watcher);
+		REQUIRE(SaveTextFile(LOCAL_FILE, "vec3 Material() { 1; }\n"));
+		std::vector<std::string> modifiedFiles = Poll(watcher);
+		REQUIRE(modifiedFiles.size() == 1);
+		REQUIRE(modifiedFiles[0] == LOCAL_FILE);
+	}
+	SECTION("Replaced file") {
+		// (As done by editors saving to a temporary file first.)
+		WaitForModificationTime(watcher);
+		REQUIRE(SaveTextFile(TEMPORARY_FILE, "vec3 Material() { 2; }\n"));
+		REQUIRE(std::rename(TEMPORARY_FILE, WATCHED_FILE) == 0);
+		std::vector<std::string> modifiedFiles = Poll(watcher);
+		REQUIRE(modifiedFiles.size() == 1);
+		REQUIRE(modifiedFiles[0] == WATCHED_FILE);
+	}
+	SECTION("Unwatched file") {
+		WaitForModificationTime(watcher);
+		REQUIRE(SaveTextFile(UNWATCHED_FILE, "vec3 Material() { 1; }\n"));
+		REQUIRE(Poll(watcher).empty());
+	}
+	SECTION("Cleared watcher") {
+		watcher.Clear();
+		REQUIRE(watcher.GetNbWatchedFiles() == 0);
+		WaitForModificationTime(watcher);
+		REQUIRE(SaveTextFile(WATCHED_FILE, "vec3 Material() { 1; }\n"));
+		REQUIRE(Poll(watcher).empty());
+	}
+
+	std::remove(WATCHED_FILE);
+	std::remove(UNWATCHED_FILE);
+	std::remove(LOCAL_FILE);
+	REQUIRE(DeleteDirectory(WATCHED_DIR));
+}
@@ -0,0 +1,53 @@
+#ifndef TESTS_MESHFACTORY_H
+#define TESTS_MESHFACTORY_H
+
+#include <algorithm>
+#include <vector>
+
+#include "mesh.h"
+
+// (Defined by each test.)
+extern void* context;
+
+static inline float GetRandom(unsigned int& seed) {
+	// Small linear congruential generator, so that tests are reproducible
+	seed = (1664525u * seed) + 1013904223u;
+	return (seed >> 8) / (float) (1u << 24);
+}
+
+static inline Mesh* CreateMesh(const std::vector<float>& positions,
+		const std::vector<unsigned int>& faces,
+		const std::vector<float>& colors = std::vector<float>(),
+		const std::vector<unsigned int>& materials =
+				std::vector<unsigned int>()) {
+	// Copy the arrays, the mesh data owns them
+	// (Colors and materials are only given if not empty.)
+	MeshData* data = new MeshData();
+	data->nbVertices = positions.size() / 3;
+	data->nbFaces = faces.size() / 3;
+	if (!positions.empty()) {
+		data->verticesPositions = new float[positions.size()];
+		std::copy(positions.begin(), positions.end(),
+				data->verticesPositions);
+	}
+	if (!faces.empty()) {
+		data->facesVertices = new unsigned int[faces.size()];
+		std::copy(faces.begin(), faces.end(), data->facesVertices);
+	}
+	if (!colors.empty()) {
+		data->haveColors = true;
+		data->verticesColors = new float[colors.size()];
+		std::copy(colors.begin(), colors.end(), data->verticesColors);
+	}
+	if (!materials.empty()) {
+		data->haveMaterials = true;
+		data->facesMaterials = new unsigned int[materials.size()];
+		std::copy(materials.begin(), materials.end(), data->facesMaterials);
+	}
+
+	Mesh* mesh = new Mesh(context, data);
+	delete data;
+	return mesh;
+}
+
+#endif // TESTS_MESHFACTORY_H
@@ -0,0 +1,126 @@
+#include <iostream>
+
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+
+#include "camera.h"
+#include "mesh.h"
+#include "meshfactory.h"
+#include "occlusion.h"
+
+void* context = nullptr;
+
+// A wall facing the camera, with a small face hidden behind it
+static Mesh* CreateWallMesh() {
+	return CreateMesh({
+			-10., -10., 0.,
+			10., -10., 0.,
+			10., 10., 0.,
+			-10., 10., 0.,
+			-1., -1., -3.,
+			1., -1., -3.,
+			0., 1., -3. }, {
+			0, 1, 2,
+			0, 2, 3,
+			4, 5, 6 });
+}
+
+static Eigen::Matrix4f GetTransformation() {
+	// Camera at (0, 0, 5) looking towards -z
+	Eigen::Matrix4f view = Eigen::Matrix4f::Identity();
+	view(2, 3) = -5.;
+	return PerspectiveProjection(-1., 1., -1., 1., .1, 100.) * view;
+}
+
+static void TestOccluders() {
+	Mesh* mesh = CreateWallMesh();
+
+	// The two wall faces are the largest ones
+	OcclusionCuller* culler = new OcclusionCuller(mesh, 64, 32, 2);
+	REQUIRE(culler->GetNbOccluders() == 2);
+	REQUIRE(culler->GetWidth() == 64);
+	REQUIRE(culler->GetHeight() == 32);
+
+	// Before any rendering, nothing is hidden
+	REQUIRE(culler->IsVisible(Eigen::AlignedBox3f(
+			Eigen::Vector3f(-1., -1., -3.), Eigen::Vector3f(1., 1., -2.))));
+
+	// The wall covers the whole screen
+	culler->Render(GetTransformation());
+	REQUIRE(culler->GetNbRasterizedOccluders() == 2);
+	const float* depths = culler->GetDepthBuffer();
+	for (unsigned int i = 0; i < 64 * 32; i++)
+		REQUIRE(depths[i] < 1.);
+
+	delete culler;
+	delete mesh;
+}
+
+static void TestBoxes() {
+	Mesh* mesh = CreateWallMesh();
+	OcclusionCuller* culler = new OcclusionCuller(mesh, 64, 32, 2);
+	culler->Render(GetTransformation());
+
+	// Behind the wall
+	REQUIRE(!culler->IsVisible(Eigen::AlignedBox3f(
+			Eigen::Vector3f(-1., -1., -3.), Eigen::Vector3f(1., 1., -2.))));
+	REQUIRE(!culler->IsVisible(mesh->clusters[0].boundingBox
+			.intersection(Eigen::AlignedBox3f(
+					Eigen::Vector3f(-5., -5., -5.),
+					Eigen::Vector3f(5., 5., -1.)))));
+
+	// In front of the wall
+	REQUIRE(culler->IsVisible(Eigen::AlignedBox3f(
+			Eigen::Vector3f(-1., -1., 1.), Eigen::Vector3f(1., 1., 2.))));
+
+	// Crossing the wall
+	REQUIRE(culler->IsVisible(Eigen::AlignedBox3f(
+			Eigen::Vector3f(-1., -1., -1.), Eigen::Vector3f(1., 1., 1.))));
+
+	// Crossing the near plane
+	REQUIRE(culler->IsVisible(Eigen::AlignedBox3f(
+			Eigen::Vector3f(-1., -1., 4.), Eigen::Vector3f(1., 1., 6.))));
+
+	// Out of the screen
+	REQUIRE(culler->IsVisible(Eigen::AlignedBox3f(
+			Eigen::Vector3f(30., -1., -3.), Eigen::Vector3f(31., 1., -2.))));
+
+	// Seen from behind, the wall is culled and the small face stays visible
+	Eigen::Matrix4f view = Eigen::Matrix4f::Identity();
+	view(0, 0) = -1.;
+	view(2, 2) = -1.;
+	view(2, 3) = -5.;
+	Eigen::Matrix4f transformation =
+			PerspectiveProjection(-1., 1., -1., 1., .1, 100.) * view;
+	culler->Render(transformation);
+	REQUIRE(culler->GetNbRasterizedOccluders() == 0);
+	REQUIRE(culler->IsVisible(Eigen::AlignedBox3f(
+			Eigen::Vector3f(-1., -1., -3.), Eigen::Vector3f(1., 1., -2.))));
+	REQUIRE(culler->IsVisible(Eigen::AlignedBox3f(
+			Eigen::Vector3f(-1., -1., 1.), Eigen::Vector3f(1., 1., 2.))));
+
+	// Without facet culling, the wall hides the small face from behind
+	culler->Render(transformation, GL_NONE);
+	REQUIRE(culler->GetNbRasterizedOccluders() == 2);
+	REQUIRE(!culler->IsVisible(Eigen::AlignedBox3f(
+			Eigen::Vector3f(-1., -1., 1.), Eigen::Vector3f(1., 1., 2.))));
+
+	// With front faces culled, the wall hides nothing when facing the camera
+	culler->Render(GetTransformation(), GL_FRONT);
+	REQUIRE(culler->GetNbRasterizedOccluders() == 0);
+	REQUIRE(culler->IsVisible(Eigen::AlignedBox3f(
+			Eigen::Vector3f(-1., -1., -3.), Eigen::Vector3f(1., 1., -2.))));
+
+	delete culler;
+	delete mesh;
+}
+
+TEST_CASE("Testing viewer’s occlusion culling") {
+	SECTION("Occluders") {
+		TestOccluders();
+	}
+	SECTION("Boxes") {
+		TestBoxes();
+	}
+}
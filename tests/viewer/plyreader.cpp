@@ -1,9 +1,11 @@
+#include <algorithm>
 #include <iostream>
 
 #define CATCH_CONFIG_MAIN
 
 #include <catch2/catch.hpp>
 
+#include "adjacency.h"
 #include "plyreader.h"
 
 void* context = nullptr;
@@ -319,6 +321,156 @@ static void TestDifferentHeadersLoadingData() {
 	}
 }
 
+static void TestClusters() {
+	{
+		std::string filepath = DATA_DIR "models/cube_rgbm.ply";
+
+		// Create a reader and load a file
+		PLYReader* reader = new PLYReader(context, filepath);
+		assert(reader->Load());
+		Mesh* mesh = reader->GetMesh();
+
+		// Check there is one cluster per material
+		REQUIRE(mesh->nbClusters == 6);
+		for (unsigned int i = 0; i < mesh->nbClusters; i++) {
+			REQUIRE(mesh->clusters[i].firstFace == 2 * i);
+			REQUIRE(mesh->clusters[i].nbFaces == 2);
+			REQUIRE(mesh->clusters[i].material == expectedMaterials[2 * i]);
+			REQUIRE(mesh->clusters[i].radius > 0.);
+			REQUIRE(mesh->clusters[i].coneCutoff < 1.);
+		}
+
+		delete reader;
+	}
+	{
+		std::string filepath = DATA_DIR "models/cube.ply";
+
+		// Create a reader and load a file
+		PLYReader* reader = new PLYReader(context, filepath);
+		assert(reader->Load());
+		Mesh* mesh = reader->GetMesh();
+
+		// Check there is a single cluster which can't be backfacing
+		REQUIRE(mesh->nbClusters == 1);
+		REQUIRE(mesh->clusters[0].firstFace == 0);
+		REQUIRE(mesh->clusters[0].nbFaces == expectedNbFaces);
+		REQUIRE(mesh->clusters[0].boundingBox.isApprox(
+				mesh->GetBoundingBox()));
+		REQUIRE(mesh->clusters[0].coneCutoff == 1.);
+
+		// Split it again with smaller clusters
+		mesh->ComputeClusters(5);
+		REQUIRE(mesh->nbClusters >= 3);
+		unsigned int nextFace = 0;
+		for (unsigned int i = 0; i < mesh->nbClusters; i++) {
+			REQUIRE(mesh->clusters[i].firstFace == nextFace);
+			REQUIRE(mesh->clusters[i].nbFaces <= 5);
+			nextFace += mesh->clusters[i].nbFaces;
+		}
+		REQUIRE(nextFace == expectedNbFaces);
+
+		delete reader;
+	}
+}
+
+static void TestAdjacency() {
+	std::string filepath = DATA_DIR "models/cube_rgbm.ply";
+
+	// Create a reader and load a file
+	PLYReader* reader = new PLYReader(context, filepath);
+	assert(reader->Load());
+	Mesh* mesh = reader->GetMesh();
+	MeshAdjacency* adjacency = mesh->GetAdjacency();
+	REQUIRE(adjacency != nullptr);
+	REQUIRE(mesh->GetAdjacency() == adjacency);
+
+	// Check the faces of each vertex against the list of faces
+	unsigned int nbVertexFaces = 0;
+	for (unsigned int v = 0; v < mesh->nbVertices; v++) {
+		std::vector<unsigned int> expectedFaces;
+		for (unsigned int f = 0; f < mesh->nbFaces; f++) {
+			for (unsigned int c = 0; c < 3; c++) {
+				if (mesh->facesVertices[(3 * f) + c] == v)
+					expectedFaces.push_back(f);
+			}
+		}
+		REQUIRE(adjacency->GetNbVertexFaces(v) == expectedFaces.size());
+		for (unsigned int i = 0; i < expectedFaces.size(); i++)
+			REQUIRE(adjacency->GetVertexFaces(v)[i] == expectedFaces[i]);
+		nbVertexFaces += expectedFaces.size();
+	}
+	REQUIRE(nbVertexFaces == 3 * expectedNbFaces);
+
+	// The cube is closed: each edge has a single neighbor, sharing it back
+	for (unsigned int f = 0; f < mesh->nbFaces; f++) {
+		REQUIRE(adjacency->GetNbFaceNeighbors(f) == 3);
+		for (unsigned char e = 0; e < 3; e++) {
+			REQUIRE(!adjacency->IsBoundaryEdge(f, e));
+			REQUIRE(adjacency->GetNbEdgeNeighbors(f, e) == 1);
+			unsigned int neighbor = adjacency->GetEdgeNeighbors(f, e)[0];
+			REQUIRE(neighbor != f);
+			const unsigned int* neighbors =
+					adjacency->GetFaceNeighbors(neighbor);
+			REQUIRE(std::find(neighbors, neighbors + 3, f)
+					!= (neighbors + 3));
+		}
+	}
+
+	// Normals point out of the cube
+	Eigen::Vector3f center = mesh->GetBoundingBox().center();
+	for (unsigned int v = 0; v < mesh->nbVertices; v++) {
+		REQUIRE(mesh->verticesData[v].normal.norm() == Approx(1.));
+		REQUIRE(mesh->verticesData[v].normal.dot(
+				mesh->verticesData[v].position - center) > 0.);
+	}
+
+	delete reader;
+}
+
+static void TestLayouts() {
+	std::string filepaths[2] = {
+			DATA_DIR "models/cube.ply",
+			DATA_DIR "models/cube_rgbm.ply" };
+
+	for (unsigned int i = 0; i < 2; i++) {
+		PLYReader* reader = new PLYReader(context, filepaths[i]);
+		assert(reader->Load());
+		Mesh* mesh = reader->GetMesh();
+		REQUIRE(!mesh->IsSoA());
+		REQUIRE(mesh->GetVerticesStride() == 3);
+
+		// Both layouts store the same attributes
+		Mesh* soaMesh = new Mesh(mesh, true);
+		REQUIRE(soaMesh->IsSoA());
+		REQUIRE(soaMesh->verticesData == nullptr);
+		REQUIRE(soaMesh->GetVerticesStride() == 1);
+		REQUIRE((soaMesh->GetColors() != nullptr) == mesh->HaveColors());
+		for (unsigned int v = 0; v < mesh->nbVertices; v++) {
+			REQUIRE(soaMesh->GetPositions()[v] == mesh->GetPosition(v));
+			REQUIRE(soaMesh->GetNormals()[v] == mesh->GetNormal(v));
+			REQUIRE(soaMesh->GetColor(v) == mesh->GetColor(v));
+			REQUIRE(mesh->GetPosition(v) == mesh->verticesData[v].position);
+		}
+
+		// Passes over vertices give the same results
+		soaMesh->ComputeBoundsAndNormals();
+		REQUIRE(soaMesh->GetBoundingBox().min()
+				== mesh->GetBoundingBox().min());
+		REQUIRE(soaMesh->GetBoundingBox().max()
+				== mesh->GetBoundingBox().max());
+		for (unsigned int v = 0; v < mesh->nbVertices; v++)
+			REQUIRE(soaMesh->GetNormal(v) == mesh->GetNormal(v));
+
+		// Colors are only allocated if the mesh has some
+		REQUIRE(soaMesh->GetVerticesMemorySize()
+				== (mesh->HaveColors() ? 3 : 2) * sizeof(Eigen::Vector3f)
+						* mesh->nbVertices);
+
+		delete soaMesh;
+		delete reader;
+	}
+}
+
 static void TestMultipleLoadingsData() {
 	
 }
@@ -337,4 +489,13 @@ TEST_CASE("Testing viewer’s PLY reader") {
 		TestDifferentHeadersLoadingData();
 		TestMultipleLoadingsData();
 	}
+	SECTION("Reader clusters") {
+		TestClusters();
+	}
+	SECTION("Reader adjacency") {
+		TestAdjacency();
+	}
+	SECTION("Reader layouts") {
+		TestLayouts();
+	}
 }
@@ -0,0 +1,108 @@
+#include <iostream>
+
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+
+#include "mesh.h"
+#include "meshfactory.h"
+#include "provokingmaterials.h"
+
+void* context = nullptr;
+
+// Number of quads on each side of the generated grids
+#define GRID_SIZE 64
+
+static Mesh* CreateGrid(unsigned int nbMaterials) {
+	// Two faces per quad, each column of quads having its material
+	unsigned int nbVertices = (GRID_SIZE + 1) * (GRID_SIZE + 1);
+	std::vector<float> positions(3 * nbVertices);
+	for (unsigned int v = 0; v < nbVertices; v++) {
+		positions[3 * v] = (float) (v % (GRID_SIZE + 1));
+		positions[(3 * v) + 1] = (float) (v / (GRID_SIZE + 1));
+		positions[(3 * v) + 2] = 0.;
+	}
+	std::vector<unsigned int> faces, materials;
+	for (unsigned int y = 0; y < GRID_SIZE; y++) {
+		for (unsigned int x = 0; x < GRID_SIZE; x++) {
+			unsigned int v = (y * (GRID_SIZE + 1)) + x;
+			faces.insert(faces.end(), { v, v + 1, v + GRID_SIZE + 2,
+					v, v + GRID_SIZE + 2, v + GRID_SIZE + 1 });
+			materials.insert(materials.end(), 2, x % nbMaterials);
+		}
+	}
+	return CreateMesh(positions, faces, {}, materials);
+}
+
+static void CheckFaces(Mesh* mesh, const ProvokingMaterials& materials) {
+	const unsigned int* faces = materials.GetFacesVertices();
+	const std::vector<unsigned int>& duplicated =
+			materials.GetDuplicatedVertices();
+	const std::vector<unsigned char>& verticesMaterials =
+			materials.GetVerticesMaterials();
+	REQUIRE(materials.GetNbVertices() == mesh->nbVertices + duplicated.size());
+	REQUIRE(verticesMaterials.size() == materials.GetNbVertices());
+
+	for (unsigned int f = 0; f < mesh->nbFaces; f++) {
+		// The last vertex has the material of the face
+		const unsigned int* face = faces + (3 * f);
+		REQUIRE(verticesMaterials[face[2]] == mesh->facesMaterials[f]);
+
+		// The face is a rotation of the original one (copies included)
+		unsigned int vertices[3];
+		for (unsigned int k = 0; k < 3; k++) {
+			vertices[k] = (face[k] < mesh->nbVertices) ? face[k]
+					: duplicated[face[k] - mesh->nbVertices];
+		}
+		const unsigned int* original = mesh->facesVertices + (3 * f);
+		bool rotated = false;
+		for (unsigned int r = 0; r < 3; r++) {
+			rotated |= (vertices[0] == original[r])
+					&& (vertices[1] == original[(r + 1) % 3])
+					&& (vertices[2] == original[(r + 2) % 3]);
+		}
+		REQUIRE(rotated);
+	}
+}
+
+TEST_CASE("Provoking materials") {
+	SECTION("Single material") {
+		// No face needs to change
+		Mesh* mesh = CreateGrid(1);
+		ProvokingMaterials materials(mesh);
+		CheckFaces(mesh, materials);
+		REQUIRE(materials.GetDuplicatedVertices().empty());
+		for (unsigned int i = 0; i < 3 * mesh->nbFaces; i++)
+			REQUIRE(materials.GetFacesVertices()[i] == mesh->facesVertices[i]);
+		delete mesh;
+	}
+	SECTION("Columns of materials") {
+		// Only vertices on the borders between materials may be copied
+		Mesh* mesh = CreateGrid(4);
+		ProvokingMaterials materials(mesh);
+		CheckFaces(mesh, materials);
+		REQUIRE(materials.GetDuplicatedVertices().size()
+				<= (GRID_SIZE - 1) * (GRID_SIZE + 1));
+		delete mesh;
+	}
+	SECTION("Shared copies") {
+		// Faces with the same vertices use each a free one first
+		Mesh* mesh = CreateMesh({ 0, 0, 0, 1, 0, 0, 0, 1, 0 },
+				{ 0, 1, 2, 1, 2, 0, 2, 0, 1, 0, 1, 2 }, {}, { 0, 0, 1, 1 });
+
+		ProvokingMaterials materials(mesh);
+		CheckFaces(mesh, materials);
+		REQUIRE(materials.GetNbVertices() == 3);
+		delete mesh;
+
+		// Then a copy, shared by the next faces of the same material
+		mesh = CreateMesh({ 0, 0, 0, 1, 0, 0, 0, 1, 0 },
+				{ 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2 }, {},
+				{ 0, 1, 2, 3, 3 });
+
+		ProvokingMaterials others(mesh);
+		CheckFaces(mesh, others);
+		REQUIRE(others.GetDuplicatedVertices().size() == 1);
+		delete mesh;
+	}
+}
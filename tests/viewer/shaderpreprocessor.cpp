@@ -0,0 +1,240 @@
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+
+#include <catch2/catch.hpp>
+
+#include "shaderpreprocessor.h"
+#include "utils.h"
+
+void* context = nullptr;
+
+#define PREPROCESSOR_DIR	"shaderpreprocessor/"
+#define TEMPLATE_FILE		"shaderpreprocessor/template.frag"
+#define MATERIAL_FILE		"shaderpreprocessor/mat"
+#define NB_BENCH_MATERIALS	1000
+
+#define TEMPLATE_CONTENT	"#version 330 core\n" \
+							"@define_macros\n" \
+							"@define_materials\n" \
+							"void main() {\n" \
+							"@call_materials color = @mat * @mat;\n" \
+							"}\n"
+
+static std::string GetMaterialPath(unsigned int i) {
+	return MATERIAL_FILE + std::to_string(i) + ".mat";
+}
+
+static std::string GetMaterialContent(unsigned int i) {
+	return "vec3 Material" + std::to_string(i) + "() { return vec3("
+			+ std::to_string(i) + "); }\n";
+}
+
+TEST_CASE("Shader template parsing") {
+	ShaderTemplate shaderTemplate =
+			ShaderPreprocessor::ParseTemplate(TEMPLATE_CONTENT);
+	REQUIRE(shaderTemplate.tags.size() == 3);
+	REQUIRE(shaderTemplate.texts.size() == 4);
+	REQUIRE(shaderTemplate.tags[0].type == STT_DEFINE_MACROS);
+	REQUIRE(shaderTemplate.tags[1].type == STT_DEFINE_MATERIALS);
+	REQUIRE(shaderTemplate.tags[2].type == STT_CALL_MATERIALS);
+	REQUIRE(shaderTemplate.tags[2].argumentParts.size() == 3);
+	REQUIRE(shaderTemplate.tags[2].argumentParts[0] == "color = ");
+	REQUIRE(shaderTemplate.tags[2].argumentParts[1] == " * ");
+	REQUIRE(shaderTemplate.tags[2].argumentParts[2] == ";");
+	REQUIRE(shaderTemplate.texts[0] == "#version 330 core\n");
+	REQUIRE(shaderTemplate.texts[2] == "void main() {\n");
+	REQUIRE(shaderTemplate.texts[3] == "}\n");
+
+	SECTION("Unknown tag and first line") {
+		ShaderTemplate other = ShaderPreprocessor::ParseTemplate(
+				"@first\nvoid main() {}\n@unknown tag\n");
+		REQUIRE(other.tags.size() == 1);
+		REQUIRE(other.tags[0].type == STT_UNKNOWN);
+		REQUIRE(other.texts[0] == "@first\nvoid main() {}\n");
+		REQUIRE(other.texts[1].empty());
+	}
+}
+
+TEST_CASE("Material parsing") {
+	SECTION("Function") {
+		ShaderMaterial material = ShaderPreprocessor::ParseMaterial(
+				GetMaterialContent(3));
+		REQUIRE(material.hasFunction);
+		REQUIRE(material.call == "Material3()");
+		REQUIRE(material.content == GetMaterialContent(3));
+	}
+	SECTION("Parameters") {
+		ShaderMaterial material = ShaderPreprocessor::ParseMaterial(
+				"// Red\n@albedo 1 0.5 0\n@diffuse 0.5\n@unknown 2\n");
+		REQUIRE(!material.hasFunction);
+		REQUIRE(material.content == "// Red\n");
+		REQUIRE(material.parameters[0] == 1.f);
+		REQUIRE(material.parameters[1] == .5f);
+		REQUIRE(material.parameters[2] == 0.f);
+		REQUIRE(material.parameters[3] == .5f);
+		REQUIRE(material.call == "vec3(0.5, 0.25, 0)");
+	}
+	SECTION("Empty file") {
+		ShaderMaterial material = ShaderPreprocessor::ParseMaterial("");
+		REQUIRE(!material.hasFunction);
+		REQUIRE(material.call == ST_DEFAULT_MATERIAL_CALL);
+	}
+}
+
+TEST_CASE("Shader preprocessor") {
+	REQUIRE(MakeDirectory(PREPROCESSOR_DIR));
+	REQUIRE(SaveTextFile(TEMPLATE_FILE, TEMPLATE_CONTENT));
+	std::string materialsPaths[2] = { GetMaterialPath(0), GetMaterialPath(1) };
+	REQUIRE(SaveTextFile(materialsPaths[0], GetMaterialContent(0)));
+	REQUIRE(SaveTextFile(materialsPaths[1], GetMaterialContent(1)));
+
+	std::unordered_map<std::string, std::string> macros;
+	macros["SHADING"] = "1";
+
+	ShaderPreprocessor preprocessor;
+
+	SECTION("Without materials") {
+		std::vector<std::string> dependencies;
+		std::string source = preprocessor.Expand(TEMPLATE_FILE, macros,
+				nullptr, 0, 0, &dependencies);
+		REQUIRE(source == "#version 330 core\n#define SHADING\t1\n"
+				"void main() {\n}\n");
+		REQUIRE(dependencies.size() == 1);
+		REQUIRE(dependencies[0] == TEMPLATE_FILE);
+	}
+	SECTION("Single material") {
+		std::string source = preprocessor.Expand(TEMPLATE_FILE, macros,
+				materialsPaths, 1, 0);
+		REQUIRE(source == "#version 330 core\n#define SHADING\t1\n"
+				+ GetMaterialContent(0) + "void main() {\n"
+				"color = Material0() * Material0();}\n");
+	}
+	SECTION("Several materials") {
+		std::vector<std::string> dependencies;
+		std::string source = preprocessor.Expand(TEMPLATE_FILE, macros,
+				materialsPaths, 2, 3, &dependencies);
+		REQUIRE(source == "#version 330 core\n#define SHADING\t1\n"
+				+ GetMaterialContent(0) + GetMaterialContent(1)
+				+ "void main() {\n"
+				"uint material = uint(texelFetch(face_material, "
+				"gl_PrimitiveID).r);\n"
+				"if (material == 3) { color = Material0() * Material0(); }\n"
+				"else if (material == 4) "
+				"{ color = Material1() * Material1(); }\n"
+				"else { color = vec3(0, 0, 0) * vec3(0, 0, 0); }\n}\n");
+		REQUIRE(dependencies.size() == 3);
+	}
+	SECTION("Materials table") {
+		REQUIRE(SaveTextFile(materialsPaths[1], "@albedo 1 0 0\n"));
+		macros[ST_MATERIALS_TABLE] = "1";
+		std::string source = preprocessor.Expand(TEMPLATE_FILE, macros,
+				materialsPaths, 2, 3);
+		REQUIRE(source.find("case 3u: material_color = Material0(); break;\n")
+				!= std::string::npos);
+		REQUIRE(source.find("case 4u") == std::string::npos);
+		REQUIRE(source.find("texelFetch(materials_table, int((material - 3u)))")
+				!= std::string::npos);
+		// (The code is only added once.)
+		REQUIRE(source.find("color = material_color * material_color;")
+				!= std::string::npos);
+		REQUIRE(source.find("else if") == std::string::npos);
+
+		// (Batched draws give their material instead of the face.)
+		macros[ST_MATERIAL_PER_DRAW] = "1";
+		source = preprocessor.Expand(TEMPLATE_FILE, macros, materialsPaths,
+				2, 3);
+		REQUIRE(source.find("uint material = vert_material;\n")
+				!= std::string::npos);
+		REQUIRE(source.find("face_material") == std::string::npos);
+
+		// (As faces whose provoking vertex gives it.)
+		macros.erase(ST_MATERIAL_PER_DRAW);
+		macros[ST_MATERIAL_PER_VERTEX] = "1";
+		source = preprocessor.Expand(TEMPLATE_FILE, macros, materialsPaths,
+				2, 3);
+		REQUIRE(source.find("uint material = vert_material;\n")
+				!= std::string::npos);
+
+		std::vector<float> table =
+				preprocessor.GetMaterialsTable(materialsPaths, 2);
+		REQUIRE(table.size() == (2 * SMP_SIZE));
+		REQUIRE(table[SMP_SIZE] == 1.f);
+		REQUIRE(table[SMP_SIZE + 3] == 1.f);
+	}
+	SECTION("Cached files") {
+		preprocessor.Expand(TEMPLATE_FILE, macros, materialsPaths, 2, 0);
+		REQUIRE(preprocessor.GetNbFileReads() == 3);
+		preprocessor.Expand(TEMPLATE_FILE, macros, materialsPaths, 2, 0);
+		REQUIRE(preprocessor.GetNbFileReads() == 3);
+		REQUIRE(preprocessor.GetNbCachedFiles() == 3);
+
+		// Modified files are read again, even within the same second (their
+		// size changed)
+		REQUIRE(SaveTextFile(materialsPaths[0], GetMaterialContent(20)));
+		std::string source = preprocessor.Expand(TEMPLATE_FILE, macros,
+				materialsPaths, 1, 0);
+		REQUIRE(preprocessor.GetNbFileReads() == 4);
+		REQUIRE(source.find("Material20()") != std::string::npos);
+
+		// (Or their modification time changed, if they keep their size.)
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		REQUIRE(SaveTextFile(materialsPaths[0], GetMaterialContent(21)));
+		source = preprocessor.Expand(TEMPLATE_FILE, macros, materialsPaths,
+				1, 0);
+		REQUIRE(preprocessor.GetNbFileReads() == 5);
+		REQUIRE(source.find("Material21()") != std::string::npos);
+
+		// Invalidated files are read again too
+		preprocessor.Invalidate(materialsPaths[0]);
+		preprocessor.Expand(TEMPLATE_FILE, macros, materialsPaths, 1, 0);
+		REQUIRE(preprocessor.GetNbFileReads() == 6);
+
+		preprocessor.Clear();
+		REQUIRE(preprocessor.GetNbCachedFiles() == 0);
+	}
+	SECTION("Missing template") {
+		REQUIRE(preprocessor.Expand(PREPROCESSOR_DIR "missing.frag", macros,
+				materialsPaths, 2, 0).empty());
+	}
+
+	std::remove(TEMPLATE_FILE);
+	std::remove(materialsPaths[0].c_str());
+	std::remove(materialsPaths[1].c_str());
+	REQUIRE(DeleteDirectory(PREPROCESSOR_DIR));
+}
+
+TEST_CASE("Shader preprocessor benchmark") {
+	REQUIRE(MakeDirectory(PREPROCESSOR_DIR));
+	REQUIRE(SaveTextFile(TEMPLATE_FILE, TEMPLATE_CONTENT));
+	std::vector<std::string> materialsPaths;
+	for (unsigned int i = 0; i < NB_BENCH_MATERIALS; i++) {
+		materialsPaths.push_back(GetMaterialPath(i));
+		REQUIRE(SaveTextFile(materialsPaths[i], GetMaterialContent(i)));
+	}
+	std::unordered_map<std::string, std::string> macros;
+	macros["SHADING"] = "1";
+
+	ShaderPreprocessor preprocessor;
+	std::string source = preprocessor.Expand(TEMPLATE_FILE, macros,
+			materialsPaths.data(), NB_BENCH_MATERIALS, 0);
+	REQUIRE(source.find("material == 999") != std::string::npos);
+
+	BENCHMARK("Expand 1000 materials (cached)") {
+		return preprocessor.Expand(TEMPLATE_FILE, macros,
+				materialsPaths.data(), NB_BENCH_MATERIALS, 0);
+	};
+	BENCHMARK("Expand 1000 materials (uncached)") {
+		preprocessor.Clear();
+		return preprocessor.Expand(TEMPLATE_FILE, macros,
+				materialsPaths.data(), NB_BENCH_MATERIALS, 0);
+	};
+
+	std::remove(TEMPLATE_FILE);
+	for (const std::string& path: materialsPaths)
+		std::remove(path.c_str());
+	REQUIRE(DeleteDirectory(PREPROCESSOR_DIR));
+}